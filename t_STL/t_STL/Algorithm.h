@@ -1,9 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
+#include <concepts>
+#include <new>
 
 #include "utility.h"
 #include "Pair.h"
+#include "Array.h"
+#include "Type.h"
+#include "Simd.h"
 
 namespace t
 {
@@ -97,12 +103,79 @@ namespace t
         transform( begin( source1 ), end( source1 ), begin( source2 ), begin( destination ), func );
     }
 
+    namespace details::algorithm
+    {
+        template< class It >
+        struct ContiguousElement
+        {
+            using Type = void;
+        };
+
+        template< class T >
+        struct ContiguousElement< T* >
+        {
+            using Type = type::remove_const< T >;
+        };
+
+        template< class T >
+        struct ContiguousElement< ArrayIterator< T > >
+        {
+            using Type = type::remove_const< T >;
+        };
+
+        /*
+         * Iterators over contiguous elements of a type the vector kernels handle
+         */
+        template< class It >
+        concept SimdIterator = simd::Element< typename ContiguousElement< It >::Type >;
+
+        template< class It, class T >
+        concept SimdSearch = SimdIterator< It > && type::is_same< typename ContiguousElement< It >::Type, T >;
+
+        template< class It >
+        concept Contiguous = !type::is_same< typename ContiguousElement< It >::Type, void >;
+
+        template< class It >
+        constexpr auto const* address( It it )
+        {
+            if constexpr ( type::is_pointer< It > )
+                return it;
+            else
+                return it.get();
+        }
+
+        /*
+         * Hints that the element is about to be read, for contiguous ranges
+         */
+        template< class It >
+        constexpr void prefetch( It const it )
+        {
+#if defined( __GNUC__ ) || defined( __clang__ )
+            if constexpr ( Contiguous< It > )
+            {
+                if ( !std::is_constant_evaluated() )
+                    __builtin_prefetch( address( it ) );
+            }
+#else
+            ( void )it;
+#endif
+        }
+    }
+
     /*
-     * Finds the first element in the range that matches the value
+     * Finds the first element in the range that matches the value. Contiguous
+     * arithmetic ranges searched for a value of their own type are compared
+     * many elements at a time
      */
     template< class It, class Comp >
     constexpr It find( It begin, const It end, Comp const& val )
     {
+        if constexpr ( details::algorithm::SimdSearch< It, Comp > )
+        {
+            if ( !std::is_constant_evaluated() )
+                return begin + int64( details::simd::find( details::algorithm::address( begin ), uint64( end - begin ), val ) );
+        }
+
         for ( ; begin != end; ++begin )
         {
             if ( *begin == val )
@@ -143,6 +216,168 @@ namespace t
         return findIf( begin( container ), end( container ), condition );
     }
 
+    /*
+     * Counts the elements in the range that match the value
+     */
+    template< class It, class T >
+    constexpr uint64 count( It begin, It const end, T const& val )
+    {
+        if constexpr ( details::algorithm::SimdSearch< It, T > )
+        {
+            if ( !std::is_constant_evaluated() )
+                return details::simd::count( details::algorithm::address( begin ), uint64( end - begin ), val );
+        }
+
+        uint64 total = 0;
+
+        for ( ; begin != end; ++begin )
+        {
+            if ( *begin == val )
+                ++total;
+        }
+        return total;
+    }
+
+    /*
+     * Counts the elements in the container that match the value
+     */
+    template< class C, class T >
+    constexpr uint64 count( C const& container, T const& val )
+    {
+        return t::count( begin( container ), end( container ), val );
+    }
+
+    /*
+     * Smallest and largest elements of the range, the first of equal elements
+     * winning. Throws if the range is empty
+     */
+    template< class It >
+    constexpr auto minMax( It begin, It const end )
+    {
+        using ValueType = type::decay< decltype( *begin ) >;
+
+        if ( begin == end )
+            throw Error( "Cannot find the minimum or maximum of an empty range!", 1 );
+
+        pair< ValueType, ValueType > result{ *begin, *begin };
+
+        if constexpr ( details::algorithm::SimdIterator< It > )
+        {
+            if ( !std::is_constant_evaluated() )
+            {
+                details::simd::minMax( details::algorithm::address( begin ), uint64( end - begin ), result.first, result.second );
+                return result;
+            }
+        }
+
+        for ( ++begin; begin != end; ++begin )
+        {
+            if ( *begin < result.first )
+                result.first = *begin;
+
+            if ( result.second < *begin )
+                result.second = *begin;
+        }
+        return result;
+    }
+
+    template< class C >
+    constexpr auto minMax( C const& container )
+    {
+        return minMax( begin( container ), end( container ) );
+    }
+
+    /*
+     * Smallest element of the range. Throws if the range is empty
+     */
+    template< class It >
+    constexpr auto min( It begin, It const end )
+    {
+        if constexpr ( details::algorithm::SimdIterator< It > )
+        {
+            if ( !std::is_constant_evaluated() )
+                return minMax( begin, end ).first;
+        }
+
+        if ( begin == end )
+            throw Error( "Cannot find the minimum of an empty range!", 1 );
+
+        type::decay< decltype( *begin ) > result = *begin;
+
+        for ( ++begin; begin != end; ++begin )
+        {
+            if ( *begin < result )
+                result = *begin;
+        }
+        return result;
+    }
+
+    template< class C >
+    constexpr auto min( C const& container )
+    {
+        return t::min( begin( container ), end( container ) );
+    }
+
+    /*
+     * Largest element of the range. Throws if the range is empty
+     */
+    template< class It >
+    constexpr auto max( It begin, It const end )
+    {
+        if constexpr ( details::algorithm::SimdIterator< It > )
+        {
+            if ( !std::is_constant_evaluated() )
+                return minMax( begin, end ).second;
+        }
+
+        if ( begin == end )
+            throw Error( "Cannot find the maximum of an empty range!", 1 );
+
+        type::decay< decltype( *begin ) > result = *begin;
+
+        for ( ++begin; begin != end; ++begin )
+        {
+            if ( result < *begin )
+                result = *begin;
+        }
+        return result;
+    }
+
+    template< class C >
+    constexpr auto max( C const& container )
+    {
+        return t::max( begin( container ), end( container ) );
+    }
+
+    /*
+     * Checks if the elements of the range match those starting at begin2
+     */
+    template< class It1, class It2 >
+    constexpr bool equal( It1 begin1, It1 const end1, It2 begin2 )
+    {
+        if constexpr ( details::algorithm::SimdSearch< It2, typename details::algorithm::ContiguousElement< It1 >::Type > )
+        {
+            if ( !std::is_constant_evaluated() )
+                return details::simd::equal( details::algorithm::address( begin1 ), details::algorithm::address( begin2 ), uint64( end1 - begin1 ) );
+        }
+
+        for ( ; begin1 != end1; ++begin1, ++begin2 )
+        {
+            if ( !( *begin1 == *begin2 ) )
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * Checks if both containers have the same elements
+     */
+    template< class C1, class C2 >
+    constexpr bool equal( C1 const& lhs, C2 const& rhs )
+    {
+        return end( lhs ) - begin( lhs ) == end( rhs ) - begin( rhs ) && t::equal( begin( lhs ), end( lhs ), begin( rhs ) );
+    }
+
     /*
      * Applies a function to each element in the range
      */
@@ -284,151 +519,1888 @@ namespace t
             return it1 > it2 ? it1 - it2 : it2 - it1;
         }
 
-        template< typename It >
-        constexpr It getMiddle( It begin, It const end )
+        /*
+         * Pattern-defeating quicksort (Orson Peters): quicksort with median-of-3 or
+         * ninther pivots, block partitioning for cheap comparisons, insertion sort
+         * for small or nearly sorted ranges, and heap sort once too many
+         * partitions come out unbalanced, bounding the worst case at O( n log n ).
+         * Scans are bounds checked, so a comparator that is not a strict weak
+         * ordering can leave the range unsorted but never runs outside of it
+         */
+        constexpr int64 InsertionSortThreshold = 24;
+
+        constexpr int64 NintherThreshold = 128;
+
+        // elements partialInsertionSort may move before giving up on a run
+        constexpr int64 PartialInsertionSortLimit = 8;
+
+        constexpr int64 PartitionBlockSize = 64;
+
+        template< class It >
+        constexpr void iterSwap( It lhs, It rhs )
         {
-            auto const distance = details::algorithm::iteratorDistance( begin, end );
+            swap( *lhs, *rhs );
+        }
 
-            return begin + distance / 2;
+        template< class It, class Func >
+        constexpr void sort2( It a, It b, Func& comp )
+        {
+            if ( comp( *b, *a ) )
+                iterSwap( a, b );
         }
 
-        template< typename It, typename Func >
-        constexpr void quickSort( It begin, It end, Func elementsAreSorted )
+        template< class It, class Func >
+        constexpr void sort3( It a, It b, It c, Func& comp )
         {
-            auto const distance = details::algorithm::iteratorDistance( begin, end );
+            sort2( a, b, comp );
+            sort2( b, c, comp );
+            sort2( a, b, comp );
+        }
 
-            if ( distance <= 1 )
+        template< class It, class Func >
+        constexpr void insertionSort( It begin, It const end, Func& comp )
+        {
+            if ( begin == end )
                 return;
 
-            if ( distance == 2 )
+            for ( auto cur = begin + 1; cur != end; ++cur )
             {
-                auto elem1 = begin + 1;
+                auto sift = cur;
+                auto prev = cur - 1;
 
-                if ( !elementsAreSorted( *begin, *elem1 ) )
+                if ( comp( *sift, *prev ) )
                 {
-                    swap( *begin, *elem1 );
+                    auto tmp = std::move( *sift );
+
+                    do
+                    {
+                        *sift = std::move( *prev );
+                        --sift;
+                    } while ( sift != begin && comp( tmp, *--prev ) );
+
+                    *sift = std::move( tmp );
                 }
             }
+        }
 
-            if ( distance == 3 )
-            {
-                auto elem1 = begin + 1;
-                auto elem2 = begin + 2;
+        /*
+         * Insertion sort that gives up after moving PartialInsertionSortLimit elements.
+         * Returns whether the range was sorted
+         */
+        template< class It, class Func >
+        constexpr bool partialInsertionSort( It begin, It const end, Func& comp )
+        {
+            if ( begin == end )
+                return true;
 
-                bool swappedLastTwo = false;
+            int64 moved = 0;
 
-                if ( !elementsAreSorted( *begin, *elem1 ) )
-                {
-                    swap( *begin, *elem1 );
-                }
+            for ( auto cur = begin + 1; cur != end; ++cur )
+            {
+                auto sift = cur;
+                auto prev = cur - 1;
 
-                if ( !elementsAreSorted( *elem1, *elem2 ) )
+                if ( comp( *sift, *prev ) )
                 {
-                    swap( *elem1, *elem2 );
-                    swappedLastTwo = true;
-                }
+                    auto tmp = std::move( *sift );
 
-                if ( swappedLastTwo )
-                {
-                    if ( !elementsAreSorted( *begin, *elem1 ) )
+                    do
                     {
-                        swap( *begin, *elem1 );
-                    }
+                        *sift = std::move( *prev );
+                        --sift;
+                    } while ( sift != begin && comp( tmp, *--prev ) );
+
+                    *sift = std::move( tmp );
+                    moved += cur - sift;
                 }
 
-                return;
+                if ( moved > PartialInsertionSortLimit )
+                    return false;
             }
 
-            auto pivot = details::algorithm::getMiddle( begin, end );
+            return true;
+        }
+
+        template< class It, class Func >
+        constexpr void siftDown( It begin, int64 root, int64 const size, Func& comp )
+        {
+            auto value = std::move( *( begin + root ) );
+
+            while ( true )
+            {
+                auto child = 2 * root + 1;
+
+                if ( child >= size )
+                    break;
+
+                if ( child + 1 < size && comp( *( begin + child ), *( begin + ( child + 1 ) ) ) )
+                    ++child;
+
+                if ( !comp( value, *( begin + child ) ) )
+                    break;
 
-            pivot = partitionByPivot( begin, end, pivot, elementsAreSorted );
+                *( begin + root ) = std::move( *( begin + child ) );
+                root = child;
+            }
 
-            details::algorithm::quickSort( begin, pivot, elementsAreSorted );
-            details::algorithm::quickSort( pivot + 1, end, elementsAreSorted );
+            *( begin + root ) = std::move( value );
         }
-    }
 
-    /**
-     * Sorts the given range based on the function provided.
-     * The function should take two arguments, and the function should return true if the elements are in sorted order
-     */
-    template< class It, class Func >
-    constexpr void quickSort( It begin, It end, Func elementsAreSorted )
-    {
-        details::algorithm::quickSort( begin, end, elementsAreSorted );
-    }
+        template< class It, class Func >
+        constexpr void heapSort( It begin, It const end, Func& comp )
+        {
+            int64 const size = end - begin;
 
-    /**
-     * Sorts the range in ascending order
-     */
-    template< class It >
-    constexpr void quickSort( It begin, It end )
-    {
-        details::algorithm::quickSort( begin, end, []( auto const& lhs, auto const& rhs ){ return lhs < rhs; } );
-    }
+            for ( auto i = size / 2; i-- > 0; )
+                siftDown( begin, i, size, comp );
 
-    /**
-     * Sorts the given container based on the function provided.
-     * The function should take two arguments, and the function should return true if the elements are in sorted order
-     */
-    template< class T, class Func >
-    constexpr void quickSort( T& container, Func elementsAreSorted )
-    {
-        details::algorithm::quickSort( begin( container ), end( container ), elementsAreSorted );
-    }
+            for ( auto last = size - 1; last > 0; --last )
+            {
+                iterSwap( begin, begin + last );
+                siftDown( begin, 0, last, comp );
+            }
+        }
 
-    /**
-     * Sorts the container in ascending order
-     */
-    template< class T >
-    constexpr void quickSort( T& container )
-    {
-        details::algorithm::quickSort( begin( container ), end( container ), []( auto const& lhs, auto const& rhs ){ return lhs < rhs; } );
-    }
+        /*
+         * Moves the pivot at begin into place, with everything for which comp( e, pivot )
+         * before it. Returns the pivot's new position and whether nothing had to move
+         */
+        template< class It, class Func >
+        constexpr pair< It, bool > partitionRight( It begin, It end, Func& comp )
+        {
+            auto pivot = std::move( *begin );
 
-    namespace details::algorithm
-    {
+            auto first = begin;
+            auto last = end;
+
+            do
+            {
+                ++first;
+            } while ( first != end && comp( *first, pivot ) );
+
+            while ( first < last && !comp( *--last, pivot ) );
+
+            bool const alreadyPartitioned = first >= last;
+
+            // the scans stop where they meet instead of relying on the swapped elements, which a comparator that is not a strict weak ordering can step over
+            while ( first < last )
+            {
+                iterSwap( first, last );
+
+                do ++first; while ( first < last && comp( *first, pivot ) );
+                do --last; while ( first < last && !comp( *last, pivot ) );
+            }
+
+            auto pivotPos = first - 1;
+
+            if ( pivotPos != begin )
+                *begin = std::move( *pivotPos );
+
+            *pivotPos = std::move( pivot );
+
+            return { pivotPos, alreadyPartitioned };
+        }
+
+        template< class It >
+        constexpr void swapOffsets( It const leftBase, It const rightBase, uint8 const* left, uint8 const* right, int64 const count, bool const useSwaps )
+        {
+            if ( useSwaps )
+            {
+                // keeps descending inputs linear
+                for ( int64 i = 0; i < count; ++i )
+                    iterSwap( leftBase + left[ i ], rightBase - right[ i ] );
+            }
+            else if ( count > 0 )
+            {
+                // one cyclic permutation instead of count swaps
+                auto l = leftBase + left[ 0 ];
+                auto r = rightBase - right[ 0 ];
+                auto tmp = std::move( *l );
+                *l = std::move( *r );
+
+                for ( int64 i = 1; i < count; ++i )
+                {
+                    l = leftBase + left[ i ];
+                    *r = std::move( *l );
+                    r = rightBase - right[ i ];
+                    *l = std::move( *r );
+                }
+
+                *r = std::move( tmp );
+            }
+        }
+
+        /*
+         * partitionRight without a data dependent branch per element: a block of
+         * comparison results is first recorded as offsets, then the misplaced
+         * elements are swapped in bulk (Edelkamp and Weiss, BlockQuicksort)
+         */
         template< class It, class Func >
-        constexpr void sort( It begin, It const end, Func elementsAreSorted )
+        constexpr pair< It, bool > partitionRightBranchless( It begin, It end, Func& comp )
         {
-            auto const distance = details::algorithm::iteratorDistance( begin, end );
+            auto pivot = std::move( *begin );
 
-            if ( distance <= 1 )
-                return;
+            auto first = begin;
+            auto last = end;
+
+            do
+            {
+                ++first;
+            } while ( first != end && comp( *first, pivot ) );
+
+            while ( first < last && !comp( *--last, pivot ) );
 
-            if ( distance < 16 )
+            bool const alreadyPartitioned = first >= last;
+
+            if ( !alreadyPartitioned )
             {
-                // insertion sort
-                for ( int64 i = 1; i < distance; ++i )
+                iterSwap( first, last );
+                ++first;
+
+                uint8 leftOffsets[ PartitionBlockSize ] {};
+                uint8 rightOffsets[ PartitionBlockSize ] {};
+
+                auto leftBase = first;
+                auto rightBase = last;
+
+                int64 leftCount = 0;
+                int64 rightCount = 0;
+                int64 leftStart = 0;
+                int64 rightStart = 0;
+
+                while ( first < last )
                 {
-                    auto val = std::move( *( begin + i ) );
-                    auto it = begin + ( i - 1 );
-                    while ( it >= begin && !elementsAreSorted( *it, *( it + 1 ) ) )
+                    // only refill a side once all its offsets have been used up
+                    int64 const unknown = last - first;
+                    int64 const leftSplit = leftCount == 0 ? ( rightCount == 0 ? unknown / 2 : unknown ) : 0;
+                    int64 const rightSplit = rightCount == 0 ? unknown - leftSplit : 0;
+
+                    auto const leftBlock = leftSplit < PartitionBlockSize ? leftSplit : PartitionBlockSize;
+                    auto const rightBlock = rightSplit < PartitionBlockSize ? rightSplit : PartitionBlockSize;
+
+                    for ( int64 i = 0; i < leftBlock; ++i )
+                    {
+                        leftOffsets[ leftCount ] = uint8( i );
+                        leftCount += !comp( *first, pivot );
+                        ++first;
+                    }
+
+                    for ( int64 i = 0; i < rightBlock; )
+                    {
+                        rightOffsets[ rightCount ] = uint8( ++i );
+                        rightCount += comp( *--last, pivot );
+                    }
+
+                    auto const count = leftCount < rightCount ? leftCount : rightCount;
+
+                    swapOffsets( leftBase, rightBase, leftOffsets + leftStart, rightOffsets + rightStart, count, leftCount == rightCount );
+
+                    leftCount -= count;
+                    rightCount -= count;
+                    leftStart += count;
+                    rightStart += count;
+
+                    if ( leftCount == 0 )
                     {
-                        swap( *it, *( it + 1 ) );
-                        --it;
+                        leftStart = 0;
+                        leftBase = first;
+                    }
+
+                    if ( rightCount == 0 )
+                    {
+                        rightStart = 0;
+                        rightBase = last;
                     }
-                    *( it + 1 ) = std::move( val );
                 }
-            }
-            else // qsort
-            {
-                auto pivot = details::algorithm::getMiddle( begin, end );
 
-                pivot = partitionByPivot( begin, end, pivot, elementsAreSorted );
+                // one side still has misplaced elements, move them next to the boundary
+                if ( leftCount != 0 )
+                {
+                    while ( leftCount-- > 0 )
+                        iterSwap( leftBase + leftOffsets[ leftStart + leftCount ], --last );
+
+                    first = last;
+                }
 
-                details::algorithm::sort( begin, pivot, elementsAreSorted );
-                details::algorithm::sort( pivot + 1, end, elementsAreSorted );
+                if ( rightCount != 0 )
+                {
+                    while ( rightCount-- > 0 )
+                    {
+                        iterSwap( rightBase - rightOffsets[ rightStart + rightCount ], first );
+                        ++first;
+                    }
+                }
             }
-        }
-    }
 
-    template< class It, class Func >
-    constexpr void sort( It begin, It const end, Func elementsAreSorted )
+            auto pivotPos = first - 1;
+
+            if ( pivotPos != begin )
+                *begin = std::move( *pivotPos );
+
+            *pivotPos = std::move( pivot );
+
+            return { pivotPos, alreadyPartitioned };
+        }
+
+        /*
+         * Used when the pivot equals the element before the range, i.e. the
+         * previous pivot. Moves everything not greater than the pivot to the left,
+         * so runs of equal elements are dealt with in a single pass
+         */
+        template< class It, class Func >
+        constexpr It partitionLeft( It begin, It end, Func& comp )
+        {
+            auto pivot = std::move( *begin );
+
+            auto first = begin;
+            auto last = end;
+
+            do
+            {
+                --last;
+            } while ( last != begin && comp( pivot, *last ) );
+
+            while ( first < last && !comp( pivot, *++first ) );
+
+            while ( first < last )
+            {
+                iterSwap( first, last );
+
+                do --last; while ( first < last && comp( pivot, *last ) );
+                do ++first; while ( first < last && !comp( pivot, *first ) );
+            }
+
+            if ( last != begin )
+                *begin = std::move( *last );
+
+            *last = std::move( pivot );
+
+            return last;
+        }
+
+        template< bool Branchless, class It, class Func >
+        constexpr void pdqSort( It begin, It const end, Func& comp, int64 badAllowed, bool leftmost )
+        {
+            while ( true )
+            {
+                int64 const size = end - begin;
+
+                if ( size < InsertionSortThreshold )
+                {
+                    insertionSort( begin, end, comp );
+                    return;
+                }
+
+                auto const half = size / 2;
+
+                if ( size > NintherThreshold )
+                {
+                    sort3( begin, begin + half, end - 1, comp );
+                    sort3( begin + 1, begin + ( half - 1 ), end - 2, comp );
+                    sort3( begin + 2, begin + ( half + 1 ), end - 3, comp );
+                    sort3( begin + ( half - 1 ), begin + half, begin + ( half + 1 ), comp );
+                    iterSwap( begin, begin + half );
+                }
+                else
+                {
+                    sort3( begin + half, begin, end - 1, comp );
+                }
+
+                // the pivot equals the previous one, so nothing in the range is smaller
+                if ( !leftmost && !comp( *( begin - 1 ), *begin ) )
+                {
+                    begin = partitionLeft( begin, end, comp ) + 1;
+                    continue;
+                }
+
+                auto const [ pivotPos, alreadyPartitioned ] = [ & ]()
+                {
+                    if constexpr ( Branchless )
+                        return partitionRightBranchless( begin, end, comp );
+                    else
+                        return partitionRight( begin, end, comp );
+                }();
+
+                int64 const leftSize = pivotPos - begin;
+                int64 const rightSize = end - ( pivotPos + 1 );
+
+                if ( leftSize < size / 8 || rightSize < size / 8 )
+                {
+                    if ( --badAllowed == 0 )
+                    {
+                        heapSort( begin, end, comp );
+                        return;
+                    }
+
+                    // shuffle a few elements around to break up whatever pattern caused this
+                    if ( leftSize >= InsertionSortThreshold )
+                    {
+                        iterSwap( begin, begin + leftSize / 4 );
+                        iterSwap( pivotPos - 1, pivotPos - leftSize / 4 );
+
+                        if ( leftSize > NintherThreshold )
+                        {
+                            iterSwap( begin + 1, begin + ( leftSize / 4 + 1 ) );
+                            iterSwap( begin + 2, begin + ( leftSize / 4 + 2 ) );
+                            iterSwap( pivotPos - 2, pivotPos - ( leftSize / 4 + 1 ) );
+                            iterSwap( pivotPos - 3, pivotPos - ( leftSize / 4 + 2 ) );
+                        }
+                    }
+
+                    if ( rightSize >= InsertionSortThreshold )
+                    {
+                        iterSwap( pivotPos + 1, pivotPos + ( 1 + rightSize / 4 ) );
+                        iterSwap( end - 1, end - rightSize / 4 );
+
+                        if ( rightSize > NintherThreshold )
+                        {
+                            iterSwap( pivotPos + 2, pivotPos + ( 2 + rightSize / 4 ) );
+                            iterSwap( pivotPos + 3, pivotPos + ( 3 + rightSize / 4 ) );
+                            iterSwap( end - 2, end - ( 1 + rightSize / 4 ) );
+                            iterSwap( end - 3, end - ( 2 + rightSize / 4 ) );
+                        }
+                    }
+                }
+                else if ( alreadyPartitioned
+                    && partialInsertionSort( begin, pivotPos, comp )
+                    && partialInsertionSort( pivotPos + 1, end, comp ) )
+                {
+                    // the range was (close to) a sorted run
+                    return;
+                }
+
+                pdqSort< Branchless >( begin, pivotPos, comp, badAllowed, leftmost );
+
+                begin = pivotPos + 1;
+                leftmost = false;
+            }
+        }
+
+        template< class It, class Func >
+        constexpr void sort( It begin, It const end, Func comp )
+        {
+            int64 const size = end - begin;
+
+            if ( size < 2 )
+                return;
+
+            // strictly descending input only needs reversing
+            if ( size >= InsertionSortThreshold )
+            {
+                auto it = begin;
+
+                while ( it + 1 != end && comp( *( it + 1 ), *it ) )
+                    ++it;
+
+                if ( it + 1 == end )
+                {
+                    for ( auto lo = begin, hi = end - 1; lo < hi; ++lo, --hi )
+                        iterSwap( lo, hi );
+                    return;
+                }
+            }
+
+            int64 badAllowed = 0;
+
+            for ( auto n = size; n > 0; n >>= 1 )
+                ++badAllowed;
+
+            using ValueType = type::decay< decltype( *begin ) >;
+
+            details::algorithm::pdqSort< type::is_arithmetic< ValueType > >( begin, end, comp, badAllowed, true );
+        }
+
+        template< typename It, typename Func >
+        constexpr void quickSort( It begin, It end, Func elementsAreSorted )
+        {
+            details::algorithm::sort( begin, end, elementsAreSorted );
+        }
+    }
+
+    /**
+     * Sorts the given range based on the function provided.
+     * The function should take two arguments, and return true if the first must come before the second,
+     * like operator<. Runs in O( n log n ) time in the worst case, and O( n ) on already sorted input
+     */
+    template< class It, class Func >
+    constexpr void quickSort( It begin, It end, Func elementsAreSorted )
+    {
+        details::algorithm::quickSort( begin, end, elementsAreSorted );
+    }
+
+    /**
+     * Sorts the range in ascending order
+     */
+    template< class It >
+    constexpr void quickSort( It begin, It end )
+    {
+        details::algorithm::quickSort( begin, end, []( auto const& lhs, auto const& rhs ){ return lhs < rhs; } );
+    }
+
+    /**
+     * Sorts the given container based on the function provided.
+     * The function should take two arguments, and return true if the first must come before the second
+     */
+    template< class T, class Func >
+    constexpr void quickSort( T& container, Func elementsAreSorted )
+    {
+        details::algorithm::quickSort( begin( container ), end( container ), elementsAreSorted );
+    }
+
+    /**
+     * Sorts the container in ascending order
+     */
+    template< class T >
+    constexpr void quickSort( T& container )
+    {
+        details::algorithm::quickSort( begin( container ), end( container ), []( auto const& lhs, auto const& rhs ){ return lhs < rhs; } );
+    }
+
+    /**
+     * Sorts the given range based on the function provided, which should return
+     * true if the first argument must come before the second, like operator<
+     */
+    template< class It, class Func >
+    constexpr void sort( It begin, It const end, Func elementsAreSorted )
     {
         details::algorithm::sort( begin, end, elementsAreSorted );
     }
 
+    namespace details::algorithm
+    {
+        template< uint64 Size >
+        struct UnsignedOfSize;
+
+        template<> struct UnsignedOfSize< 1 > { using Type = uint8; };
+        template<> struct UnsignedOfSize< 2 > { using Type = uint16; };
+        template<> struct UnsignedOfSize< 4 > { using Type = uint32; };
+        template<> struct UnsignedOfSize< 8 > { using Type = uint64; };
+
+        /*
+         * Maps a key to an unsigned integer with the same ordering: signed keys get
+         * their sign bit flipped, floats have all bits flipped when negative and only
+         * the sign bit otherwise, so -0.0 sorts before 0.0 and NaNs sort to the ends
+         */
+        template< class K >
+        constexpr auto radixBits( K const key )
+        {
+            static_assert( type::is_arithmetic< K >, "Radix sort keys must be arithmetic or strings" );
+
+            using U = typename UnsignedOfSize< sizeof( K ) >::Type;
+            constexpr U signBit = U( 1 ) << ( sizeof( K ) * 8 - 1 );
+
+            if constexpr ( type::is_floating_point< K > )
+            {
+                auto const bits = std::bit_cast< U >( key );
+                return U( bits ^ ( ( bits & signBit ) ? U( ~U( 0 ) ) : signBit ) );
+            }
+            else if constexpr ( type::is_signed< K > )
+            {
+                return U( U( key ) ^ signBit );
+            }
+            else
+            {
+                return U( key );
+            }
+        }
+
+        template< class K >
+        concept StringKey = requires( K const& key )
+        {
+            key.data();
+            key.size();
+        };
+
+        // below this many elements, insertion sort beats setting up the histograms
+        constexpr int64 RadixInsertionSortThreshold = 64;
+
+        constexpr int64 MsdInsertionSortThreshold = 32;
+
+        // above this many bytes, one MSD pass splits the range into buckets that fit in cache first
+        constexpr uint64 RadixCacheSize = 1 << 20;
+
+        template< class It, class KeyFunc >
+        constexpr uint8 radixDigit( It const it, KeyFunc& key, uint64 digit )
+        {
+            return uint8( radixBits( key( *it ) ) >> ( digit * 8 ) );
+        }
+
+        /*
+         * Stable LSD passes over the lowest digits of [src, src + size), moving the
+         * elements back and forth between src and dst. All histograms are gathered
+         * in one pass and digits every element agrees on are skipped. Returns
+         * whether the sorted elements ended up in dst
+         */
+        template< uint64 Digits, class SrcIt, class DstIt, class KeyFunc >
+        constexpr bool lsdPasses( SrcIt const src, DstIt const dst, int64 const size, uint64 const digits, KeyFunc& key )
+        {
+            uint64 counts[ Digits ][ 256 ] {};
+
+            for ( int64 i = 0; i < size; ++i )
+            {
+                auto const bits = radixBits( key( *( src + i ) ) );
+
+                for ( uint64 d = 0; d < digits; ++d )
+                    ++counts[ d ][ uint8( bits >> ( d * 8 ) ) ];
+            }
+
+            bool inDst = false;
+
+            for ( uint64 d = 0; d < digits; ++d )
+            {
+                auto& count = counts[ d ];
+
+                // every element has the same digit here, the pass would not move anything
+                if ( count[ radixDigit( src, key, d ) ] == uint64( size ) )
+                    continue;
+
+                uint64 offsets[ 256 ];
+                uint64 total = 0;
+
+                for ( uint64 b = 0; b < 256; ++b )
+                {
+                    offsets[ b ] = total;
+                    total += count[ b ];
+                }
+
+                if ( inDst )
+                {
+                    for ( int64 i = 0; i < size; ++i )
+                        *( src + int64( offsets[ radixDigit( dst + i, key, d ) ]++ ) ) = std::move( *( dst + i ) );
+                }
+                else
+                {
+                    for ( int64 i = 0; i < size; ++i )
+                        *( dst + int64( offsets[ radixDigit( src + i, key, d ) ]++ ) ) = std::move( *( src + i ) );
+                }
+
+                inDst = !inDst;
+            }
+
+            return inDst;
+        }
+
+        template< class It, class KeyFunc >
+        constexpr void radixInsertionSort( It const begin, It const end, KeyFunc& key )
+        {
+            auto comp = [ &key ]( auto const& lhs, auto const& rhs ) { return radixBits( key( lhs ) ) < radixBits( key( rhs ) ); };
+            insertionSort( begin, end, comp );
+        }
+
+        /*
+         * Sorts a bucket that agrees on every digit above the lowest digits by
+         * those digits, leaving the result in target
+         */
+        template< uint64 Digits, class SrcIt, class DstIt, class KeyFunc >
+        constexpr void radixSortBucket( SrcIt const bucket, DstIt const target, int64 const size, uint64 const digits, KeyFunc& key )
+        {
+            bool inTarget = false;
+
+            if ( size >= RadixInsertionSortThreshold )
+                inTarget = lsdPasses< Digits >( bucket, target, size, digits, key );
+
+            if ( !inTarget )
+            {
+                for ( int64 i = 0; i < size; ++i )
+                    *( target + i ) = std::move( *( bucket + i ) );
+            }
+
+            if ( size < RadixInsertionSortThreshold )
+                radixInsertionSort( target, target + size, key );
+        }
+
+        /*
+         * Stable LSD radix sort over 8-bit digits. Ranges too large for the cache are
+         * first scattered by their highest differing digit, so the remaining passes
+         * over each bucket stay in cache instead of streaming the whole range
+         */
+        template< class It, class KeyFunc >
+        constexpr void lsdRadixSort( It begin, It const end, KeyFunc& key )
+        {
+            using ValueType = type::decay< decltype( *begin ) >;
+            using Bits = decltype( radixBits( key( *begin ) ) );
+
+            constexpr uint64 Digits = sizeof( Bits );
+
+            int64 const size = end - begin;
+
+            if ( size < RadixInsertionSortThreshold )
+            {
+                radixInsertionSort( begin, end, key );
+                return;
+            }
+
+            Array< ValueType > scratch( static_cast< uint64 >( size ) );
+
+            if ( Digits == 1 || uint64( size ) * sizeof( ValueType ) <= RadixCacheSize )
+            {
+                if ( lsdPasses< Digits >( begin, scratch.begin(), size, Digits, key ) )
+                {
+                    for ( int64 i = 0; i < size; ++i )
+                        *( begin + i ) = std::move( scratch[ uint64( i ) ] );
+                }
+
+                return;
+            }
+
+            uint64 counts[ Digits ][ 256 ] {};
+
+            for ( int64 i = 0; i < size; ++i )
+            {
+                auto const bits = radixBits( key( *( begin + i ) ) );
+
+                for ( uint64 d = 0; d < Digits; ++d )
+                    ++counts[ d ][ uint8( bits >> ( d * 8 ) ) ];
+            }
+
+            // the highest digit the elements disagree on
+            uint64 top = Digits - 1;
+
+            while ( top != 0 && counts[ top ][ radixDigit( begin, key, top ) ] == uint64( size ) )
+                --top;
+
+            auto const& count = counts[ top ];
+
+            uint64 offsets[ 256 ];
+            uint64 total = 0;
+
+            for ( uint64 b = 0; b < 256; ++b )
+            {
+                offsets[ b ] = total;
+                total += count[ b ];
+            }
+
+            for ( int64 i = 0; i < size; ++i )
+                scratch[ offsets[ radixDigit( begin + i, key, top ) ]++ ] = std::move( *( begin + i ) );
+
+            int64 start = 0;
+
+            for ( uint64 b = 0; b < 256; ++b )
+            {
+                auto const bucketSize = int64( count[ b ] );
+                radixSortBucket< Digits >( scratch.begin() + start, begin + start, bucketSize, top, key );
+                start += bucketSize;
+            }
+        }
+
+        /*
+         * Byte of a string key at depth, shifted up by one so that strings which have
+         * already ended get bucket 0 and sort before any that continue
+         */
+        template< class K >
+        constexpr uint64 msdBucket( K const& key, uint64 depth )
+        {
+            return depth < uint64( key.size() ) ? uint64( uint8( key.data()[ depth ] ) ) + 1 : 0;
+        }
+
+        /*
+         * Stable MSD radix sort for string keys. Buckets are handled from an explicit
+         * stack, so long shared prefixes cannot exhaust the call stack
+         */
+        template< class It, class KeyFunc >
+        constexpr void msdRadixSort( It begin, It const end, KeyFunc& key )
+        {
+            using ValueType = type::decay< decltype( *begin ) >;
+
+            struct Bucket
+            {
+                int64 offset;
+                int64 size;
+                uint64 depth;
+            };
+
+            int64 const size = end - begin;
+
+            Array< ValueType > scratch( static_cast< uint64 >( size ) );
+
+            Array< Bucket > pending;
+            pending.pushBack( { 0, size, 0 } );
+
+            while ( pending.size() != 0 )
+            {
+                auto const bucket = pending.pop();
+                auto const first = begin + bucket.offset;
+
+                if ( bucket.size < MsdInsertionSortThreshold )
+                {
+                    auto comp = [ &key, depth = bucket.depth ]( auto const& lhs, auto const& rhs )
+                    {
+                        auto const& l = key( lhs );
+                        auto const& r = key( rhs );
+
+                        for ( uint64 i = depth; ; ++i )
+                        {
+                            auto const lb = msdBucket( l, i );
+                            auto const rb = msdBucket( r, i );
+
+                            if ( lb != rb )
+                                return lb < rb;
+
+                            if ( lb == 0 )
+                                return false;
+                        }
+                    };
+
+                    insertionSort( first, first + bucket.size, comp );
+                    continue;
+                }
+
+                uint64 count[ 257 ] {};
+
+                for ( int64 i = 0; i < bucket.size; ++i )
+                    ++count[ msdBucket( key( *( first + i ) ), bucket.depth ) ];
+
+                auto const shared = msdBucket( key( *first ), bucket.depth );
+
+                if ( count[ shared ] == uint64( bucket.size ) )
+                {
+                    // a common prefix byte, nothing to move
+                    if ( shared != 0 )
+                        pending.pushBack( { bucket.offset, bucket.size, bucket.depth + 1 } );
+                    continue;
+                }
+
+                uint64 offsets[ 257 ];
+                uint64 total = 0;
+
+                for ( uint64 b = 0; b < 257; ++b )
+                {
+                    offsets[ b ] = total;
+                    total += count[ b ];
+                }
+
+                for ( int64 i = 0; i < bucket.size; ++i )
+                {
+                    auto& elem = *( first + i );
+                    scratch[ offsets[ msdBucket( key( elem ), bucket.depth ) ]++ ] = std::move( elem );
+                }
+
+                for ( int64 i = 0; i < bucket.size; ++i )
+                    *( first + i ) = std::move( scratch[ uint64( i ) ] );
+
+                // bucket 0 holds strings that have ended, which are already in order
+                int64 start = int64( count[ 0 ] );
+
+                for ( uint64 b = 1; b < 257; ++b )
+                {
+                    if ( count[ b ] > 1 )
+                        pending.pushBack( { bucket.offset + start, int64( count[ b ] ), bucket.depth + 1 } );
+
+                    start += int64( count[ b ] );
+                }
+            }
+        }
+
+        template< class It, class KeyFunc >
+        constexpr void radixSort( It begin, It const end, KeyFunc key )
+        {
+            if ( end - begin < 2 )
+                return;
+
+            using KeyType = type::decay< decltype( key( *begin ) ) >;
+
+            if constexpr ( StringKey< KeyType > )
+                msdRadixSort( begin, end, key );
+            else
+                lsdRadixSort( begin, end, key );
+        }
+    }
+
+    /**
+     * Stable radix sort, in ascending order of key( element ). Keys may be integers,
+     * floating point numbers, or strings (anything with data() and size()), which
+     * are ordered bytewise. Elements must be default constructible, as one buffer
+     * the size of the range is allocated
+     */
+    template< class It, class KeyFunc >
+    constexpr void radixSort( It begin, It const end, KeyFunc key )
+    {
+        details::algorithm::radixSort( begin, end, key );
+    }
+
+    /**
+     * Stable radix sort of arithmetic or string elements in ascending order
+     */
+    template< class It >
+    constexpr void radixSort( It begin, It const end )
+    {
+        details::algorithm::radixSort( begin, end, []( auto const& elem ) -> auto const& { return elem; } );
+    }
+
+    template< class T, class KeyFunc >
+    constexpr void radixSort( T& container, KeyFunc key )
+    {
+        details::algorithm::radixSort( begin( container ), end( container ), key );
+    }
+
+    template< class T >
+    constexpr void radixSort( T& container )
+    {
+        radixSort( begin( container ), end( container ) );
+    }
+
+    namespace details::algorithm
+    {
+        /*
+         * Lower and upper bound halve the range without branching on the
+         * comparison, so their speed does not depend on how predictable the
+         * searches are. Both elements the next step could look at are fetched
+         * ahead of time, hiding most of the cache misses in large ranges
+         */
+        template< class It, class T, class Func >
+        constexpr It lowerBound( It begin, It const end, T const& value, Func& comp )
+        {
+            auto size = end - begin;
+
+            if ( size == 0 )
+                return begin;
+
+            while ( size > 1 )
+            {
+                auto const half = size / 2;
+                size -= half;
+
+                prefetch( begin + size / 2 );
+                prefetch( begin + ( half + size / 2 ) );
+
+                begin = begin + ( comp( *( begin + half ), value ) ? half : 0 );
+            }
+
+            return begin + ( comp( *begin, value ) ? 1 : 0 );
+        }
+
+        template< class It, class T, class Func >
+        constexpr It upperBound( It begin, It const end, T const& value, Func& comp )
+        {
+            auto size = end - begin;
+
+            if ( size == 0 )
+                return begin;
+
+            while ( size > 1 )
+            {
+                auto const half = size / 2;
+                size -= half;
+
+                prefetch( begin + size / 2 );
+                prefetch( begin + ( half + size / 2 ) );
+
+                begin = begin + ( comp( value, *( begin + half ) ) ? 0 : half );
+            }
+
+            return begin + ( comp( value, *begin ) ? 0 : 1 );
+        }
+
+        // searches stepped through together by lowerBounds
+        constexpr int64 SearchBatchSize = 16;
+
+        template< class It >
+        constexpr void reverse( It begin, It end )
+        {
+            while ( begin != end && begin != --end )
+            {
+                iterSwap( begin, end );
+                ++begin;
+            }
+        }
+
+        /*
+         * Swaps [begin, middle) with [middle, end), returning where the first element ended up
+         */
+        template< class It >
+        constexpr It rotate( It const begin, It const middle, It const end )
+        {
+            details::algorithm::reverse( begin, middle );
+            details::algorithm::reverse( middle, end );
+            details::algorithm::reverse( begin, end );
+
+            return begin + ( end - middle );
+        }
+
+        /*
+         * Stable merge of the sorted ranges [begin, middle) and [middle, end) without a
+         * buffer: the longer range is cut in half, the matching cut in the other range
+         * is found by binary search, and the parts between the cuts are rotated
+         */
+        template< class It, class Func >
+        constexpr void mergeInPlace( It const begin, It const middle, It const end, Func& comp )
+        {
+            auto const leftSize = middle - begin;
+            auto const rightSize = end - middle;
+
+            if ( leftSize == 0 || rightSize == 0 )
+                return;
+
+            if ( leftSize + rightSize == 2 )
+            {
+                if ( comp( *middle, *begin ) )
+                    iterSwap( begin, middle );
+                return;
+            }
+
+            It leftCut = begin;
+            It rightCut = middle;
+
+            if ( leftSize > rightSize )
+            {
+                leftCut = begin + leftSize / 2;
+                rightCut = details::algorithm::lowerBound( middle, end, *leftCut, comp );
+            }
+            else
+            {
+                rightCut = middle + rightSize / 2;
+                leftCut = details::algorithm::upperBound( begin, middle, *rightCut, comp );
+            }
+
+            auto const newMiddle = details::algorithm::rotate( leftCut, middle, rightCut );
+
+            mergeInPlace( begin, leftCut, newMiddle, comp );
+            mergeInPlace( newMiddle, rightCut, end, comp );
+        }
+
+        /*
+         * Stable merge of [begin, middle) and [middle, end), moving the left range
+         * into buffer first. buffer must hold middle - begin elements
+         */
+        template< class It, class T, class Func >
+        constexpr void mergeBuffered( It const begin, It const middle, It const end, T* buffer, Func& comp )
+        {
+            auto const leftSize = middle - begin;
+
+            for ( int64 i = 0; i < leftSize; ++i )
+                buffer[ i ] = std::move( *( begin + i ) );
+
+            T* left = buffer;
+            T* const leftEnd = buffer + leftSize;
+            It right = middle;
+            It out = begin;
+
+            while ( left != leftEnd && right != end )
+            {
+                // take from the left on ties, which keeps the merge stable
+                if ( comp( *right, *left ) )
+                {
+                    *out = std::move( *right );
+                    ++right;
+                }
+                else
+                {
+                    *out = std::move( *left );
+                    ++left;
+                }
+
+                ++out;
+            }
+
+            for ( ; left != leftEnd; ++left, ++out )
+                *out = std::move( *left );
+        }
+
+        /*
+         * Top down merge sort. Runs that are already in order are not merged, and
+         * without a buffer every merge is done in place, in O(n log^2 n) overall
+         */
+        template< class It, class T, class Func >
+        constexpr void mergeSort( It const begin, It const end, T* buffer, Func& comp )
+        {
+            auto const size = end - begin;
+
+            if ( size <= InsertionSortThreshold )
+            {
+                insertionSort( begin, end, comp );
+                return;
+            }
+
+            auto const middle = begin + size / 2;
+
+            mergeSort( begin, middle, buffer, comp );
+            mergeSort( middle, end, buffer, comp );
+
+            if ( !comp( *middle, *( middle - 1 ) ) )
+                return;
+
+            if ( buffer )
+                mergeBuffered( begin, middle, end, buffer, comp );
+            else
+                mergeInPlace( begin, middle, end, comp );
+        }
+
+        template< class It, class Func >
+        constexpr void stableSort( It const begin, It const end, Func& comp )
+        {
+            using ValueType = type::decay< decltype( *begin ) >;
+
+            auto const size = end - begin;
+
+            if ( size <= InsertionSortThreshold )
+            {
+                insertionSort( begin, end, comp );
+                return;
+            }
+
+            auto const bufferSize = uint64( size / 2 );
+
+            if ( std::is_constant_evaluated() )
+            {
+                auto* buffer = new ValueType[ bufferSize ];
+                mergeSort( begin, end, buffer, comp );
+                delete[] buffer;
+                return;
+            }
+
+            // if the buffer cannot be allocated, merge in place instead
+            auto* buffer = new ( std::nothrow ) ValueType[ bufferSize ];
+            mergeSort( begin, end, buffer, comp );
+            delete[] buffer;
+        }
+
+        /*
+         * Tournament tree over the heads of k sorted runs. Each internal node keeps
+         * the loser of the match played there and node 0 the overall winner, so
+         * replacing the winner replays only the matches on its path to the root
+         */
+        template< class It, class Func >
+        class LoserTree
+        {
+            using Value = type::remove_reference< decltype( *std::declval< It >() ) >;
+        public:
+            constexpr LoserTree( Array< It >&& heads, Array< It >&& ends, Func& comp ):
+                m_heads( std::move( heads ) ),
+                m_ends( std::move( ends ) ),
+                m_values( m_heads.size() ),
+                m_tree( m_heads.size() ),
+                m_comp( comp )
+            {
+                auto const runs = m_heads.size();
+
+                if ( runs == 0 )
+                    return;
+
+                for ( uint64 i = 0; i < runs; ++i )
+                    m_values[ i ] = m_heads[ i ] == m_ends[ i ] ? nullptr : &*m_heads[ i ];
+
+                // winners of the subtrees, leaves are the runs themselves
+                Array< uint64 > winners( 2 * runs );
+
+                for ( uint64 i = 0; i < runs; ++i )
+                    winners[ runs + i ] = i;
+
+                for ( uint64 node = runs - 1; node > 0; --node )
+                {
+                    auto const lhs = winners[ 2 * node ];
+                    auto const rhs = winners[ 2 * node + 1 ];
+
+                    if ( beats( rhs, lhs ) )
+                    {
+                        m_tree[ node ] = lhs;
+                        winners[ node ] = rhs;
+                    }
+                    else
+                    {
+                        m_tree[ node ] = rhs;
+                        winners[ node ] = lhs;
+                    }
+                }
+
+                m_tree[ 0 ] = winners[ 1 ];
+            }
+
+            constexpr bool isEmpty() const
+            {
+                return m_heads.size() == 0 || m_values[ m_tree[ 0 ] ] == nullptr;
+            }
+
+            constexpr auto const& top() const { return *m_values[ m_tree[ 0 ] ]; }
+
+            /*
+             * Advances the winning run and plays its next element up the tree
+             */
+            constexpr void pop()
+            {
+                auto winner = m_tree[ 0 ];
+                ++m_heads[ winner ];
+
+                m_values[ winner ] = m_heads[ winner ] == m_ends[ winner ] ? nullptr : &*m_heads[ winner ];
+
+                for ( auto node = ( winner + m_heads.size() ) / 2; node > 0; node /= 2 )
+                {
+                    if ( beats( m_tree[ node ], winner ) )
+                        std::swap( m_tree[ node ], winner );
+                }
+
+                m_tree[ 0 ] = winner;
+            }
+        private:
+            /*
+             * Exhausted runs lose every match and ties go to the earlier run,
+             * which keeps the merge stable
+             */
+            constexpr bool beats( uint64 lhs, uint64 rhs ) const
+            {
+                auto const* lhsValue = m_values[ lhs ];
+                auto const* rhsValue = m_values[ rhs ];
+
+                if ( !lhsValue )
+                    return false;
+
+                if ( !rhsValue )
+                    return true;
+
+                if ( lhs < rhs )
+                    return !m_comp( *rhsValue, *lhsValue );
+
+                return m_comp( *lhsValue, *rhsValue );
+            }
+        private:
+            Array< It > m_heads;
+            Array< It > m_ends;
+            // the head of each run, or null once the run is exhausted
+            Array< Value const* > m_values;
+            Array< uint64 > m_tree;
+            Func& m_comp;
+        };
+
+        template< class Runs, class OutIt, class Func >
+        constexpr OutIt kwayMerge( Runs const& runs, OutIt out, Func& comp )
+        {
+            using It = decltype( begin( *begin( runs ) ) );
+
+            Array< It > heads;
+            Array< It > ends;
+
+            for ( auto const& run : runs )
+            {
+                heads.pushBack( begin( run ) );
+                ends.pushBack( end( run ) );
+            }
+
+            LoserTree< It, Func > tree( std::move( heads ), std::move( ends ), comp );
+
+            for ( ; !tree.isEmpty(); tree.pop(), ++out )
+                *out = tree.top();
+
+            return out;
+        }
+    }
+
+    /**
+     * Sorts the range so that elements the comparator considers equal keep their
+     * relative order. Uses a buffer of half the range when one can be allocated,
+     * and merges in place otherwise
+     */
+    template< class It, class Func >
+    constexpr void stableSort( It begin, It const end, Func elementsAreSorted )
+    {
+        details::algorithm::stableSort( begin, end, elementsAreSorted );
+    }
+
+    template< class It >
+    constexpr void stableSort( It begin, It const end )
+    {
+        stableSort( begin, end, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    template< class T, class Func >
+    constexpr void stableSort( T& container, Func elementsAreSorted )
+    {
+        details::algorithm::stableSort( begin( container ), end( container ), elementsAreSorted );
+    }
+
+    template< class T >
+    constexpr void stableSort( T& container )
+    {
+        stableSort( begin( container ), end( container ) );
+    }
+
+    /**
+     * Merges a range of sorted runs into out, returning the end of the output.
+     * Equal elements are taken from earlier runs first. Each element costs
+     * O(log k) comparisons for k runs
+     */
+    template< class Runs, class OutIt, class Func >
+    constexpr OutIt kwayMerge( Runs const& runs, OutIt out, Func elementsAreSorted )
+    {
+        return details::algorithm::kwayMerge( runs, out, elementsAreSorted );
+    }
+
+    template< class Runs, class OutIt >
+    constexpr OutIt kwayMerge( Runs const& runs, OutIt out )
+    {
+        auto comp = []( auto const& lhs, auto const& rhs ) { return lhs < rhs; };
+        return details::algorithm::kwayMerge( runs, out, comp );
+    }
+
+    namespace details::algorithm
+    {
+        template< class It, class Func >
+        constexpr void siftUp( It begin, int64 index, Func& comp )
+        {
+            auto value = std::move( *( begin + index ) );
+
+            while ( index > 0 )
+            {
+                auto const parent = ( index - 1 ) / 2;
+
+                if ( !comp( *( begin + parent ), value ) )
+                    break;
+
+                *( begin + index ) = std::move( *( begin + parent ) );
+                index = parent;
+            }
+
+            *( begin + index ) = std::move( value );
+        }
+
+        /*
+         * Puts the element that belongs at nth in place with a max heap of the
+         * nth - begin + 1 smallest elements seen so far, in O( n log k )
+         */
+        template< class It, class Func >
+        constexpr void heapSelect( It begin, It const nth, It const end, Func& comp )
+        {
+            int64 const size = nth - begin + 1;
+
+            for ( auto i = size / 2; i-- > 0; )
+                siftDown( begin, i, size, comp );
+
+            for ( auto it = nth + 1; it != end; ++it )
+            {
+                if ( comp( *it, *begin ) )
+                {
+                    iterSwap( it, begin );
+                    siftDown( begin, 0, size, comp );
+                }
+            }
+
+            iterSwap( begin, nth );
+        }
+
+        /*
+         * Introselect: quickselect over partitionByPivot with median-of-3 or ninther
+         * pivots, switching to a heap select once too many partitions come out
+         * unbalanced. A pivot equal to the one bounding the range from the left
+         * means the range holds a run of equal elements, which are moved left in
+         * one pass rather than peeled off one partition at a time
+         */
+        template< class It, class Func >
+        constexpr void nthElement( It begin, It const nth, It end, Func& comp )
+        {
+            if ( nth == end )
+                return;
+
+            int64 badAllowed = 0;
+
+            for ( auto n = end - begin; n > 0; n >>= 1 )
+                ++badAllowed;
+
+            bool leftmost = true;
+
+            while ( end - begin > InsertionSortThreshold )
+            {
+                int64 const size = end - begin;
+                auto const pivot = begin + size / 2;
+
+                if ( size > NintherThreshold )
+                {
+                    auto const eighth = size / 8;
+                    sort3( begin, pivot, end - 1, comp );
+                    sort3( begin + eighth, pivot - eighth, end - 1 - eighth, comp );
+                    sort3( begin + 2 * eighth, pivot + eighth, end - 1 - 2 * eighth, comp );
+                    sort3( pivot - eighth, pivot, pivot + eighth, comp );
+                }
+                else
+                {
+                    sort3( begin, pivot, end - 1, comp );
+                }
+
+                if ( !leftmost && !comp( *( begin - 1 ), *pivot ) )
+                {
+                    auto const last = partitionByPivot( begin, end, pivot, [ &comp ]( auto const& elem, auto const& p ) { return !comp( p, elem ); } );
+
+                    // everything up to last equals the pivot
+                    if ( nth <= last )
+                        return;
+
+                    begin = last + 1;
+                    continue;
+                }
+
+                auto const middle = partitionByPivot( begin, end, pivot, [ &comp ]( auto const& elem, auto const& p ) { return comp( elem, p ); } );
+
+                if ( std::min( middle - begin, end - middle - 1 ) < size / 8 && --badAllowed == 0 )
+                {
+                    heapSelect( begin, nth, end, comp );
+                    return;
+                }
+
+                if ( middle == nth )
+                    return;
+
+                if ( nth < middle )
+                {
+                    end = middle;
+                }
+                else
+                {
+                    begin = middle + 1;
+                    leftmost = false;
+                }
+            }
+
+            insertionSort( begin, end, comp );
+        }
+    }
+
+    /**
+     * Rearranges the range so that nth holds the element that would be there if
+     * the range were sorted, with no element before it greater and no element
+     * after it less. O( n ) on average and O( n log n ) at worst
+     */
+    template< class It, class Func >
+    constexpr void nthElement( It begin, It const nth, It const end, Func elementsAreSorted )
+    {
+        details::algorithm::nthElement( begin, nth, end, elementsAreSorted );
+    }
+
+    template< class It >
+    constexpr void nthElement( It begin, It const nth, It const end )
+    {
+        nthElement( begin, nth, end, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    /**
+     * Sorts the elements that belong in [begin, middle), leaving the rest of the
+     * range in no particular order. O( n + k log k ) for k = middle - begin
+     */
+    template< class It, class Func >
+    constexpr void partialSort( It begin, It const middle, It const end, Func elementsAreSorted )
+    {
+        if ( middle == begin )
+            return;
+
+        details::algorithm::nthElement( begin, middle - 1, end, elementsAreSorted );
+        details::algorithm::sort( begin, middle - 1, elementsAreSorted );
+    }
+
+    template< class It >
+    constexpr void partialSort( It begin, It const middle, It const end )
+    {
+        partialSort( begin, middle, end, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    /**
+     * The k elements of the range that would come first if it were sorted, in
+     * sorted order. Reads the range once, front to back, keeping only a heap of k
+     * elements, so it also works over input that cannot be stored or modified
+     */
+    template< class It, class Func >
+    constexpr auto topK( It begin, It const end, uint64 const k, Func elementsAreSorted )
+    {
+        using ValueType = type::decay< decltype( *begin ) >;
+
+        Array< ValueType > heap;
+
+        if ( k == 0 )
+            return heap;
+
+        heap.reserve( k );
+
+        // a max heap, so the root is the kept element that would be dropped first
+        for ( ; begin != end; ++begin )
+        {
+            if ( heap.size() < k )
+            {
+                heap.pushBack( *begin );
+                details::algorithm::siftUp( heap.begin(), int64( heap.size() - 1 ), elementsAreSorted );
+            }
+            else if ( elementsAreSorted( *begin, heap[ 0 ] ) )
+            {
+                heap[ 0 ] = *begin;
+                details::algorithm::siftDown( heap.begin(), 0, int64( k ), elementsAreSorted );
+            }
+        }
+
+        details::algorithm::heapSort( heap.begin(), heap.end(), elementsAreSorted );
+
+        return heap;
+    }
+
+    /**
+     * The k largest elements of the range, largest first
+     */
+    template< class It >
+    constexpr auto topK( It begin, It const end, uint64 const k )
+    {
+        return topK( begin, end, k, []( auto const& lhs, auto const& rhs ) { return lhs > rhs; } );
+    }
+
+    template< class T, class Func >
+    constexpr auto topK( T const& container, uint64 const k, Func elementsAreSorted )
+    {
+        return topK( begin( container ), end( container ), k, elementsAreSorted );
+    }
+
+    template< class T >
+    constexpr auto topK( T const& container, uint64 const k )
+    {
+        return topK( begin( container ), end( container ), k );
+    }
+
+    namespace details::algorithm
+    {
+        /*
+         * Independent accumulators reduce arithmetic ranges with, so consecutive
+         * elements do not wait on each other and the compiler can vectorize
+         */
+        constexpr int64 ReduceLanes = 8;
+
+        template< class It, class T, class Func >
+        constexpr T reduce( It begin, It const end, T init, Func& op )
+        {
+            using ValueType = type::decay< decltype( *begin ) >;
+
+            int64 const size = end - begin;
+            int64 i = 0;
+
+            if constexpr ( type::is_arithmetic< ValueType > && type::is_arithmetic< T > )
+            {
+                if ( size >= 2 * ReduceLanes )
+                {
+                    T lanes[ ReduceLanes ];
+
+                    for ( int64 lane = 0; lane < ReduceLanes; ++lane )
+                        lanes[ lane ] = T( *( begin + lane ) );
+
+                    for ( i = ReduceLanes; i + ReduceLanes <= size; i += ReduceLanes )
+                    {
+                        for ( int64 lane = 0; lane < ReduceLanes; ++lane )
+                            lanes[ lane ] = op( lanes[ lane ], T( *( begin + ( i + lane ) ) ) );
+                    }
+
+                    for ( int64 width = ReduceLanes / 2; width > 0; width /= 2 )
+                    {
+                        for ( int64 lane = 0; lane < width; ++lane )
+                            lanes[ lane ] = op( lanes[ lane ], lanes[ lane + width ] );
+                    }
+
+                    init = op( init, lanes[ 0 ] );
+                }
+            }
+
+            for ( begin = begin + i; begin != end; ++begin )
+                init = op( init, *begin );
+
+            return init;
+        }
+
+        template< class It, class DestIt, class T, class Func >
+        constexpr DestIt scan( It begin, It const end, DestIt dest, T sum, Func& op, bool const inclusive )
+        {
+            for ( ; begin != end; ++begin, ++dest )
+            {
+                T next = op( sum, *begin );
+
+                if ( inclusive )
+                    *dest = next;
+                else
+                    *dest = sum;
+
+                sum = std::move( next );
+            }
+
+            return dest;
+        }
+
+        // up to this many bins, counts are spread over several tables
+        constexpr uint64 HistogramSplitBins = 1024;
+
+        constexpr int64 HistogramTables = 4;
+
+        /*
+         * Adds the bin counts of the range to counts. Consecutive elements count into
+         * different tables, so a run of elements in the same bin does not make each
+         * increment wait for the one before it
+         */
+        template< class It, class Func >
+        constexpr void histogram( It begin, It const end, uint64* counts, uint64 const bins, Func& binOf )
+        {
+            auto const binIndex = [ &binOf, bins ]( auto const& elem )
+            {
+                auto const bin = uint64( binOf( elem ) );
+
+                if ( bin >= bins )
+                    throw Error( "Bin out of range!", 1 );
+
+                return bin;
+            };
+
+            int64 const size = end - begin;
+            int64 i = 0;
+
+            if ( bins <= HistogramSplitBins && size >= HistogramTables * int64( bins ) )
+            {
+                Array< uint64 > tables( HistogramTables * bins );
+
+                for ( auto& count : tables )
+                    count = 0;
+
+                for ( ; i + HistogramTables <= size; i += HistogramTables )
+                {
+                    for ( int64 table = 0; table < HistogramTables; ++table )
+                        ++tables[ uint64( table ) * bins + binIndex( *( begin + ( i + table ) ) ) ];
+                }
+
+                for ( int64 table = 0; table < HistogramTables; ++table )
+                {
+                    for ( uint64 bin = 0; bin < bins; ++bin )
+                        counts[ bin ] += tables[ uint64( table ) * bins + bin ];
+                }
+            }
+
+            for ( begin = begin + i; begin != end; ++begin )
+                ++counts[ binIndex( *begin ) ];
+        }
+    }
+
+    /**
+     * Combines init and every element of the range with op, which must be
+     * associative and commutative, as elements are not combined in order
+     */
+    template< class It, class T, class Func >
+    constexpr T reduce( It begin, It const end, T init, Func op )
+    {
+        return details::algorithm::reduce( begin, end, init, op );
+    }
+
+    /**
+     * Sum of init and the elements of the range
+     */
+    template< class It, class T >
+    constexpr T reduce( It begin, It const end, T init )
+    {
+        return t::reduce( begin, end, init, []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+    }
+
+    template< class C, class T, class Func >
+        requires std::invocable< Func&, T, T >
+    constexpr T reduce( C const& container, T init, Func op )
+    {
+        return t::reduce( begin( container ), end( container ), init, op );
+    }
+
+    template< class C, class T >
+    constexpr T reduce( C const& container, T init )
+    {
+        return t::reduce( begin( container ), end( container ), init );
+    }
+
+    /**
+     * Writes the running totals of the range under op to dest, the first being
+     * the first element. Returns the end of the output. dest may be begin
+     */
+    template< class It, class DestIt, class Func >
+    constexpr DestIt inclusiveScan( It begin, It const end, DestIt dest, Func op )
+    {
+        if ( begin == end )
+            return dest;
+
+        using ValueType = type::decay< decltype( *begin ) >;
+
+        ValueType first = *begin;
+        *dest = first;
+        ++begin;
+        ++dest;
+
+        return details::algorithm::scan( begin, end, dest, std::move( first ), op, true );
+    }
+
+    template< class It, class DestIt >
+    constexpr DestIt inclusiveScan( It begin, It const end, DestIt dest )
+    {
+        return inclusiveScan( begin, end, dest, []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+    }
+
+    template< class C, class DestIt >
+    constexpr DestIt inclusiveScan( C const& container, DestIt dest )
+    {
+        return inclusiveScan( begin( container ), end( container ), dest );
+    }
+
+    /**
+     * Writes the running totals of the range under op to dest, starting from
+     * init and not including the element at the same position. Returns the end
+     * of the output. dest may be begin
+     */
+    template< class It, class DestIt, class T, class Func >
+    constexpr DestIt exclusiveScan( It begin, It const end, DestIt dest, T init, Func op )
+    {
+        return details::algorithm::scan( begin, end, dest, std::move( init ), op, false );
+    }
+
+    template< class It, class DestIt, class T >
+    constexpr DestIt exclusiveScan( It begin, It const end, DestIt dest, T init )
+    {
+        return exclusiveScan( begin, end, dest, std::move( init ), []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+    }
+
+    template< class C, class DestIt, class T >
+    constexpr DestIt exclusiveScan( C const& container, DestIt dest, T init )
+    {
+        return exclusiveScan( begin( container ), end( container ), dest, std::move( init ) );
+    }
+
+    /**
+     * Counts how many elements fall in each of bins bins, binOf( element ) giving
+     * the bin. Throws if an element's bin is not below bins
+     */
+    template< class It, class Func >
+    constexpr Array< uint64 > histogram( It begin, It const end, uint64 const bins, Func binOf )
+    {
+        Array< uint64 > counts( bins );
+
+        for ( auto& count : counts )
+            count = 0;
+
+        details::algorithm::histogram( begin, end, counts.data(), bins, binOf );
+
+        return counts;
+    }
+
+    /**
+     * Counts how many times each value below bins appears in a range of integers
+     */
+    template< class It >
+    constexpr Array< uint64 > histogram( It begin, It const end, uint64 const bins )
+    {
+        return histogram( begin, end, bins, []( auto const elem ) { return elem; } );
+    }
+
+    template< class C, class Func >
+        requires std::invocable< Func&, decltype( *std::declval< C const& >().begin() ) >
+    constexpr Array< uint64 > histogram( C const& container, uint64 const bins, Func binOf )
+    {
+        return histogram( begin( container ), end( container ), bins, binOf );
+    }
+
+    template< class C >
+    constexpr Array< uint64 > histogram( C const& container, uint64 const bins )
+    {
+        return histogram( begin( container ), end( container ), bins );
+    }
+
+    /**
+     * First element of the sorted range that is not less than value
+     */
+    template< class It, class T, class Func >
+    constexpr It lowerBound( It begin, It const end, T const& value, Func comp )
+    {
+        return details::algorithm::lowerBound( begin, end, value, comp );
+    }
+
+    template< class It, class T >
+    constexpr It lowerBound( It begin, It const end, T const& value )
+    {
+        return lowerBound( begin, end, value, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    template< class C, class T >
+    constexpr auto lowerBound( C const& container, T const& value )
+    {
+        return lowerBound( begin( container ), end( container ), value );
+    }
+
+    /**
+     * First element of the sorted range that is greater than value
+     */
+    template< class It, class T, class Func >
+    constexpr It upperBound( It begin, It const end, T const& value, Func comp )
+    {
+        return details::algorithm::upperBound( begin, end, value, comp );
+    }
+
+    template< class It, class T >
+    constexpr It upperBound( It begin, It const end, T const& value )
+    {
+        return upperBound( begin, end, value, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    template< class C, class T >
+    constexpr auto upperBound( C const& container, T const& value )
+    {
+        return upperBound( begin( container ), end( container ), value );
+    }
+
+    /**
+     * Checks if the sorted range has an element equivalent to value
+     */
+    template< class It, class T, class Func >
+    constexpr bool binarySearch( It begin, It const end, T const& value, Func comp )
+    {
+        auto const found = details::algorithm::lowerBound( begin, end, value, comp );
+        return found != end && !comp( value, *found );
+    }
+
+    template< class It, class T >
+    constexpr bool binarySearch( It begin, It const end, T const& value )
+    {
+        return binarySearch( begin, end, value, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
+    template< class C, class T >
+    constexpr bool binarySearch( C const& container, T const& value )
+    {
+        return binarySearch( begin( container ), end( container ), value );
+    }
+
+    /**
+     * Writes the lowerBound of every value in [values, valuesEnd) to out.
+     * Groups of searches step through the range together, so the cache misses
+     * of different searches overlap instead of following one another
+     */
+    template< class It, class ValueIt, class OutIt, class Func >
+    constexpr void lowerBounds( It const begin, It const end, ValueIt values, ValueIt const valuesEnd, OutIt out, Func comp )
+    {
+        using details::algorithm::SearchBatchSize;
+
+        auto const size = end - begin;
+
+        while ( values != valuesEnd )
+        {
+            It bases[ SearchBatchSize ] {};
+            ValueIt keys[ SearchBatchSize ] {};
+            int64 count = 0;
+
+            for ( ; count < SearchBatchSize && values != valuesEnd; ++count, ++values )
+            {
+                bases[ count ] = begin;
+                keys[ count ] = values;
+            }
+
+            for ( auto remaining = size; remaining > 1; )
+            {
+                auto const half = remaining / 2;
+                remaining -= half;
+
+                for ( int64 i = 0; i < count; ++i )
+                {
+                    details::algorithm::prefetch( bases[ i ] + remaining / 2 );
+                    details::algorithm::prefetch( bases[ i ] + ( half + remaining / 2 ) );
+
+                    bases[ i ] = bases[ i ] + ( comp( *( bases[ i ] + half ), *keys[ i ] ) ? half : 0 );
+                }
+            }
+
+            for ( int64 i = 0; i < count; ++i, ++out )
+                *out = bases[ i ] + ( size > 0 && comp( *bases[ i ], *keys[ i ] ) ? 1 : 0 );
+        }
+    }
+
+    template< class It, class ValueIt, class OutIt >
+    constexpr void lowerBounds( It const begin, It const end, ValueIt values, ValueIt const valuesEnd, OutIt out )
+    {
+        lowerBounds( begin, end, values, valuesEnd, out, []( auto const& lhs, auto const& rhs ) { return lhs < rhs; } );
+    }
+
     /*
      * Checks if the range is sorted based on the comparator
      * Comparator expects two arguments, and should return true if the elements are in sorted order.
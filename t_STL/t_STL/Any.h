@@ -1,5 +1,6 @@
 #pragma once
 
+#include <new>
 #include <typeinfo>
 #include "Type.h"
 #include "Tint.h"
@@ -9,34 +10,47 @@
 
 namespace t
 {
+	namespace details
+	{
+		namespace any
+		{
+			/*
+			 * Values that fit in this many bytes are stored inside the Any itself
+			 */
+			constexpr uint64 BufferSize = 3 * sizeof( void* );
+
+			template< typename T >
+			constexpr bool storedInline = sizeof( T ) <= BufferSize
+				&& alignof( T ) <= alignof( void* )
+				&& std::is_nothrow_move_constructible_v< T >;
+		}
+	}
+
 	class Any
 	{
 	public:
 		Any() = default;
 
-		Any( Any const& other ):
-			m_ptr( other.m_copyer( other.m_ptr ) ),
-			m_deleter( other.m_deleter ),
-			m_copyer( other.m_copyer ),
-			m_type( other.m_type ) {}
+		Any( Any const& other )
+		{
+			if ( other.m_vtable )
+			{
+				other.m_vtable->copy( other, *this );
+				m_vtable = other.m_vtable;
+			}
+		}
 
-		Any( Any&& other ) noexcept:
-			m_ptr( t::exchange( other.m_ptr, nullptr ) ),
-			m_deleter( t::exchange( other.m_deleter, nullptr ) ),
-			m_copyer( t::exchange( other.m_copyer, empty_copyer ) ),
-			m_type( t::exchange( other.m_type, nullptr ) ) {}
+		Any( Any&& other ) noexcept
+		{
+			moveFrom( other );
+		}
 
 		Any& operator=( Any const& rhs )
 		{
 			if ( this == &rhs )
 				return *this;
 
-			destroyData();
-
-			m_ptr     = rhs.m_copyer( rhs.m_ptr );
-			m_deleter = rhs.m_deleter;
-			m_copyer  = rhs.m_copyer;
-			m_type    = rhs.m_type;
+			*this = Any( rhs );
 
 			return *this;
 		}
@@ -47,73 +61,47 @@ namespace t
 				return *this;
 
 			destroyData();
-			
-			m_ptr     = t::exchange( rhs.m_ptr, nullptr );
-			m_deleter = t::exchange( rhs.m_deleter, nullptr );
-			m_copyer  = t::exchange( rhs.m_copyer, empty_copyer );
-			m_type    = t::exchange( rhs.m_type, nullptr );
+			moveFrom( rhs );
 
 			return *this;
 		}
 
 		~Any()
 		{
-			if ( m_deleter && m_ptr )
-			{
-				m_deleter( m_ptr );
-			}
-		}
-
-		template< typename T >
-		explicit Any( T const& val ) noexcept( std::is_nothrow_copy_constructible_v< T > ):
-			m_ptr ( make_value< T >( val ) ),
-			m_deleter( make_deleter< T >() ),
-			m_copyer( make_copyer< T >() ),
-			m_type( &typeid( T ) )
-		{
-			static_assert( !t::type::is_array< t::type::remove_reference< T > >, "Cannot make t::Any from an array" );
+			destroyData();
 		}
 
-		template< typename T >
-		explicit Any( T&& val ) noexcept( std::is_nothrow_move_constructible_v< T > ):
-			m_ptr( make_value< T >( std::move( val ) ) ),
-			m_deleter( make_deleter< T >() ),
-			m_copyer( make_copyer< T >() ),
-			m_type( &typeid( T ) )
+		template< typename T, class = t::type::enable_if< !t::type::is_same< t::type::decay< T >, Any > > >
+		explicit Any( T&& val ) noexcept( details::any::storedInline< t::type::decay< T > >
+			&& std::is_nothrow_constructible_v< t::type::decay< T >, T&& > )
 		{
-			static_assert(!t::type::is_array< t::type::remove_reference< T > >, "Cannot make t::Any from an array");
-		}
+			using ValueType = t::type::decay< T >;
 
-		template< typename T >
-		Any& operator=( T const& val )
-		{
 			static_assert( !t::type::is_array< t::type::remove_reference< T > >, "Cannot make t::Any from an array" );
 
-			if ( m_ptr == &val )
+			if constexpr ( details::any::storedInline< ValueType > )
 			{
-				return *this;
+				new ( m_storage.buffer ) ValueType( std::forward< T >( val ) );
+			}
+			else
+			{
+				m_storage.ptr = new ValueType( std::forward< T >( val ) );
 			}
 
-			destroyData();
-
-			*this = Any( val );
-
-			return *this;
+			m_vtable = &vtableFor< ValueType >;
 		}
 
-		template< typename T >
+		template< typename T, class = t::type::enable_if< !t::type::is_same< t::type::decay< T >, Any > > >
 		Any& operator=( T&& val )
 		{
-			static_assert(!t::type::is_array< t::type::remove_reference< T > >, "Cannot make t::Any from an array");
+			static_assert( !t::type::is_array< t::type::remove_reference< T > >, "Cannot make t::Any from an array" );
 
-			if ( m_ptr == &val )
+			if ( tryGet< t::type::decay< T > >() == &val )
 			{
 				return *this;
 			}
 
-			destroyData();
-
-			*this = Any( std::move( val ) );
+			*this = Any( std::forward< T >( val ) );
 
 			return *this;
 		}
@@ -121,98 +109,154 @@ namespace t
 		template< typename T >
 		T& get()
 		{
-			if ( m_type && typeid( T ) != *m_type )
+			if ( !m_vtable || typeid( T ) != *m_vtable->type )
 			{
 				throw Error( "bad any cast", 1 );
 			}
 
-			return *static_cast< T* >( m_ptr );
+			return *pointerTo< T >();
 		}
 
 		template< typename T >
 		T const& get() const
 		{
-			if ( m_type && typeid(T) != *m_type )
+			if ( !m_vtable || typeid( T ) != *m_vtable->type )
 			{
 				throw Error( "bad any cast", 1 );
 			}
 
-			return *static_cast< T const* >( m_ptr );
+			return *pointerTo< T >();
 		}
 
 		template< typename T >
 		T* tryGet()
 		{
-			if ( m_type && typeid( T ) != *m_type )
+			if ( !m_vtable || typeid( T ) != *m_vtable->type )
 			{
 				return nullptr;
 			}
 
-			return static_cast< T* >( m_ptr );
+			return pointerTo< T >();
 		}
 
 		template< typename T >
 		T const* tryGet() const
 		{
-			if ( m_type && typeid( T ) != *m_type )
+			if ( !m_vtable || typeid( T ) != *m_vtable->type )
 			{
 				return nullptr;
 			}
 
-			return static_cast< T const* >( m_ptr );
+			return pointerTo< T >();
 		}
 
+		bool hasValue() const { return m_vtable != nullptr; }
+
 		void clear()
 		{
 			destroyData();
-
-			m_ptr = nullptr;
-			m_deleter = nullptr;
-			m_type = nullptr;
 		}
 
 	private:
-		void destroyData()
+		/*
+		 * One static instance per stored type, shared by all Anys holding that type
+		 */
+		struct VTable
+		{
+			std::type_info const* type;
+			void ( *destroy )( Any& ) noexcept;
+			void ( *copy )( Any const& from, Any& to );
+			void ( *move )( Any& from, Any& to ) noexcept;
+		};
+
+		template< typename T >
+		T* pointerTo()
 		{
-			if ( m_deleter && m_ptr )
+			if constexpr ( details::any::storedInline< T > )
 			{
-				m_deleter( m_ptr );
+				return std::launder( reinterpret_cast< T* >( m_storage.buffer ) );
 			}
+			else
+			{
+				return static_cast< T* >( m_storage.ptr );
+			}
+		}
+
+		template< typename T >
+		T const* pointerTo() const
+		{
+			return const_cast< Any* >( this )->pointerTo< T >();
+		}
 
-			m_ptr = nullptr;
+		template< typename T >
+		static void destroyValue( Any& any ) noexcept
+		{
+			if constexpr ( details::any::storedInline< T > )
+			{
+				any.pointerTo< T >()->~T();
+			}
+			else
+			{
+				delete any.pointerTo< T >();
+			}
 		}
 
-		template< typename T, typename... Args >
-		static auto make_value( Args&&... args )
+		template< typename T >
+		static void copyValue( Any const& from, Any& to )
 		{
-			return new T( std::forward< Args >( args )... );
+			if constexpr ( details::any::storedInline< T > )
+			{
+				new ( to.m_storage.buffer ) T( *from.pointerTo< T >() );
+			}
+			else
+			{
+				to.m_storage.ptr = new T( *from.pointerTo< T >() );
+			}
 		}
 
 		template< typename T >
-		static consteval auto make_deleter()
+		static void moveValue( Any& from, Any& to ) noexcept
 		{
-			return []( void* val )
+			if constexpr ( details::any::storedInline< T > )
 			{
-				delete static_cast< T* >( val );
-			};
+				new ( to.m_storage.buffer ) T( std::move( *from.pointerTo< T >() ) );
+				from.pointerTo< T >()->~T();
+			}
+			else
+			{
+				to.m_storage.ptr = from.m_storage.ptr;
+			}
 		}
 
 		template< typename T >
-		static consteval auto make_copyer()
+		static constexpr VTable vtableFor = { &typeid( T ), &destroyValue< T >, &copyValue< T >, &moveValue< T > };
+
+		void moveFrom( Any& other ) noexcept
 		{
-			return []( void const* ptr )
+			if ( other.m_vtable )
 			{
-				return static_cast< void* >( new T( *static_cast< T const* >( ptr ) ) );
-			};
+				other.m_vtable->move( other, *this );
+				m_vtable = t::exchange( other.m_vtable, nullptr );
+			}
 		}
 
-	private:
-		static constexpr auto empty_copyer = []( void const* ) -> void* { return nullptr; };
+		void destroyData()
+		{
+			if ( m_vtable )
+			{
+				m_vtable->destroy( *this );
+				m_vtable = nullptr;
+			}
+		}
 
 	private:
-		void* m_ptr = nullptr;
-		void ( *m_deleter )( void* ) = nullptr;
-		void* ( *m_copyer )( void const* ) = empty_copyer;
-		std::type_info const* m_type = nullptr;
+		union Storage
+		{
+			void* ptr;
+			alignas( void* ) uint8 buffer[ details::any::BufferSize ];
+		} m_storage;
+		VTable const* m_vtable = nullptr;
 	};
+
+	static_assert( sizeof( Any ) <= 32, "t::Any should fit in half a cache line" );
 }
@@ -85,6 +85,7 @@ namespace t
 			if ( this == &list )
 				return *this;
 
+			delete[] m_data;
 			m_data = list.m_data;
 			m_size = list.m_size;
 			m_capacity = list.m_capacity;
@@ -123,7 +124,7 @@ namespace t
 		{
 			auto newData = new T[ size ];
 
-			for ( uint64 i = 0; i < m_size; ++i )
+			for ( uint64 i = 0; i < m_size && i < size; ++i )
 				newData[ i ] = std::move( m_data[ i ] );
 
 			delete[] m_data;
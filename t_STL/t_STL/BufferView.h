@@ -37,6 +37,7 @@ namespace t
 		{
 			m_data = buf.m_data;
 			m_size = buf.m_size;
+			return *this;
 		}
 
 		T& operator[]( SizeTy index )
@@ -63,6 +64,11 @@ namespace t
 			return operator[]( index );
 		}
 
+		T* data() noexcept { return m_data; }
+		T const* data() const noexcept { return m_data; }
+
+		SizeTy size() const noexcept { return m_size; }
+
 		T* begin() noexcept { return m_data; }
 		T* end() noexcept { return m_data + m_size; }
 		T const* cbegin() const noexcept { return m_data; }
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <bit>
+
+#include "Algorithm.h"
+#include "Array.h"
+#include "Error.h"
+
+namespace t
+{
+	/*
+	 * Read-only search index over sorted values, stored in Eytzinger (breadth
+	 * first) order: node k has the children 2k and 2k + 1. The first levels of
+	 * every search share a few cache lines, and the nodes a search reaches a
+	 * cache line's worth of levels later are fetched ahead of time. Searches
+	 * return positions in the sorted values
+	 */
+	template< class T >
+	class EytzingerIndex
+	{
+	public:
+		using ValueType = T;
+		using SizeType  = uint64;
+	public:
+		template< class It >
+		constexpr EytzingerIndex( It begin, It const end )
+		{
+			for ( It it = begin, previous = begin; it != end; previous = it, ++it )
+			{
+				if ( *it < *previous )
+					throw Error( "Eytzinger index needs sorted values!", 1 );
+
+				++m_size;
+			}
+
+			m_nodes = Array< T >( m_size + 1 + 64 / sizeof( T ) );
+
+			if ( !std::is_constant_evaluated() )
+				m_offset = alignedOffset();
+
+			// every level above the last one is full
+			m_levels = uint64( std::bit_width( m_size ) );
+			m_lastLevelSize = m_size - ( ( uint64( 1 ) << m_levels ) / 2 - 1 );
+
+			fill( begin, 1 );
+		}
+
+		constexpr explicit EytzingerIndex( Array< T > const& sorted ):
+			EytzingerIndex( sorted.begin(), sorted.end() ) {}
+
+		constexpr uint64 size() const { return m_size; }
+
+		constexpr bool empty() const { return m_size == 0; }
+
+		// position of the first value not less than value, or size()
+		constexpr uint64 lowerBound( T const& value ) const
+		{
+			return rank( search( value, Less{} ) );
+		}
+
+		// position of the first value greater than value, or size()
+		constexpr uint64 upperBound( T const& value ) const
+		{
+			return rank( search( value, []( T const& node, T const& key ){ return !( key < node ); } ) );
+		}
+
+		constexpr bool contains( T const& value ) const
+		{
+			auto const k = search( value, Less{} );
+			return k != 0 && !( value < node( k ) );
+		}
+
+		/*
+		 * Writes the lowerBound of every value in [values, end) to out. Groups of
+		 * searches walk down the tree together, so their cache misses overlap
+		 */
+		template< class It, class OutIt >
+		constexpr void lowerBounds( It values, It const end, OutIt out ) const
+		{
+			using details::algorithm::SearchBatchSize;
+
+			while ( values != end )
+			{
+				uint64 nodes[ SearchBatchSize ] {};
+				It keys[ SearchBatchSize ] {};
+				int64 count = 0;
+
+				for ( ; count < SearchBatchSize && values != end; ++count, ++values )
+				{
+					nodes[ count ] = 1;
+					keys[ count ] = values;
+				}
+
+				for ( uint64 level = 1; level < m_levels; ++level )
+				{
+					for ( int64 i = 0; i < count; ++i )
+					{
+						prefetch( nodes[ i ] );
+						nodes[ i ] = 2 * nodes[ i ] + uint64( node( nodes[ i ] ) < *keys[ i ] );
+					}
+				}
+
+				for ( int64 i = 0; i < count; ++i, ++out )
+					*out = rank( finish( nodes[ i ], *keys[ i ], Less{} ) );
+			}
+		}
+	private:
+		// nodes that fit in a cache line, and the levels they span below a node
+		static constexpr uint64 NodesPerLine = sizeof( T ) >= 64 ? 1 : std::bit_floor( 64 / sizeof( T ) );
+
+		constexpr T const& node( uint64 k ) const { return m_nodes[ m_offset + k ]; }
+
+		// moves node 0 to the start of a cache line, so the descendants fetched together share one
+		uint64 alignedOffset() const
+		{
+			auto const address = reinterpret_cast< uint64 >( m_nodes.data() );
+			return ( ( 64 - address % 64 ) % 64 ) / sizeof( T );
+		}
+
+		constexpr void prefetch( uint64 const k ) const
+		{
+			auto const ahead = k * NodesPerLine;
+			details::algorithm::prefetch( m_nodes.begin() + int64( m_offset + ( ahead < m_size ? ahead : m_size ) ) );
+		}
+
+		// in-order walk of the tree, handing out the sorted values
+		template< class It >
+		constexpr void fill( It& sorted, uint64 const k )
+		{
+			if ( k > m_size )
+				return;
+
+			fill( sorted, 2 * k );
+
+			m_nodes[ m_offset + k ] = *sorted;
+			++sorted;
+
+			fill( sorted, 2 * k + 1 );
+		}
+
+		/*
+		 * Position of node k in the sorted values, worked out from where it sits
+		 * in the tree instead of read from a table that would cost another cache
+		 * miss per search. In a tree with every level full, the in-order position
+		 * of the p-th node on level d is ( 2p + 1 ) * 2^( levels - 1 - d ) - 1.
+		 * The last level's slots sit at every other position, so positions past
+		 * its last node drop by one for every empty slot before them
+		 */
+		constexpr uint64 rank( uint64 const k ) const
+		{
+			// searches that went right at every node end up past the last value
+			if ( k == 0 )
+				return m_size;
+
+			auto const depth = uint64( std::bit_width( k ) ) - 1;
+			auto const position = ( ( 2 * ( k - ( uint64( 1 ) << depth ) ) + 1 ) << ( m_levels - 1 - depth ) ) - 1;
+			auto const slots = ( position + 1 ) / 2;
+
+			return position - ( slots > m_lastLevelSize ? slots - m_lastLevelSize : 0 );
+		}
+
+		struct Less
+		{
+			constexpr bool operator()( T const& node, T const& key ) const { return node < key; }
+		};
+
+		/*
+		 * Walks down the full levels, then takes the last step only where the
+		 * partly filled last level has a node. Every search runs the same number
+		 * of steps, so the loop does not mispredict on where it ends
+		 */
+		template< class GoRight >
+		constexpr uint64 search( T const& value, GoRight goRight ) const
+		{
+			uint64 k = 1;
+
+			for ( uint64 level = 1; level < m_levels; ++level )
+			{
+				prefetch( k );
+				k = 2 * k + uint64( goRight( node( k ), value ) );
+			}
+
+			return finish( k, value, goRight );
+		}
+
+		template< class GoRight >
+		constexpr uint64 finish( uint64 k, T const& value, GoRight goRight ) const
+		{
+			if ( m_size == 0 )
+				return 0;
+
+			// written as arithmetic, as compilers turn a select here into a branch
+			auto const inside = uint64( k <= m_size );
+			auto const right = uint64( goRight( node( k < m_size ? k : m_size ), value ) );
+
+			return lastLeft( ( k << inside ) | ( right & inside ) );
+		}
+
+		// the node where a finished search last went left, 0 if it never did
+		static constexpr uint64 lastLeft( uint64 const k )
+		{
+			return k >> ( std::countr_one( k ) + 1 );
+		}
+	private:
+		Array< T > m_nodes;
+		uint64 m_offset = 0;
+		uint64 m_size = 0;
+		uint64 m_levels = 0;
+		uint64 m_lastLevelSize = 0;
+	};
+}
@@ -149,34 +149,214 @@ namespace t
 		[[nodiscard]] constexpr ValueType const& operator[]( uint64 index ) const noexcept { return this->m_data[ index ]; }
 	};
 
+	template< class T >
+	class ImmutableSharedPtr;
+
 	namespace details
 	{
+		/*
+		 * Reference counts shared by every SharedPtr/ImmutableSharedPtr/WeakPtr that refers to the same object.
+		 * The object is destroyed when the last strong reference goes away,
+		 * the block itself once the last weak reference is gone as well.
+		 */
+		class ControlBlock
+		{
+		public:
+			constexpr ControlBlock() = default;
+
+			ControlBlock( ControlBlock const& ) = delete;
+			ControlBlock& operator=( ControlBlock const& ) = delete;
+
+			constexpr virtual ~ControlBlock() = default;
+
+			constexpr void addRef() noexcept { ++m_refCount; }
+
+			/*
+			 * Adds a strong reference only if the object is still alive
+			 */
+			[[nodiscard]] constexpr bool tryAddRef() noexcept
+			{
+				if ( m_refCount == 0 )
+					return false;
+				++m_refCount;
+				return true;
+			}
+
+			/*
+			 * Releases a strong reference, destroying the object if it was the last one.
+			 * Returns true if the block should be deleted
+			 */
+			[[nodiscard]] constexpr bool release()
+			{
+				if ( --m_refCount )
+					return false;
+
+				DestroyObject();
+
+				return m_weakCount == 0;
+			}
+
+			constexpr void addWeakRef() noexcept { ++m_weakCount; }
+
+			/*
+			 * Returns true if the block should be deleted
+			 */
+			[[nodiscard]] constexpr bool releaseWeak() noexcept
+			{
+				return --m_weakCount == 0 && m_refCount == 0;
+			}
+
+			[[nodiscard]] constexpr uint64 refCount() const noexcept { return m_refCount; }
+
+			[[nodiscard]] constexpr uint64 weakCount() const noexcept { return m_weakCount; }
+		protected:
+			constexpr virtual void DestroyObject() = 0;
+		private:
+			uint64 m_refCount = 1;
+			uint64 m_weakCount = 0;
+		};
+
+		/*
+		 * Control block for an object that was allocated on its own, i.e. an adopted raw pointer
+		 */
+		template< class T >
+		class PointerControlBlock final : public ControlBlock
+		{
+		public:
+			constexpr explicit PointerControlBlock( type::remove_array< T >* ptr ) noexcept:
+				m_ptr( ptr ) {}
+
+			constexpr virtual ~PointerControlBlock() final override = default;
+		protected:
+			constexpr virtual void DestroyObject() final override
+			{
+				if constexpr ( type::is_array< T > )
+					delete[] m_ptr;
+				else
+					delete m_ptr;
+
+				m_ptr = nullptr;
+			}
+		private:
+			type::remove_array< T >* m_ptr;
+		};
+
+		/*
+		 * Control block of a pointer handed over by the caller, nullptr for nullptr.
+		 * The pointer is owned from the start, so it is freed if the block cannot be allocated
+		 */
+		template< class T >
+		constexpr ControlBlock* controlFor( type::remove_array< T >* alloc )
+		{
+			if ( !alloc )
+				return nullptr;
+
+			try
+			{
+				return new PointerControlBlock< T >( alloc );
+			}
+			catch ( ... )
+			{
+				if constexpr ( type::is_array< T > )
+					delete[] alloc;
+				else
+					delete alloc;
+
+				throw;
+			}
+		}
+
+		/*
+		 * Control block that stores the object next to its reference counts,
+		 * so that both are created with a single allocation.
+		 * The object may be destroyed while weak references keep the block alive.
+		 */
+		template< class T >
+		class InlineControlBlock final : public ControlBlock
+		{
+		public:
+			template< class... Args >
+			constexpr explicit InlineControlBlock( Args&&... args ):
+				m_storage( std::forward< Args >( args )... ) {}
+
+			constexpr virtual ~InlineControlBlock() final override = default;
+
+			[[nodiscard]] constexpr T* get() noexcept { return &m_storage.value; }
+		protected:
+			constexpr virtual void DestroyObject() final override
+			{
+				m_storage.value.~T();
+			}
+		private:
+			union Storage {
+				T value;
+
+				template< class... Args >
+				constexpr Storage( Args&&... args ):
+					value( std::forward< Args >( args )... ) {}
+
+				constexpr ~Storage() {}
+			} m_storage;
+		};
+
+		/*
+		 * Tag used to hand an already created InlineControlBlock to a shared pointer
+		 */
+		struct AdoptBlock {};
+
+		template< class T >
+		class WeakPtrBase;
+
 		template< class T >
 		class SharedPtrBase
 		{
+			template< class > friend class SharedPtrBase;
+			template< class > friend class WeakPtrBase;
 		protected:
 			using ValueType = type::remove_array< T >;
 		protected:
 			constexpr SharedPtrBase() = default;
 
-			constexpr SharedPtrBase( ValueType* alloc ) noexcept:
+			constexpr SharedPtrBase( ValueType* alloc ):
 				m_data( alloc ),
-				m_refCount( new uint64( 1 ) ) {};
+				m_control( controlFor< T >( alloc ) ) {};
+
+			constexpr SharedPtrBase( ValueType* data, ControlBlock* control ) noexcept:
+				m_data( data ),
+				m_control( control ) {}
 
 			constexpr SharedPtrBase( SharedPtrBase const& ptr ):
 				m_data( ptr.m_data ),
-				m_refCount( ptr.m_refCount )
+				m_control( ptr.m_control )
 			{
-				if ( m_refCount )
-					*m_refCount += 1;
+				if ( m_control )
+					m_control->addRef();
 			}
 
 			constexpr SharedPtrBase( SharedPtrBase&& ptr ) noexcept:
 				m_data( ptr.m_data ),
-				m_refCount( ptr.m_refCount )
+				m_control( ptr.m_control )
+			{
+				ptr.m_data = nullptr;
+				ptr.m_control = nullptr;
+			}
+
+			template< class U >
+			constexpr SharedPtrBase( SharedPtrBase< U > const& ptr ):
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
+			{
+				if ( m_control )
+					m_control->addRef();
+			}
+
+			template< class U >
+			constexpr SharedPtrBase( SharedPtrBase< U >&& ptr ) noexcept:
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
 			{
 				ptr.m_data = nullptr;
-				ptr.m_refCount = nullptr;
+				ptr.m_control = nullptr;
 			}
 
 			constexpr void operator=( SharedPtrBase const& rhs )
@@ -184,13 +364,13 @@ namespace t
 				if ( this == &rhs )
 					return;
 
+				if ( rhs.m_control )
+					rhs.m_control->addRef();
+
 				DestroyData();
 
 				m_data = rhs.m_data;
-				m_refCount = rhs.m_refCount;
-
-				if ( m_refCount )
-					*m_refCount += 1;
+				m_control = rhs.m_control;
 			}
 			
 			constexpr void operator=( SharedPtrBase&& rhs ) noexcept
@@ -201,29 +381,30 @@ namespace t
 				DestroyData();
 
 				m_data = rhs.m_data;
-				m_refCount = rhs.m_refCount;
+				m_control = rhs.m_control;
 
 				rhs.m_data = nullptr;
-				rhs.m_refCount = nullptr;
+				rhs.m_control = nullptr;
 			}
 
 			constexpr void operator=( ValueType* alloc )
 			{
 				DestroyData();
 
-				m_data = alloc;
-				if ( m_data == nullptr )
+				if ( alloc == nullptr )
 					return;
-				m_refCount = new uint64( 1 );
+
+				m_control = controlFor< T >( alloc );
+				m_data = alloc;
 			}
 		public:
 			constexpr ~SharedPtrBase() { DestroyData(); }
 
 			[[nodiscard]] constexpr bool isUnique() const noexcept
 			{
-				if ( m_data == nullptr || m_refCount == nullptr )
+				if ( m_data == nullptr || m_control == nullptr )
 					return true;
-				return *m_refCount == 1;
+				return m_control->refCount() == 1;
 			}
 
 			[[nodiscard]] constexpr bool isShared() const noexcept
@@ -231,6 +412,11 @@ namespace t
 				return !isUnique();
 			}
 
+			[[nodiscard]] constexpr uint64 useCount() const noexcept
+			{
+				return m_control ? m_control->refCount() : 0;
+			}
+
 			[[nodiscard]] constexpr ValueType* get() const noexcept { return m_data; }
 
 			[[nodiscard]] constexpr const ValueType* operator->() const noexcept { return m_data; }
@@ -252,31 +438,15 @@ namespace t
 		protected:
 			constexpr void DestroyData()
 			{
-				if ( m_refCount == nullptr )
-					return;
-
-				*m_refCount -= 1;
-
-				if ( *m_refCount )
-				{
-					m_refCount = nullptr;
-					m_data = nullptr;
-					return;
-				}
-
-				delete m_refCount;
-
-				if constexpr ( type::is_array< T > )
-					delete[] m_data;
-				else
-					delete m_data;
+				if ( m_control && m_control->release() )
+					delete m_control;
 
 				m_data = nullptr;
-				m_refCount = nullptr;
+				m_control = nullptr;
 			}
 		protected:
 			ValueType* m_data = nullptr;
-			uint64* m_refCount = nullptr;
+			ControlBlock* m_control = nullptr;
 		};
 	}
 
@@ -289,19 +459,30 @@ namespace t
 		constexpr SharedPtr() = default;
 
 		constexpr SharedPtr( const T& in ):
-			BaseType( new T( in ) ) {}
+			SharedPtr( new details::InlineControlBlock< T >( in ), details::AdoptBlock{} ) {}
 
 		constexpr SharedPtr( T&& in ):
-			BaseType( new T( move( in ) ) ) {}
+			SharedPtr( new details::InlineControlBlock< T >( std::move( in ) ), details::AdoptBlock{} ) {}
 
 		constexpr SharedPtr( T* allocation ):
 			BaseType( allocation ) {}
 
+		constexpr SharedPtr( details::InlineControlBlock< T >* block, details::AdoptBlock ) noexcept:
+			BaseType( block->get(), block ) {}
+
 		constexpr SharedPtr( const SharedPtr& ptr ):
 			BaseType( ptr ) {}
 
 		constexpr SharedPtr( SharedPtr&& ptr ) noexcept:
-			BaseType( move( ptr ) ) {}
+			BaseType( std::move( ptr ) ) {}
+
+		template< class U, class = type::enable_if< std::is_convertible_v< U*, T* > && !type::is_same< U, T > > >
+		constexpr SharedPtr( SharedPtr< U > const& ptr ):
+			BaseType( ptr ) {}
+
+		template< class U, class = type::enable_if< std::is_convertible_v< U*, T* > && !type::is_same< U, T > > >
+		constexpr SharedPtr( SharedPtr< U >&& ptr ) noexcept:
+			BaseType( std::move( ptr ) ) {}
 
 		constexpr SharedPtr& operator=( SharedPtr const& rhs )
 		{
@@ -311,7 +492,7 @@ namespace t
 
 		constexpr SharedPtr& operator=( SharedPtr&& rhs ) noexcept
 		{
-			BaseType::operator=( move( rhs ) );
+			BaseType::operator=( std::move( rhs ) );
 			return *this;
 		}
 
@@ -337,7 +518,7 @@ namespace t
 			BaseType( ptr ) {}
 
 		constexpr SharedPtr( SharedPtr&& ptr ) noexcept:
-			BaseType( ptr ) {}
+			BaseType( std::move( ptr ) ) {}
 
 		constexpr SharedPtr& operator=( SharedPtr const& rhs )
 		{
@@ -347,7 +528,7 @@ namespace t
 
 		constexpr SharedPtr& operator=( SharedPtr&& rhs ) noexcept
 		{
-			BaseType::operator=( move( rhs ) );
+			BaseType::operator=( std::move( rhs ) );
 			return *this;
 		}
 
@@ -364,36 +545,39 @@ namespace t
 	template< class T >
 	class ImmutableSharedPtr
 	{
+		template< class > friend class details::WeakPtrBase;
 	public:
 		constexpr ImmutableSharedPtr() = default;
 
 		constexpr ImmutableSharedPtr( ImmutableSharedPtr&& other ) noexcept:
 			m_data( other.m_data ),
-			m_refCount( other.m_refCount )
+			m_control( other.m_control )
 		{
 			other.m_data = nullptr;
-			other.m_refCount = nullptr;
+			other.m_control = nullptr;
 		}
 
 		constexpr ImmutableSharedPtr( ImmutableSharedPtr const& other ):
 			m_data( other.m_data ),
-			m_refCount( other.m_refCount )
+			m_control( other.m_control )
 		{
-			if ( m_refCount != nullptr )
-				*m_refCount += 1;
+			if ( m_control != nullptr )
+				m_control->addRef();
 		}
 
 		constexpr ImmutableSharedPtr( T* allocation ):
 			m_data( allocation ),
-			m_refCount( new uint64( 1 ) ) {}
+			m_control( details::controlFor< T >( allocation ) ) {}
 
-		constexpr ImmutableSharedPtr( T&& data ) noexcept:
-			m_data( new T( std::move( data ) ) ),
-			m_refCount( new uint64( 1 ) ) {};
+		constexpr ImmutableSharedPtr( details::InlineControlBlock< T >* block, details::AdoptBlock ) noexcept:
+			m_data( block->get() ),
+			m_control( block ) {}
+
+		constexpr ImmutableSharedPtr( T&& data ):
+			ImmutableSharedPtr( new details::InlineControlBlock< T >( std::move( data ) ), details::AdoptBlock{} ) {}
 
 		constexpr ImmutableSharedPtr( T const& data ):
-			m_data( new T( data ) ),
-			m_refCount( new uint64( 1 ) ) {}
+			ImmutableSharedPtr( new details::InlineControlBlock< T >( data ), details::AdoptBlock{} ) {}
 
 		constexpr ~ImmutableSharedPtr()
 		{
@@ -408,10 +592,10 @@ namespace t
 			DestroyData();
 
 			m_data = rhs.m_data;
-			m_refCount = rhs.m_refCount;
+			m_control = rhs.m_control;
 
 			rhs.m_data = nullptr;
-			rhs.m_refCount = nullptr;
+			rhs.m_control = nullptr;
 
 			return *this;
 		}
@@ -421,13 +605,13 @@ namespace t
 			if ( &rhs == this )
 				return *this;
 
+			if ( rhs.m_control != nullptr )
+				rhs.m_control->addRef();
+
 			DestroyData();
 
 			m_data = rhs.m_data;
-			m_refCount = rhs.m_refCount;
-
-			if ( m_refCount != nullptr )
-				*m_refCount += 1;
+			m_control = rhs.m_control;
 
 			return *this;
 		}
@@ -436,19 +620,16 @@ namespace t
 
 		[[nodiscard]] constexpr T* get()
 		{
-			if ( m_data == nullptr || m_refCount == nullptr )
-				return m_data;
-
-			if ( *m_refCount == 1 )
+			if ( isUnique() )
 				return m_data;
 
-			auto cpy = *m_data;
+			// copy into a fresh block before letting go of the shared one
+			auto block = new details::InlineControlBlock< T >( *m_data );
 
-			*m_refCount -= 1;
-
-			m_refCount = new uint64( 1 );
+			DestroyData();
 
-			m_data = new T( std::move( cpy ) );
+			m_control = block;
+			m_data = block->get();
 
 			return m_data;
 		}
@@ -467,9 +648,9 @@ namespace t
 
 		[[nodiscard]] constexpr bool isUnique() const noexcept
 		{
-			if ( m_data == nullptr || m_refCount == nullptr )
+			if ( m_data == nullptr || m_control == nullptr )
 				return true;
-			return *m_refCount == 1;
+			return m_control->refCount() == 1;
 		}
 
 		[[nodiscard]] constexpr bool isShared() const noexcept
@@ -477,36 +658,372 @@ namespace t
 			return !isUnique();
 		}
 
+		[[nodiscard]] constexpr uint64 useCount() const noexcept
+		{
+			return m_control ? m_control->refCount() : 0;
+		}
+
 	private:
 		constexpr void DestroyData()
 		{
-			if ( m_refCount == nullptr )
-				return;
+			if ( m_control && m_control->release() )
+				delete m_control;
+
+			m_data = nullptr;
+			m_control = nullptr;
+		}
+	private:
+		T* m_data = nullptr;
+		details::ControlBlock* m_control = nullptr;
+	};
+
+	template< class T >
+	class ImmutableSharedPtr< T[] >
+	{
+		ImmutableSharedPtr() = delete;
+	};
+
+	namespace details
+	{
+		template< class T >
+		class WeakPtrBase
+		{
+		protected:
+			using ValueType = type::remove_array< T >;
+		protected:
+			constexpr WeakPtrBase() = default;
+
+			template< class U >
+			constexpr WeakPtrBase( SharedPtrBase< U > const& ptr ) noexcept:
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
+			{
+				if ( m_control )
+					m_control->addWeakRef();
+			}
+
+			constexpr WeakPtrBase( ImmutableSharedPtr< T > const& ptr ) noexcept:
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
+			{
+				if ( m_control )
+					m_control->addWeakRef();
+			}
+
+			constexpr WeakPtrBase( WeakPtrBase const& ptr ) noexcept:
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
+			{
+				if ( m_control )
+					m_control->addWeakRef();
+			}
+
+			constexpr WeakPtrBase( WeakPtrBase&& ptr ) noexcept:
+				m_data( ptr.m_data ),
+				m_control( ptr.m_control )
+			{
+				ptr.m_data = nullptr;
+				ptr.m_control = nullptr;
+			}
+
+			constexpr void operator=( WeakPtrBase const& rhs ) noexcept
+			{
+				if ( this == &rhs )
+					return;
+
+				if ( rhs.m_control )
+					rhs.m_control->addWeakRef();
+
+				DestroyData();
+
+				m_data = rhs.m_data;
+				m_control = rhs.m_control;
+			}
+
+			constexpr void operator=( WeakPtrBase&& rhs ) noexcept
+			{
+				if ( this == &rhs )
+					return;
 
-			*m_refCount -= 1;
+				DestroyData();
+
+				m_data = rhs.m_data;
+				m_control = rhs.m_control;
+
+				rhs.m_data = nullptr;
+				rhs.m_control = nullptr;
+			}
+		public:
+			constexpr ~WeakPtrBase() { DestroyData(); }
+
+			/*
+			 * Returns true if the observed object has been destroyed (or there never was one)
+			 */
+			[[nodiscard]] constexpr bool expired() const noexcept
+			{
+				return m_control == nullptr || m_control->refCount() == 0;
+			}
+
+			[[nodiscard]] constexpr uint64 useCount() const noexcept
+			{
+				return m_control ? m_control->refCount() : 0;
+			}
+
+			constexpr void reset() noexcept { DestroyData(); }
+		protected:
+			/*
+			 * Returns a new strong owner of the object, or an empty one if it has expired
+			 */
+			template< class Ptr >
+			[[nodiscard]] constexpr Ptr Lock() const noexcept
+			{
+				Ptr ptr;
+
+				if ( m_control && m_control->tryAddRef() )
+				{
+					ptr.m_data = m_data;
+					ptr.m_control = m_control;
+				}
+
+				return ptr;
+			}
 
-			if ( *m_refCount )
+			constexpr void DestroyData() noexcept
 			{
-				m_refCount = nullptr;
+				if ( m_control && m_control->releaseWeak() )
+					delete m_control;
+
 				m_data = nullptr;
-				return;
+				m_control = nullptr;
 			}
-			
-			delete m_refCount;
-			delete m_data;
+		protected:
+			ValueType* m_data = nullptr;
+			ControlBlock* m_control = nullptr;
+		};
+	}
 
-			m_data = nullptr;
-			m_refCount = nullptr;
+	/*
+	 * Non-owning reference to an object owned by SharedPtrs.
+	 * Does not keep the object alive, but can be upgraded to a SharedPtr with lock() while it is.
+	 */
+	template< class T >
+	class WeakPtr : public details::WeakPtrBase< T >
+	{
+	private:
+		using BaseType = details::WeakPtrBase< T >;
+	public:
+		constexpr WeakPtr() = default;
+
+		template< class U, class = type::enable_if< std::is_convertible_v< U*, T* > || type::is_same< U, T > > >
+		constexpr WeakPtr( SharedPtr< U > const& ptr ) noexcept:
+			BaseType( ptr ) {}
+
+		constexpr WeakPtr( WeakPtr const& ptr ) noexcept:
+			BaseType( ptr ) {}
+
+		constexpr WeakPtr( WeakPtr&& ptr ) noexcept:
+			BaseType( std::move( ptr ) ) {}
+
+		constexpr WeakPtr& operator=( WeakPtr const& rhs ) noexcept
+		{
+			BaseType::operator=( rhs );
+			return *this;
 		}
+
+		constexpr WeakPtr& operator=( WeakPtr&& rhs ) noexcept
+		{
+			BaseType::operator=( std::move( rhs ) );
+			return *this;
+		}
+
+		template< class U, class = type::enable_if< std::is_convertible_v< U*, T* > || type::is_same< U, T > > >
+		constexpr WeakPtr& operator=( SharedPtr< U > const& rhs ) noexcept
+		{
+			BaseType::operator=( WeakPtr( rhs ) );
+			return *this;
+		}
+
+		[[nodiscard]] constexpr SharedPtr< T > lock() const noexcept
+		{
+			return this->template Lock< SharedPtr< T > >();
+		}
+	};
+
+	/*
+	 * Non-owning reference to an object owned by ImmutableSharedPtrs.
+	 * Copies made by a writing owner are not observed, only the object that was referenced at construction.
+	 */
+	template< class T >
+	class ImmutableWeakPtr : public details::WeakPtrBase< T >
+	{
 	private:
-		T* m_data = nullptr;
-		uint64* m_refCount = nullptr;
+		using BaseType = details::WeakPtrBase< T >;
+	public:
+		constexpr ImmutableWeakPtr() = default;
+
+		constexpr ImmutableWeakPtr( ImmutableSharedPtr< T > const& ptr ) noexcept:
+			BaseType( ptr ) {}
+
+		constexpr ImmutableWeakPtr( ImmutableWeakPtr const& ptr ) noexcept:
+			BaseType( ptr ) {}
+
+		constexpr ImmutableWeakPtr( ImmutableWeakPtr&& ptr ) noexcept:
+			BaseType( std::move( ptr ) ) {}
+
+		constexpr ImmutableWeakPtr& operator=( ImmutableWeakPtr const& rhs ) noexcept
+		{
+			BaseType::operator=( rhs );
+			return *this;
+		}
+
+		constexpr ImmutableWeakPtr& operator=( ImmutableWeakPtr&& rhs ) noexcept
+		{
+			BaseType::operator=( std::move( rhs ) );
+			return *this;
+		}
+
+		[[nodiscard]] constexpr ImmutableSharedPtr< T > lock() const noexcept
+		{
+			return this->template Lock< ImmutableSharedPtr< T > >();
+		}
 	};
 
 	template< class T >
-	class ImmutableSharedPtr< T[] >
+	class IntrusivePtr;
+
+	/*
+	 * Base class for types that carry their own reference count.
+	 * Objects deriving from this can be owned by an IntrusivePtr, which needs no control block at all.
+	 */
+	class RefCounted
 	{
-		ImmutableSharedPtr() = delete;
+	public:
+		constexpr RefCounted() = default;
+
+		// the count belongs to the object's identity, so copies start out unowned
+		constexpr RefCounted( RefCounted const& ) noexcept {}
+
+		constexpr RefCounted& operator=( RefCounted const& ) noexcept { return *this; }
+
+		[[nodiscard]] constexpr uint64 refCount() const noexcept { return m_refCount; }
+	protected:
+		constexpr ~RefCounted() = default;
+	private:
+		template< class > friend class IntrusivePtr;
+
+		uint64 m_refCount = 0;
+	};
+
+	template< class T >
+	class IntrusivePtr
+	{
+	public:
+		constexpr IntrusivePtr() = default;
+
+		constexpr IntrusivePtr( T* ptr ) noexcept:
+			m_data( ptr )
+		{
+			AddRef();
+		}
+
+		constexpr IntrusivePtr( IntrusivePtr const& other ) noexcept:
+			m_data( other.m_data )
+		{
+			AddRef();
+		}
+
+		constexpr IntrusivePtr( IntrusivePtr&& other ) noexcept:
+			m_data( other.m_data )
+		{
+			other.m_data = nullptr;
+		}
+
+		constexpr ~IntrusivePtr()
+		{
+			DestroyData();
+		}
+
+		constexpr IntrusivePtr& operator=( IntrusivePtr const& rhs )
+		{
+			if ( &rhs == this )
+				return *this;
+
+			auto old = m_data;
+			m_data = rhs.m_data;
+			AddRef();
+			Release( old );
+
+			return *this;
+		}
+
+		constexpr IntrusivePtr& operator=( IntrusivePtr&& rhs ) noexcept
+		{
+			if ( &rhs == this )
+				return *this;
+
+			DestroyData();
+
+			m_data = rhs.m_data;
+			rhs.m_data = nullptr;
+
+			return *this;
+		}
+
+		constexpr IntrusivePtr& operator=( T* ptr )
+		{
+			auto old = m_data;
+			m_data = ptr;
+			AddRef();
+			Release( old );
+
+			return *this;
+		}
+
+		[[nodiscard]] constexpr T* get() const noexcept { return m_data; }
+
+		[[nodiscard]] constexpr T* operator->() const noexcept { return m_data; }
+
+		[[nodiscard]] constexpr T& operator*() const noexcept { return *m_data; }
+
+		[[nodiscard]] constexpr auto operator<=>( IntrusivePtr const& rhs ) const noexcept { return m_data <=> rhs.m_data; }
+
+		[[nodiscard]] constexpr bool operator==( IntrusivePtr const& rhs ) const noexcept { return m_data == rhs.m_data; }
+		[[nodiscard]] constexpr bool operator==( std::nullptr_t ) const noexcept { return m_data == nullptr; }
+		[[nodiscard]] constexpr bool operator!=( std::nullptr_t ) const noexcept { return m_data != nullptr; }
+
+		[[nodiscard]] constexpr operator bool() const noexcept { return m_data != nullptr; }
+
+		[[nodiscard]] constexpr bool isUnique() const noexcept
+		{
+			return m_data == nullptr || m_data->RefCounted::m_refCount == 1;
+		}
+
+		[[nodiscard]] constexpr bool isShared() const noexcept
+		{
+			return !isUnique();
+		}
+	private:
+		constexpr void AddRef() noexcept
+		{
+			if ( m_data )
+				++m_data->RefCounted::m_refCount;
+		}
+
+		static constexpr void Release( T* ptr )
+		{
+			static_assert( std::is_base_of_v< RefCounted, T >, "IntrusivePtr requires T to derive from t::RefCounted" );
+
+			if ( ptr && --ptr->RefCounted::m_refCount == 0 )
+				delete ptr;
+		}
+
+		constexpr void DestroyData()
+		{
+			Release( m_data );
+			m_data = nullptr;
+		}
+	private:
+		T* m_data = nullptr;
 	};
 
 	template< class T, class... Args, class = type::enable_if< !type::is_array< T > > >
@@ -525,10 +1042,13 @@ namespace t
 		return ptr;
 	}
 
+	/*
+	 * Creates the object and its reference count with a single allocation
+	 */
 	template< class T, class... Args, class = std::enable_if_t< !type::is_array< T > > >
 	[[nodiscard]] constexpr SharedPtr< T > make_shared( Args&&... args )
 	{
-		return SharedPtr< T >( new T( std::forward< Args >( args )... ) );
+		return SharedPtr< T >( new details::InlineControlBlock< T >( std::forward< Args >( args )... ), details::AdoptBlock{} );
 	}
 
 	template< class T, class = std::enable_if_t< type::is_array< T > > >
@@ -541,9 +1061,18 @@ namespace t
 		return ptr;
 	}
 
+	/*
+	 * Same single allocation as make_shared, for a pointer that only gives const access
+	 */
 	template< class T, class... Args >
 	[[nodiscard]] constexpr ImmutableSharedPtr< T > make_immutable_shared( Args&&... args )
 	{
-		return ImmutableSharedPtr< T >( new T( std::forward< Args >( args  )... ) );
+		return ImmutableSharedPtr< T >( new details::InlineControlBlock< T >( std::forward< Args >( args  )... ), details::AdoptBlock{} );
+	}
+
+	template< class T, class... Args >
+	[[nodiscard]] constexpr IntrusivePtr< T > make_intrusive( Args&&... args )
+	{
+		return IntrusivePtr< T >( new T( std::forward< Args >( args )... ) );
 	}
 }
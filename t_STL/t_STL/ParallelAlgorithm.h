@@ -0,0 +1,834 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+
+#include "Algorithm.h"
+#include "Array.h"
+#include "ThreadPool.h"
+
+// lets the compiler vectorize a loop without proving its iterations independent
+#if defined( __clang__ )
+#define T_STL_UNSEQUENCED_LOOP _Pragma( "clang loop vectorize( enable )" )
+#elif defined( __GNUC__ )
+#define T_STL_UNSEQUENCED_LOOP _Pragma( "GCC ivdep" )
+#elif defined( _MSC_VER )
+#define T_STL_UNSEQUENCED_LOOP __pragma( loop( ivdep ) )
+#else
+#define T_STL_UNSEQUENCED_LOOP
+#endif
+
+namespace t
+{
+	namespace execution
+	{
+		/*
+		 * Runs the algorithm on the calling thread, in order
+		 */
+		struct SequencedPolicy {};
+
+		/*
+		 * Splits the range into chunks run on a thread pool. The functions passed
+		 * in are called from several threads at once, in no particular order
+		 */
+		struct ParallelPolicy
+		{
+			ThreadPool* pool = nullptr;
+
+			/*
+			 * The same policy, run on pool rather than ThreadPool::shared()
+			 */
+			constexpr ParallelPolicy on( ThreadPool& threads ) const { return { &threads }; }
+		};
+
+		/*
+		 * As ParallelPolicy, and the calls within a chunk may also be interleaved,
+		 * so they must not synchronize with each other
+		 */
+		struct ParallelUnsequencedPolicy
+		{
+			ThreadPool* pool = nullptr;
+
+			constexpr ParallelUnsequencedPolicy on( ThreadPool& threads ) const { return { &threads }; }
+		};
+
+		inline constexpr SequencedPolicy seq {};
+		inline constexpr ParallelPolicy par {};
+		inline constexpr ParallelUnsequencedPolicy parUnseq {};
+
+		template< class T >
+		concept Policy = std::same_as< T, SequencedPolicy > || std::same_as< T, ParallelPolicy > || std::same_as< T, ParallelUnsequencedPolicy >;
+	}
+
+	namespace details::algorithm
+	{
+		// below this many elements the extra passes of a parallel sort cost more than they save
+		constexpr int64 ParallelSortCutoff = 1 << 16;
+
+		/*
+		 * Blocks the range is cut into per thread. Threads claim blocks as they
+		 * go, so one that is held up does not hold the rest of the sort back
+		 */
+		constexpr uint64 BlocksPerThread = 4;
+
+		// samples drawn per bucket when choosing splitters
+		constexpr uint64 SampleOversampling = 16;
+
+		constexpr uint64 MaxSplitters = 255;
+
+		struct Blocks
+		{
+			uint64 count;
+			int64 size;
+
+			constexpr int64 first( uint64 block, int64 total ) const
+			{
+				return std::min( int64( block ) * size, total );
+			}
+
+			constexpr int64 last( uint64 block, int64 total ) const
+			{
+				return std::min( int64( block + 1 ) * size, total );
+			}
+		};
+
+		inline Blocks makeBlocks( int64 size, ThreadPool const& pool )
+		{
+			uint64 const count = pool.threadCount() * BlocksPerThread;
+			return { count, ( size + int64( count ) - 1 ) / int64( count ) };
+		}
+
+		/*
+		 * Bucket of value among the sorted, unique splitters. Values equal to a
+		 * splitter get a bucket of their own, which needs no sorting, so runs of
+		 * equal elements cannot pile up in one bucket
+		 */
+		template< class T, class Func >
+		uint64 classify( T const& value, Array< T > const& splitters, Func& comp )
+		{
+			uint64 low = 0;
+			uint64 count = splitters.size();
+
+			while ( count > 0 )
+			{
+				auto const half = count / 2;
+
+				if ( comp( splitters[ low + half ], value ) )
+				{
+					low += half + 1;
+					count -= half + 1;
+				}
+				else
+				{
+					count = half;
+				}
+			}
+
+			bool const equal = low < splitters.size() && !comp( value, splitters[ low ] );
+
+			return 2 * low + equal;
+		}
+
+		// fewest elements worth handing to another thread
+		constexpr int64 ParallelGrainSize = 1 << 14;
+
+		template< class Policy >
+		ThreadPool& poolOf( Policy const& policy )
+		{
+			return policy.pool ? *policy.pool : ThreadPool::shared();
+		}
+
+		/*
+		 * Division of [0, total) into count chunks of size elements, the last
+		 * possibly shorter. No chunk is empty
+		 */
+		struct Chunks
+		{
+			int64 count;
+			int64 size;
+			int64 total;
+
+			constexpr int64 first( int64 chunk ) const
+			{
+				return chunk * size;
+			}
+
+			constexpr int64 last( int64 chunk ) const
+			{
+				return std::min( ( chunk + 1 ) * size, total );
+			}
+		};
+
+		inline Chunks makeChunks( ThreadPool const& pool, int64 const total )
+		{
+			if ( total <= 0 )
+				return { 0, 0, 0 };
+
+			auto const target = std::min( int64( pool.threadCount() * BlocksPerThread ), ( total + ParallelGrainSize - 1 ) / ParallelGrainSize );
+			auto const size = ( total + target - 1 ) / target;
+
+			return { ( total + size - 1 ) / size, size, total };
+		}
+
+		/*
+		 * Calls func( chunk, first, last ) for every chunk, on the pool's threads.
+		 * Chunks are claimed in order, so earlier chunks start first
+		 */
+		template< class Func >
+		void forEachChunk( ThreadPool& pool, Chunks const& chunks, Func&& func )
+		{
+			if ( chunks.count == 1 )
+			{
+				func( int64( 0 ), int64( 0 ), chunks.total );
+				return;
+			}
+
+			pool.parallelFor( uint64( chunks.count ), [ & ]( uint64 chunk )
+			{
+				func( int64( chunk ), chunks.first( int64( chunk ) ), chunks.last( int64( chunk ) ) );
+			} );
+		}
+
+		/*
+		 * Calls func( first, last ) over chunks covering [0, size), on the pool's threads
+		 */
+		template< class Func >
+		void forEachChunk( ThreadPool& pool, int64 const size, Func&& func )
+		{
+			forEachChunk( pool, makeChunks( pool, size ), [ & ]( int64, int64 first, int64 last )
+			{
+				func( first, last );
+			} );
+		}
+
+		template< class Policy, class Func >
+		void forEachIndex( Policy const& policy, int64 const size, Func&& func )
+		{
+			forEachChunk( poolOf( policy ), size, [ & ]( int64 first, int64 last )
+			{
+				if constexpr ( std::same_as< Policy, execution::ParallelUnsequencedPolicy > )
+				{
+					T_STL_UNSEQUENCED_LOOP
+					for ( int64 i = first; i < last; ++i )
+						func( i );
+				}
+				else
+				{
+					for ( int64 i = first; i < last; ++i )
+						func( i );
+				}
+			} );
+		}
+
+		/*
+		 * Index of the first element matching pred, or size. Every chunk gives up
+		 * once a match has been found before it, so the search stops early
+		 */
+		template< class Policy, class It, class Func >
+		int64 findIndex( Policy const& policy, It const begin, int64 const size, Func& pred )
+		{
+			// how often a chunk checks whether it can give up
+			constexpr int64 CheckInterval = 1024;
+
+			std::atomic< int64 > found = size;
+
+			forEachChunk( poolOf( policy ), size, [ & ]( int64 first, int64 last )
+			{
+				for ( int64 i = first; i < last; ++i )
+				{
+					if ( ( i - first ) % CheckInterval == 0 && i >= found.load( std::memory_order_relaxed ) )
+						return;
+
+					if ( pred( *( begin + i ) ) )
+					{
+						auto current = found.load( std::memory_order_relaxed );
+
+						while ( i < current && !found.compare_exchange_weak( current, i, std::memory_order_relaxed ) );
+
+						return;
+					}
+				}
+			} );
+
+			return found.load();
+		}
+
+		/*
+		 * Every chunk reduces its elements on its own, and the chunk results are
+		 * combined in order
+		 */
+		template< class It, class T, class Func >
+		T parallelReduce( ThreadPool& pool, It const begin, int64 const size, T init, Func& op )
+		{
+			auto const chunks = makeChunks( pool, size );
+
+			if ( chunks.count <= 1 )
+				return details::algorithm::reduce( begin, begin + size, init, op );
+
+			Array< T > partials( uint64( chunks.count ) );
+
+			forEachChunk( pool, chunks, [ & ]( int64 chunk, int64 first, int64 last )
+			{
+				partials[ chunk ] = details::algorithm::reduce( begin + ( first + 1 ), begin + last, T( *( begin + first ) ), op );
+			} );
+
+			for ( auto const& partial : partials )
+				init = op( init, partial );
+
+			return init;
+		}
+
+		/*
+		 * Two-pass scan: the first pass totals every chunk, the totals are scanned
+		 * to give every chunk the sum it starts from, and the second pass scans the
+		 * chunks independently. op only needs to be associative. init is unused by
+		 * inclusive scans
+		 */
+		template< class It, class DestIt, class T, class Func >
+		DestIt parallelScan( ThreadPool& pool, It const begin, int64 const size, DestIt const dest, T init, Func& op, bool const inclusive )
+		{
+			auto const chunks = makeChunks( pool, size );
+
+			if ( chunks.count <= 1 )
+			{
+				if ( inclusive )
+					return t::inclusiveScan( begin, begin + size, dest, op );
+
+				return t::exclusiveScan( begin, begin + size, dest, std::move( init ), op );
+			}
+
+			// starts[ chunk ] is the sum of everything before the chunk
+			Array< T > starts( uint64( chunks.count ) );
+
+			forEachChunk( pool, chunks, [ & ]( int64 chunk, int64 first, int64 last )
+			{
+				if ( chunk + 1 == chunks.count )
+					return;
+
+				T sum = *( begin + first );
+
+				for ( int64 i = first + 1; i < last; ++i )
+					sum = op( sum, *( begin + i ) );
+
+				starts[ chunk + 1 ] = std::move( sum );
+			} );
+
+			if ( !inclusive )
+				starts[ 0 ] = std::move( init );
+
+			for ( int64 chunk = inclusive ? 2 : 1; chunk < chunks.count; ++chunk )
+				starts[ chunk ] = op( starts[ chunk - 1 ], starts[ chunk ] );
+
+			forEachChunk( pool, chunks, [ & ]( int64 chunk, int64 first, int64 last )
+			{
+				if ( inclusive && chunk == 0 )
+					t::inclusiveScan( begin + first, begin + last, dest + first, op );
+				else
+					details::algorithm::scan( begin + first, begin + last, dest + first, starts[ chunk ], op, inclusive );
+			} );
+
+			return dest + size;
+		}
+
+		/*
+		 * Every chunk counts into a histogram of its own, and the histograms are
+		 * then summed bin by bin
+		 */
+		template< class It, class Func >
+		Array< uint64 > parallelHistogram( ThreadPool& pool, It const begin, int64 const size, uint64 const bins, Func& binOf )
+		{
+			auto const chunks = makeChunks( pool, size );
+
+			Array< uint64 > counts( bins );
+
+			for ( auto& count : counts )
+				count = 0;
+
+			if ( chunks.count <= 1 )
+			{
+				details::algorithm::histogram( begin, begin + size, counts.data(), bins, binOf );
+				return counts;
+			}
+
+			Array< uint64 > local( uint64( chunks.count ) * bins );
+
+			forEachChunk( pool, chunks, [ & ]( int64 chunk, int64 first, int64 last )
+			{
+				auto* const chunkCounts = local.data() + uint64( chunk ) * bins;
+
+				for ( uint64 bin = 0; bin < bins; ++bin )
+					chunkCounts[ bin ] = 0;
+
+				details::algorithm::histogram( begin + first, begin + last, chunkCounts, bins, binOf );
+			} );
+
+			forEachChunk( pool, int64( bins ), [ & ]( int64 first, int64 last )
+			{
+				for ( int64 chunk = 0; chunk < chunks.count; ++chunk )
+				{
+					auto const* const chunkCounts = local.data() + uint64( chunk ) * bins;
+
+					for ( int64 bin = first; bin < last; ++bin )
+						counts[ bin ] += chunkCounts[ bin ];
+				}
+			} );
+
+			return counts;
+		}
+
+		/*
+		 * Samplesort: splitters drawn from a sorted sample divide the range into
+		 * buckets, every block counts and then scatters its elements into their
+		 * buckets in parallel, and the buckets are sorted independently
+		 */
+		template< class It, class Func >
+		void parallelSort( It begin, It const end, Func& comp, ThreadPool& pool )
+		{
+			using ValueType = type::decay< decltype( *begin ) >;
+
+			int64 const size = end - begin;
+
+			if ( pool.threadCount() == 1 || size < ParallelSortCutoff )
+			{
+				details::algorithm::sort( begin, end, comp );
+				return;
+			}
+
+			uint64 const bucketTarget = std::min( pool.threadCount() * BlocksPerThread, MaxSplitters + 1 );
+			uint64 const sampleCount = bucketTarget * SampleOversampling;
+			int64 const stride = size / int64( sampleCount );
+
+			Array< ValueType > samples( sampleCount );
+			uint64 state = uint64( size );
+
+			for ( uint64 i = 0; i < sampleCount; ++i )
+			{
+				state = state * 6364136223846793005ull + 1442695040888963407ull;
+				samples[ i ] = *( begin + int64( i ) * stride + int64( ( state >> 33 ) % uint64( stride ) ) );
+			}
+
+			details::algorithm::sort( samples.begin(), samples.end(), comp );
+
+			Array< ValueType > splitters;
+			splitters.reserve( bucketTarget - 1 );
+
+			for ( uint64 i = 1; i < bucketTarget; ++i )
+			{
+				auto const& candidate = samples[ i * SampleOversampling ];
+
+				if ( splitters.size() == 0 || comp( splitters[ splitters.size() - 1 ], candidate ) )
+					splitters.pushBack( candidate );
+			}
+
+			uint64 const bucketCount = 2 * splitters.size() + 1;
+
+			auto const blocks = makeBlocks( size, pool );
+
+			Array< uint16 > buckets( static_cast< uint64 >( size ) );
+			Array< uint64 > offsets( blocks.count * bucketCount );
+
+			pool.parallelFor( blocks.count, [ & ]( uint64 block )
+			{
+				auto* count = offsets.data() + block * bucketCount;
+
+				for ( uint64 b = 0; b < bucketCount; ++b )
+					count[ b ] = 0;
+
+				for ( int64 i = blocks.first( block, size ); i < blocks.last( block, size ); ++i )
+				{
+					auto const bucket = classify( *( begin + i ), splitters, comp );
+					buckets[ uint64( i ) ] = uint16( bucket );
+					++count[ bucket ];
+				}
+			} );
+
+			// each block's share of a bucket follows the previous block's, which keeps the scatter stable
+			Array< uint64 > bucketStart( bucketCount + 1 );
+			uint64 total = 0;
+
+			for ( uint64 b = 0; b < bucketCount; ++b )
+			{
+				bucketStart[ b ] = total;
+
+				for ( uint64 block = 0; block < blocks.count; ++block )
+				{
+					auto& offset = offsets[ block * bucketCount + b ];
+					auto const count = offset;
+					offset = total;
+					total += count;
+				}
+			}
+
+			bucketStart[ bucketCount ] = total;
+
+			Array< ValueType > scratch( static_cast< uint64 >( size ) );
+
+			pool.parallelFor( blocks.count, [ & ]( uint64 block )
+			{
+				auto* offset = offsets.data() + block * bucketCount;
+
+				for ( int64 i = blocks.first( block, size ); i < blocks.last( block, size ); ++i )
+					scratch[ offset[ buckets[ uint64( i ) ] ]++ ] = std::move( *( begin + i ) );
+			} );
+
+			pool.parallelFor( bucketCount, [ & ]( uint64 b )
+			{
+				auto const first = int64( bucketStart[ b ] );
+				auto const last = int64( bucketStart[ b + 1 ] );
+
+				// odd buckets hold elements equal to a splitter
+				if ( b % 2 == 0 )
+					details::algorithm::sort( scratch.begin() + first, scratch.begin() + last, comp );
+
+				for ( int64 i = first; i < last; ++i )
+					*( begin + i ) = std::move( scratch[ uint64( i ) ] );
+			} );
+		}
+
+		/*
+		 * Blocks count the digits of their elements in parallel, are scattered in
+		 * parallel by the highest digit the elements disagree on, and the 256
+		 * buckets that leaves are radix sorted independently
+		 */
+		template< class It, class KeyFunc >
+		void parallelRadixSort( It begin, It const end, KeyFunc& key, ThreadPool& pool )
+		{
+			using ValueType = type::decay< decltype( *begin ) >;
+			using Bits = decltype( radixBits( key( *begin ) ) );
+
+			constexpr uint64 Digits = sizeof( Bits );
+
+			int64 const size = end - begin;
+
+			if ( pool.threadCount() == 1 || size < ParallelSortCutoff )
+			{
+				details::algorithm::radixSort( begin, end, key );
+				return;
+			}
+
+			auto const blocks = makeBlocks( size, pool );
+
+			Array< uint64 > counts( blocks.count * Digits * 256 );
+
+			pool.parallelFor( blocks.count, [ & ]( uint64 block )
+			{
+				auto* count = counts.data() + block * Digits * 256;
+
+				for ( uint64 i = 0; i < Digits * 256; ++i )
+					count[ i ] = 0;
+
+				for ( int64 i = blocks.first( block, size ); i < blocks.last( block, size ); ++i )
+				{
+					auto const bits = radixBits( key( *( begin + i ) ) );
+
+					for ( uint64 d = 0; d < Digits; ++d )
+						++count[ d * 256 + uint8( bits >> ( d * 8 ) ) ];
+				}
+			} );
+
+			auto const totalOf = [ & ]( uint64 digit, uint64 bucket )
+			{
+				uint64 total = 0;
+
+				for ( uint64 block = 0; block < blocks.count; ++block )
+					total += counts[ ( block * Digits + digit ) * 256 + bucket ];
+
+				return total;
+			};
+
+			// the highest digit the elements disagree on
+			uint64 top = Digits - 1;
+
+			while ( top != 0 && totalOf( top, radixDigit( begin, key, top ) ) == uint64( size ) )
+				--top;
+
+			uint64 bucketStart[ 257 ];
+			uint64 total = 0;
+
+			for ( uint64 b = 0; b < 256; ++b )
+			{
+				bucketStart[ b ] = total;
+
+				for ( uint64 block = 0; block < blocks.count; ++block )
+				{
+					auto& offset = counts[ ( block * Digits + top ) * 256 + b ];
+					auto const count = offset;
+					offset = total;
+					total += count;
+				}
+			}
+
+			bucketStart[ 256 ] = total;
+
+			Array< ValueType > scratch( static_cast< uint64 >( size ) );
+
+			pool.parallelFor( blocks.count, [ & ]( uint64 block )
+			{
+				auto* offset = counts.data() + ( block * Digits + top ) * 256;
+
+				for ( int64 i = blocks.first( block, size ); i < blocks.last( block, size ); ++i )
+					scratch[ offset[ radixDigit( begin + i, key, top ) ]++ ] = std::move( *( begin + i ) );
+			} );
+
+			pool.parallelFor( 256, [ & ]( uint64 b )
+			{
+				auto const first = int64( bucketStart[ b ] );
+				radixSortBucket< Digits >( scratch.begin() + first, begin + first, int64( bucketStart[ b + 1 ] ) - first, top, key );
+			} );
+		}
+	}
+
+	/**
+	 * Sorts the range on the threads of pool. comp is called from several
+	 * threads at once. Elements must be default constructible, as a buffer
+	 * the size of the range is allocated. Small ranges are sorted with t::sort
+	 */
+	template< class It, class Func >
+	void parallelSort( It begin, It const end, Func comp, ThreadPool& pool = ThreadPool::shared() )
+	{
+		details::algorithm::parallelSort( begin, end, comp, pool );
+	}
+
+	template< class T, class Func >
+	void parallelSort( T& container, Func comp, ThreadPool& pool = ThreadPool::shared() )
+	{
+		details::algorithm::parallelSort( begin( container ), end( container ), comp, pool );
+	}
+
+	/**
+	 * Stable radix sort on the threads of pool, for integer and floating point
+	 * keys. key is called from several threads at once
+	 */
+	template< class It, class KeyFunc >
+		requires std::invocable< KeyFunc&, decltype( *std::declval< It >() ) >
+	void parallelRadixSort( It begin, It const end, KeyFunc key, ThreadPool& pool = ThreadPool::shared() )
+	{
+		details::algorithm::parallelRadixSort( begin, end, key, pool );
+	}
+
+	template< class It >
+	void parallelRadixSort( It begin, It const end, ThreadPool& pool = ThreadPool::shared() )
+	{
+		auto key = []( auto const& elem ) { return elem; };
+		details::algorithm::parallelRadixSort( begin, end, key, pool );
+	}
+
+	template< class T, class KeyFunc >
+		requires std::invocable< KeyFunc&, decltype( *std::declval< T& >().begin() ) >
+	void parallelRadixSort( T& container, KeyFunc key, ThreadPool& pool = ThreadPool::shared() )
+	{
+		details::algorithm::parallelRadixSort( begin( container ), end( container ), key, pool );
+	}
+
+	template< class T >
+	void parallelRadixSort( T& container, ThreadPool& pool = ThreadPool::shared() )
+	{
+		parallelRadixSort( begin( container ), end( container ), pool );
+	}
+
+	/**
+	 * Calls func on every element of the range. Under a parallel policy the
+	 * range must be random access
+	 */
+	template< execution::Policy Policy, class It, class Func >
+	void forEach( Policy const& policy, It begin, It const end, Func func )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			forEach( begin, end, func );
+		else
+			details::algorithm::forEachIndex( policy, end - begin, [ & ]( int64 i ) { func( *( begin + i ) ); } );
+	}
+
+	template< execution::Policy Policy, class T, class Func >
+	void forEach( Policy const& policy, T& container, Func func )
+	{
+		forEach( policy, begin( container ), end( container ), func );
+	}
+
+	/**
+	 * Writes func( element ) for every element of the source to the destination
+	 */
+	template< execution::Policy Policy, class SourceIt, class DestIt, class Func >
+	void transform( Policy const& policy, SourceIt srcBegin, SourceIt const srcEnd, DestIt destBegin, Func func )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			transform( srcBegin, srcEnd, destBegin, func );
+		else
+			details::algorithm::forEachIndex( policy, srcEnd - srcBegin, [ & ]( int64 i ) { *( destBegin + i ) = func( *( srcBegin + i ) ); } );
+	}
+
+	/**
+	 * Writes func( element1, element2 ) for every pair of elements of the sources to the destination
+	 */
+	template< execution::Policy Policy, class SourceIt1, class SourceIt2, class DestIt, class Func >
+	void transform( Policy const& policy, SourceIt1 begin1, SourceIt1 const end1, SourceIt2 begin2, DestIt destBegin, Func func )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			transform( begin1, end1, begin2, destBegin, func );
+		else
+			details::algorithm::forEachIndex( policy, end1 - begin1, [ & ]( int64 i ) { *( destBegin + i ) = func( *( begin1 + i ), *( begin2 + i ) ); } );
+	}
+
+	/**
+	 * Finds the first element of the range for which condition returns true,
+	 * or end. Parallel searches stop once a match has been found
+	 */
+	template< execution::Policy Policy, class It, class Func >
+	It findIf( Policy const& policy, It begin, It const end, Func condition )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			return findIf( begin, end, condition );
+		else
+			return begin + details::algorithm::findIndex( policy, begin, end - begin, condition );
+	}
+
+	template< execution::Policy Policy, class T, class Func >
+	auto findIf( Policy const& policy, T& container, Func condition )
+	{
+		return findIf( policy, begin( container ), end( container ), condition );
+	}
+
+	template< execution::Policy Policy, class It, class Comp >
+	It find( Policy const& policy, It begin, It const end, Comp const& val )
+	{
+		return findIf( policy, begin, end, [ &val ]( auto const& elem ) { return elem == val; } );
+	}
+
+	template< execution::Policy Policy, class T, class Comp >
+	auto find( Policy const& policy, T& container, Comp const& val )
+	{
+		return find( policy, begin( container ), end( container ), val );
+	}
+
+	template< execution::Policy Policy, class It, class T >
+	void replace( Policy const& policy, It begin, It const end, T const& toReplace, T const& newValue )
+	{
+		forEach( policy, begin, end, [ & ]( auto& elem )
+		{
+			if ( elem == toReplace )
+				elem = newValue;
+		} );
+	}
+
+	template< execution::Policy Policy, class T, class U >
+	void replace( Policy const& policy, T& container, U const& toReplace, U const& newValue )
+	{
+		replace( policy, begin( container ), end( container ), toReplace, newValue );
+	}
+
+	template< execution::Policy Policy, class It, class Func, class T >
+	void replaceIf( Policy const& policy, It begin, It const end, Func condition, T const& newValue )
+	{
+		forEach( policy, begin, end, [ & ]( auto& elem )
+		{
+			if ( condition( elem ) )
+				elem = newValue;
+		} );
+	}
+
+	template< execution::Policy Policy, class T, class Func, class U >
+	void replaceIf( Policy const& policy, T& container, Func condition, U const& newValue )
+	{
+		replaceIf( policy, begin( container ), end( container ), condition, newValue );
+	}
+
+	/**
+	 * Combines init and every element of the range with op, which must be
+	 * associative and commutative. Under a parallel policy the range must be
+	 * random access
+	 */
+	template< execution::Policy Policy, class It, class T, class Func >
+	T reduce( Policy const& policy, It begin, It const end, T init, Func op )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			return reduce( begin, end, init, op );
+		else
+			return details::algorithm::parallelReduce( details::algorithm::poolOf( policy ), begin, end - begin, init, op );
+	}
+
+	template< execution::Policy Policy, class It, class T >
+	T reduce( Policy const& policy, It begin, It const end, T init )
+	{
+		return reduce( policy, begin, end, init, []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+	}
+
+	template< execution::Policy Policy, class C, class T, class Func >
+		requires std::invocable< Func&, T, T >
+	T reduce( Policy const& policy, C const& container, T init, Func op )
+	{
+		return reduce( policy, begin( container ), end( container ), init, op );
+	}
+
+	template< execution::Policy Policy, class C, class T >
+	T reduce( Policy const& policy, C const& container, T init )
+	{
+		return reduce( policy, begin( container ), end( container ), init );
+	}
+
+	/**
+	 * Writes the running totals of the range under op to dest. Parallel scans
+	 * read the input twice and only need op to be associative
+	 */
+	template< execution::Policy Policy, class It, class DestIt, class Func >
+	DestIt inclusiveScan( Policy const& policy, It begin, It const end, DestIt dest, Func op )
+	{
+		using ValueType = type::decay< decltype( *begin ) >;
+
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			return inclusiveScan( begin, end, dest, op );
+		else
+			return details::algorithm::parallelScan( details::algorithm::poolOf( policy ), begin, end - begin, dest, ValueType(), op, true );
+	}
+
+	template< execution::Policy Policy, class It, class DestIt >
+	DestIt inclusiveScan( Policy const& policy, It begin, It const end, DestIt dest )
+	{
+		return inclusiveScan( policy, begin, end, dest, []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+	}
+
+	template< execution::Policy Policy, class It, class DestIt, class T, class Func >
+	DestIt exclusiveScan( Policy const& policy, It begin, It const end, DestIt dest, T init, Func op )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			return exclusiveScan( begin, end, dest, std::move( init ), op );
+		else
+			return details::algorithm::parallelScan( details::algorithm::poolOf( policy ), begin, end - begin, dest, std::move( init ), op, false );
+	}
+
+	template< execution::Policy Policy, class It, class DestIt, class T >
+	DestIt exclusiveScan( Policy const& policy, It begin, It const end, DestIt dest, T init )
+	{
+		return exclusiveScan( policy, begin, end, dest, std::move( init ), []( auto const& lhs, auto const& rhs ) { return lhs + rhs; } );
+	}
+
+	/**
+	 * Counts how many elements fall in each of bins bins, binOf( element ) giving
+	 * the bin. Parallel histograms use a table of counts per chunk
+	 */
+	template< execution::Policy Policy, class It, class Func >
+	Array< uint64 > histogram( Policy const& policy, It begin, It const end, uint64 const bins, Func binOf )
+	{
+		if constexpr ( std::same_as< Policy, execution::SequencedPolicy > )
+			return histogram( begin, end, bins, binOf );
+		else
+			return details::algorithm::parallelHistogram( details::algorithm::poolOf( policy ), begin, end - begin, bins, binOf );
+	}
+
+	template< execution::Policy Policy, class It >
+	Array< uint64 > histogram( Policy const& policy, It begin, It const end, uint64 const bins )
+	{
+		return histogram( policy, begin, end, bins, []( auto const elem ) { return elem; } );
+	}
+
+	template< execution::Policy Policy, class C, class Func >
+	Array< uint64 > histogram( Policy const& policy, C const& container, uint64 const bins, Func binOf )
+	{
+		return histogram( policy, begin( container ), end( container ), bins, binOf );
+	}
+
+	template< execution::Policy Policy, class C >
+	Array< uint64 > histogram( Policy const& policy, C const& container, uint64 const bins )
+	{
+		return histogram( policy, begin( container ), end( container ), bins );
+	}
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <utility>
+
+#include "Array.h"
+#include "Error.h"
+#include "Pair.h"
+
+namespace t
+{
+	namespace details::heap
+	{
+		struct Less
+		{
+			template< class T >
+			constexpr bool operator()( T const& lhs, T const& rhs ) const { return lhs < rhs; }
+		};
+
+		// heaps whose elements do not need to know where they are
+		struct NoPositions
+		{
+			template< class T >
+			constexpr void operator()( T const&, uint64 ) const {}
+		};
+
+		/*
+		 * The child that comes first of the node whose children start at first.
+		 * The children are next to each other, so this is one pass over a cache
+		 * line or so
+		 */
+		template< uint64 Arity, class T, class Cmp >
+		constexpr uint64 firstChild( T const* data, uint64 const first, uint64 const size, Cmp& comp )
+		{
+			uint64 best = 0;
+
+			if ( first + Arity <= size )
+			{
+				// every child is there, so the loop has a fixed length and unrolls
+				for ( uint64 child = 1; child < Arity; ++child )
+					best = comp( data[ first + child ], data[ first + best ] ) ? child : best;
+			}
+			else
+			{
+				for ( uint64 child = 1; first + child < size; ++child )
+					best = comp( data[ first + child ], data[ first + best ] ) ? child : best;
+			}
+
+			return first + best;
+		}
+
+		/*
+		 * Heap of Arity children per node in [data, data + size), with every node
+		 * coming no later than its children when sorted by comp. moved is told each
+		 * slot an element is written to
+		 */
+		template< uint64 Arity, class T, class Cmp, class Moved >
+		constexpr void siftUp( T* data, uint64 index, Cmp& comp, Moved& moved )
+		{
+			auto value = std::move( data[ index ] );
+
+			while ( index > 0 )
+			{
+				auto const parent = ( index - 1 ) / Arity;
+
+				if ( !comp( value, data[ parent ] ) )
+					break;
+
+				data[ index ] = std::move( data[ parent ] );
+				moved( data[ index ], index );
+				index = parent;
+			}
+
+			data[ index ] = std::move( value );
+			moved( data[ index ], index );
+		}
+
+		template< uint64 Arity, class T, class Cmp, class Moved >
+		constexpr void siftDown( T* data, uint64 index, uint64 const size, Cmp& comp, Moved& moved )
+		{
+			auto value = std::move( data[ index ] );
+
+			while ( true )
+			{
+				auto const first = Arity * index + 1;
+
+				if ( first >= size )
+					break;
+
+				auto const best = firstChild< Arity >( data, first, size, comp );
+
+				if ( !comp( data[ best ], value ) )
+					break;
+
+				data[ index ] = std::move( data[ best ] );
+				moved( data[ index ], index );
+				index = best;
+			}
+
+			data[ index ] = std::move( value );
+			moved( data[ index ], index );
+		}
+
+		/*
+		 * Refills slot index with the value already in it, which came from the
+		 * bottom of the heap and most likely belongs back there. The hole goes all
+		 * the way down without comparing against the value, and the value then
+		 * climbs back up, which saves about half of siftDown's comparisons
+		 */
+		template< uint64 Arity, class T, class Cmp, class Moved >
+		constexpr void refill( T* data, uint64 index, uint64 const size, Cmp& comp, Moved& moved )
+		{
+			auto value = std::move( data[ index ] );
+
+			while ( true )
+			{
+				auto const first = Arity * index + 1;
+
+				if ( first >= size )
+					break;
+
+				auto const best = firstChild< Arity >( data, first, size, comp );
+
+				data[ index ] = std::move( data[ best ] );
+				moved( data[ index ], index );
+				index = best;
+			}
+
+			data[ index ] = std::move( value );
+			siftUp< Arity >( data, index, comp, moved );
+		}
+
+		// Floyd's bottom up construction, linear in size
+		template< uint64 Arity, class T, class Cmp >
+		constexpr void heapify( T* data, uint64 const size, Cmp& comp )
+		{
+			if ( size < 2 )
+				return;
+
+			NoPositions positions;
+
+			// every node from the parent of the last one back to the root
+			for ( auto i = ( size - 2 ) / Arity + 1; i-- > 0; )
+				siftDown< Arity >( data, i, size, comp, positions );
+		}
+	}
+
+	/*
+	 * Heap backed by an Array. top() is the element that would come first if the
+	 * elements were sorted with Cmp, so the default gives the smallest. Arity is
+	 * the number of children per node: 4 halves the depth of a binary heap, so
+	 * pop visits half as many cache lines, each holding all of a node's children
+	 */
+	template< class T, class Cmp = details::heap::Less, uint64 Arity = 2 >
+	class PriorityQueue
+	{
+		static_assert( Arity >= 2, "PriorityQueue needs at least 2 children per node!" );
+	public:
+		using ValueType = T;
+		using SizeType  = uint64;
+	public:
+		constexpr PriorityQueue() = default;
+
+		constexpr explicit PriorityQueue( Cmp comp ):
+			m_comp( std::move( comp ) ) {}
+
+		// takes over the elements and orders them into a heap in linear time
+		constexpr explicit PriorityQueue( Array< T > elements, Cmp comp = Cmp{} ):
+			m_comp( std::move( comp ) )
+		{
+			heapify( std::move( elements ) );
+		}
+
+		constexpr uint64 size() const { return m_heap.size(); }
+
+		constexpr bool isEmpty() const { return m_heap.isEmpty(); }
+
+		constexpr void reserve( uint64 const capacity ) { m_heap.reserve( capacity ); }
+
+		constexpr T const& top() const
+		{
+			if ( isEmpty() )
+				throw Error( "Empty PriorityQueue!", 1 );
+
+			return m_heap[ 0 ];
+		}
+
+		constexpr void push( T const& value )
+		{
+			m_heap.pushBack( value );
+			siftUp( m_heap.size() - 1 );
+		}
+
+		constexpr void push( T&& value )
+		{
+			m_heap.pushBack( std::move( value ) );
+			siftUp( m_heap.size() - 1 );
+		}
+
+		// removes and returns the top element
+		constexpr T pop()
+		{
+			if ( isEmpty() )
+				throw Error( "Empty PriorityQueue!", 1 );
+
+			auto top = std::move( m_heap[ 0 ] );
+			auto& last = m_heap.pop();
+
+			if ( !isEmpty() )
+			{
+				m_heap[ 0 ] = std::move( last );
+				details::heap::NoPositions positions;
+
+				// wider nodes make every extra level refill walks down cost more than the comparisons it saves
+				if constexpr ( Arity == 2 )
+					details::heap::refill< Arity >( m_heap.data(), 0, m_heap.size(), m_comp, positions );
+				else
+					details::heap::siftDown< Arity >( m_heap.data(), 0, m_heap.size(), m_comp, positions );
+			}
+
+			return top;
+		}
+
+		// replaces the contents with the elements, ordered into a heap in linear time
+		constexpr void heapify( Array< T > elements )
+		{
+			m_heap = std::move( elements );
+			details::heap::heapify< Arity >( m_heap.data(), m_heap.size(), m_comp );
+		}
+
+		constexpr void clear() { m_heap = Array< T >(); }
+	private:
+		constexpr void siftUp( uint64 const index )
+		{
+			details::heap::NoPositions positions;
+			details::heap::siftUp< Arity >( m_heap.data(), index, m_comp, positions );
+		}
+	private:
+		Array< T > m_heap;
+		Cmp m_comp {};
+	};
+
+	template< class T, class Cmp = details::heap::Less >
+	using QuaternaryPriorityQueue = PriorityQueue< T, Cmp, 4 >;
+
+	/*
+	 * Priority queue of values keyed by ids in [0, capacity), where each id is
+	 * queued at most once. It keeps the heap slot of every id, so the value of a
+	 * queued id can be moved up with decreaseKey or taken out with erase in
+	 * logarithmic time, as schedulers and graph searches need
+	 */
+	template< class T, class Cmp = details::heap::Less, uint64 Arity = 4 >
+	class IndexedPriorityQueue
+	{
+		static_assert( Arity >= 2, "IndexedPriorityQueue needs at least 2 children per node!" );
+
+		struct Entry
+		{
+			T value {};
+			uint64 id = 0;
+		};
+	public:
+		using ValueType = T;
+		using SizeType  = uint64;
+	public:
+		constexpr explicit IndexedPriorityQueue( uint64 const capacity, Cmp comp = Cmp{} ):
+			m_positions( capacity ),
+			m_comp( std::move( comp ) )
+		{
+			for ( auto& position : m_positions )
+				position = NotQueued;
+		}
+
+		constexpr uint64 size() const { return m_heap.size(); }
+
+		constexpr bool isEmpty() const { return m_heap.isEmpty(); }
+
+		constexpr uint64 capacity() const { return m_positions.size(); }
+
+		constexpr bool contains( uint64 const id ) const
+		{
+			return id < capacity() && m_positions[ id ] != NotQueued;
+		}
+
+		constexpr T const& value( uint64 const id ) const
+		{
+			return m_heap[ position( id ) ].value;
+		}
+
+		constexpr T const& top() const
+		{
+			if ( isEmpty() )
+				throw Error( "Empty IndexedPriorityQueue!", 1 );
+
+			return m_heap[ 0 ].value;
+		}
+
+		constexpr uint64 topId() const
+		{
+			if ( isEmpty() )
+				throw Error( "Empty IndexedPriorityQueue!", 1 );
+
+			return m_heap[ 0 ].id;
+		}
+
+		constexpr void push( uint64 const id, T value )
+		{
+			if ( id >= capacity() )
+				throw Error( "Id out of range!", 1 );
+
+			if ( m_positions[ id ] != NotQueued )
+				throw Error( "Id is already queued!", 1 );
+
+			m_heap.pushBack( Entry{ std::move( value ), id } );
+			siftUp( m_heap.size() - 1 );
+		}
+
+		// removes the top element, returning its id and value
+		constexpr pair< uint64, T > pop()
+		{
+			if ( isEmpty() )
+				throw Error( "Empty IndexedPriorityQueue!", 1 );
+
+			auto const id = m_heap[ 0 ].id;
+			auto value = std::move( m_heap[ 0 ].value );
+			remove( 0 );
+
+			return { id, std::move( value ) };
+		}
+
+		// gives a queued id a value that comes no later than its current one
+		constexpr void decreaseKey( uint64 const id, T value )
+		{
+			auto const index = position( id );
+
+			if ( m_comp( m_heap[ index ].value, value ) )
+				throw Error( "decreaseKey cannot move an element back!", 1 );
+
+			m_heap[ index ].value = std::move( value );
+			siftUp( index );
+		}
+
+		constexpr void erase( uint64 const id )
+		{
+			remove( position( id ) );
+		}
+	private:
+		static constexpr uint64 NotQueued = ~uint64( 0 );
+
+		constexpr uint64 position( uint64 const id ) const
+		{
+			if ( !contains( id ) )
+				throw Error( "Id is not queued!", 1 );
+
+			return m_positions[ id ];
+		}
+
+		// fills the slot with the last entry, which can belong above or below it
+		constexpr void remove( uint64 const index )
+		{
+			m_positions[ m_heap[ index ].id ] = NotQueued;
+
+			auto& last = m_heap.pop();
+
+			if ( index == m_heap.size() )
+				return;
+
+			m_heap[ index ] = std::move( last );
+
+			if ( index > 0 && m_comp( m_heap[ index ].value, m_heap[ ( index - 1 ) / Arity ].value ) )
+				siftUp( index );
+			else
+				siftDown( index );
+		}
+
+		constexpr void siftUp( uint64 const index )
+		{
+			auto comp = entryComp();
+			auto positions = tracker();
+			details::heap::siftUp< Arity >( m_heap.data(), index, comp, positions );
+		}
+
+		constexpr void siftDown( uint64 const index )
+		{
+			auto comp = entryComp();
+			auto positions = tracker();
+			details::heap::siftDown< Arity >( m_heap.data(), index, m_heap.size(), comp, positions );
+		}
+
+		constexpr auto entryComp()
+		{
+			return [ this ]( Entry const& lhs, Entry const& rhs ) { return m_comp( lhs.value, rhs.value ); };
+		}
+
+		constexpr auto tracker()
+		{
+			return [ this ]( Entry const& entry, uint64 const index ) { m_positions[ entry.id ] = index; };
+		}
+	private:
+		Array< Entry > m_heap;
+		Array< uint64 > m_positions;
+		Cmp m_comp {};
+	};
+}
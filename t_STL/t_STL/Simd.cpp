@@ -0,0 +1,371 @@
+#include "Simd.h"
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define T_STL_SIMD_X86 1
+#else
+#define T_STL_SIMD_X86 0
+#endif
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+#define T_STL_SIMD_VECTORS 1
+#define T_STL_SIMD_INLINE inline __attribute__(( always_inline ))
+#else
+#define T_STL_SIMD_VECTORS 0
+#define T_STL_SIMD_INLINE inline
+#endif
+
+namespace t
+{
+	namespace details::simd
+	{
+		namespace
+		{
+			// bytes looked at per step: two AVX2 or four SSE2 registers
+			constexpr uint64 StepSize = 64;
+
+			// baseline vector width, SSE2 on x86-64
+			constexpr uint64 BaseWidth = 16;
+
+			constexpr uint64 Avx2Width = 32;
+
+#if T_STL_SIMD_VECTORS
+			/*
+			 * The kernels are written with the compiler's vector types, Width bytes
+			 * wide, so they compile to the same vector code at any optimization
+			 * level for whatever instruction set the caller is built for
+			 */
+			template< class T, uint64 Width >
+			struct Vectors
+			{
+				typedef T Vector __attribute__(( vector_size( Width ) ));
+
+				// lanes of all ones where a comparison holds
+				using Mask = decltype( Vector{} == Vector{} );
+
+				static constexpr uint64 Lanes = Width / sizeof( T );
+
+				static constexpr uint64 PerStep = StepSize / Width;
+
+				// vectors are not passed by value, as that depends on the instruction set
+				static T_STL_SIMD_INLINE void load( Vector& vector, T const* data )
+				{
+					__builtin_memcpy( &vector, data, sizeof( vector ) );
+				}
+
+				static T_STL_SIMD_INLINE void broadcast( Vector& vector, T value )
+				{
+					for ( uint64 i = 0; i < Lanes; ++i )
+						vector[ i ] = value;
+				}
+
+				static T_STL_SIMD_INLINE bool any( Mask const& mask )
+				{
+					uint64 words[ Width / sizeof( uint64 ) ];
+					__builtin_memcpy( words, &mask, sizeof( words ) );
+
+					uint64 bits = 0;
+
+					for ( uint64 i = 0; i < Width / sizeof( uint64 ); ++i )
+						bits |= words[ i ];
+
+					return bits != 0;
+				}
+			};
+
+			template< class T, uint64 Width >
+			T_STL_SIMD_INLINE uint64 findKernel( T const* data, uint64 const size, T const value )
+			{
+				using V = Vectors< T, Width >;
+
+				typename V::Vector needle;
+				V::broadcast( needle, value );
+
+				uint64 i = 0;
+
+				for ( ; i + V::Lanes * V::PerStep <= size; i += V::Lanes * V::PerStep )
+				{
+					typename V::Mask hit {};
+
+					for ( uint64 v = 0; v < V::PerStep; ++v )
+					{
+						typename V::Vector elems;
+						V::load( elems, data + i + v * V::Lanes );
+						hit |= elems == needle;
+					}
+
+					if ( V::any( hit ) )
+						break;
+				}
+
+				for ( ; i < size; ++i )
+				{
+					if ( data[ i ] == value )
+						return i;
+				}
+
+				return size;
+			}
+
+			template< class T, uint64 Width >
+			T_STL_SIMD_INLINE uint64 countKernel( T const* data, uint64 const size, T const value )
+			{
+				using V = Vectors< T, Width >;
+
+				// steps counted before signed 8-bit lanes could overflow
+				constexpr uint64 FlushSteps = 128;
+
+				typename V::Vector needle;
+				V::broadcast( needle, value );
+
+				typename V::Mask counts[ V::PerStep ] = {};
+				uint64 total = 0;
+				uint64 steps = 0;
+				uint64 i = 0;
+
+				auto const flush = [ & ]()
+				{
+					for ( uint64 v = 0; v < V::PerStep; ++v )
+					{
+						for ( uint64 lane = 0; lane < V::Lanes; ++lane )
+							total -= counts[ v ][ lane ];
+
+						counts[ v ] = typename V::Mask{};
+					}
+				};
+
+				for ( ; i + V::Lanes * V::PerStep <= size; i += V::Lanes * V::PerStep )
+				{
+					// matches are -1, so subtracting them counts up
+					for ( uint64 v = 0; v < V::PerStep; ++v )
+					{
+						typename V::Vector elems;
+						V::load( elems, data + i + v * V::Lanes );
+						counts[ v ] += elems == needle;
+					}
+
+					if ( ++steps == FlushSteps )
+					{
+						flush();
+						steps = 0;
+					}
+				}
+
+				flush();
+
+				for ( ; i < size; ++i )
+					total += data[ i ] == value;
+
+				return total;
+			}
+
+			/*
+			 * Every lane starts from the first element and only takes strictly smaller
+			 * or larger values, as a scalar loop would, so NaNs after the first element
+			 * are skipped either way
+			 */
+			template< class T, uint64 Width >
+			T_STL_SIMD_INLINE void minMaxKernel( T const* data, uint64 const size, T& min, T& max )
+			{
+				using V = Vectors< T, Width >;
+
+				typename V::Vector mins[ V::PerStep ];
+				typename V::Vector maxs[ V::PerStep ];
+
+				for ( uint64 v = 0; v < V::PerStep; ++v )
+				{
+					V::broadcast( mins[ v ], data[ 0 ] );
+					maxs[ v ] = mins[ v ];
+				}
+
+				uint64 i = 0;
+
+				for ( ; i + V::Lanes * V::PerStep <= size; i += V::Lanes * V::PerStep )
+				{
+					for ( uint64 v = 0; v < V::PerStep; ++v )
+					{
+						typename V::Vector elems;
+						V::load( elems, data + i + v * V::Lanes );
+						mins[ v ] = elems < mins[ v ] ? elems : mins[ v ];
+						maxs[ v ] = maxs[ v ] < elems ? elems : maxs[ v ];
+					}
+				}
+
+				min = data[ 0 ];
+				max = data[ 0 ];
+
+				for ( uint64 v = 0; v < V::PerStep; ++v )
+				{
+					for ( uint64 lane = 0; lane < V::Lanes; ++lane )
+					{
+						min = mins[ v ][ lane ] < min ? mins[ v ][ lane ] : min;
+						max = max < maxs[ v ][ lane ] ? maxs[ v ][ lane ] : max;
+					}
+				}
+
+				for ( ; i < size; ++i )
+				{
+					min = data[ i ] < min ? data[ i ] : min;
+					max = max < data[ i ] ? data[ i ] : max;
+				}
+			}
+
+			template< class T, uint64 Width >
+			T_STL_SIMD_INLINE bool equalKernel( T const* lhs, T const* rhs, uint64 const size )
+			{
+				using V = Vectors< T, Width >;
+
+				uint64 i = 0;
+
+				for ( ; i + V::Lanes * V::PerStep <= size; i += V::Lanes * V::PerStep )
+				{
+					typename V::Mask differ {};
+
+					for ( uint64 v = 0; v < V::PerStep; ++v )
+					{
+						typename V::Vector left;
+						typename V::Vector right;
+						V::load( left, lhs + i + v * V::Lanes );
+						V::load( right, rhs + i + v * V::Lanes );
+						differ |= left != right;
+					}
+
+					if ( V::any( differ ) )
+						return false;
+				}
+
+				for ( ; i < size; ++i )
+				{
+					if ( lhs[ i ] != rhs[ i ] )
+						return false;
+				}
+
+				return true;
+			}
+#else
+			template< class T, uint64 >
+			uint64 findKernel( T const* data, uint64 const size, T const value )
+			{
+				for ( uint64 i = 0; i < size; ++i )
+				{
+					if ( data[ i ] == value )
+						return i;
+				}
+
+				return size;
+			}
+
+			template< class T, uint64 >
+			uint64 countKernel( T const* data, uint64 const size, T const value )
+			{
+				uint64 total = 0;
+
+				for ( uint64 i = 0; i < size; ++i )
+					total += data[ i ] == value;
+
+				return total;
+			}
+
+			template< class T, uint64 >
+			void minMaxKernel( T const* data, uint64 const size, T& min, T& max )
+			{
+				min = data[ 0 ];
+				max = data[ 0 ];
+
+				for ( uint64 i = 1; i < size; ++i )
+				{
+					min = data[ i ] < min ? data[ i ] : min;
+					max = max < data[ i ] ? data[ i ] : max;
+				}
+			}
+
+			template< class T, uint64 >
+			bool equalKernel( T const* lhs, T const* rhs, uint64 const size )
+			{
+				for ( uint64 i = 0; i < size; ++i )
+				{
+					if ( lhs[ i ] != rhs[ i ] )
+						return false;
+				}
+
+				return true;
+			}
+#endif
+
+#if T_STL_SIMD_X86
+			bool hasAvx2()
+			{
+				static bool const supported = __builtin_cpu_supports( "avx2" );
+				return supported;
+			}
+
+			template< class T >
+			__attribute__(( target( "avx2" ) ))
+			uint64 findAvx2( T const* data, uint64 size, T value )
+			{
+				return findKernel< T, Avx2Width >( data, size, value );
+			}
+
+			template< class T >
+			__attribute__(( target( "avx2" ) ))
+			uint64 countAvx2( T const* data, uint64 size, T value )
+			{
+				return countKernel< T, Avx2Width >( data, size, value );
+			}
+
+			template< class T >
+			__attribute__(( target( "avx2" ) ))
+			void minMaxAvx2( T const* data, uint64 size, T& min, T& max )
+			{
+				minMaxKernel< T, Avx2Width >( data, size, min, max );
+			}
+
+			template< class T >
+			__attribute__(( target( "avx2" ) ))
+			bool equalAvx2( T const* lhs, T const* rhs, uint64 size )
+			{
+				return equalKernel< T, Avx2Width >( lhs, rhs, size );
+			}
+
+#define T_STL_SIMD_DISPATCH( kernel, T, ... ) \
+			if ( hasAvx2() ) \
+				return kernel##Avx2< T >( __VA_ARGS__ ); \
+			return kernel##Kernel< T, BaseWidth >( __VA_ARGS__ );
+#else
+#define T_STL_SIMD_DISPATCH( kernel, T, ... ) \
+			return kernel##Kernel< T, BaseWidth >( __VA_ARGS__ );
+#endif
+		}
+
+#define T_STL_SIMD_KERNELS( T ) \
+		uint64 find( T const* data, uint64 size, T value ) \
+		{ \
+			T_STL_SIMD_DISPATCH( find, T, data, size, value ) \
+		} \
+		\
+		uint64 count( T const* data, uint64 size, T value ) \
+		{ \
+			T_STL_SIMD_DISPATCH( count, T, data, size, value ) \
+		} \
+		\
+		void minMax( T const* data, uint64 size, T& min, T& max ) \
+		{ \
+			T_STL_SIMD_DISPATCH( minMax, T, data, size, min, max ) \
+		} \
+		\
+		bool equal( T const* lhs, T const* rhs, uint64 size ) \
+		{ \
+			T_STL_SIMD_DISPATCH( equal, T, lhs, rhs, size ) \
+		}
+
+		T_STL_SIMD_KERNELS( int8 )
+		T_STL_SIMD_KERNELS( uint8 )
+		T_STL_SIMD_KERNELS( int16 )
+		T_STL_SIMD_KERNELS( uint16 )
+		T_STL_SIMD_KERNELS( int32 )
+		T_STL_SIMD_KERNELS( uint32 )
+		T_STL_SIMD_KERNELS( int64 )
+		T_STL_SIMD_KERNELS( uint64 )
+		T_STL_SIMD_KERNELS( float )
+		T_STL_SIMD_KERNELS( double )
+	}
+}
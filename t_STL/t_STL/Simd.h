@@ -0,0 +1,45 @@
+#pragma once
+
+#include <concepts>
+
+#include "Tint.h"
+
+namespace t
+{
+	namespace details::simd
+	{
+		/*
+		 * Element types the vector kernels are compiled for
+		 */
+		template< class T >
+		concept Element = std::same_as< T, int8 > || std::same_as< T, uint8 >
+			|| std::same_as< T, int16 > || std::same_as< T, uint16 >
+			|| std::same_as< T, int32 > || std::same_as< T, uint32 >
+			|| std::same_as< T, int64 > || std::same_as< T, uint64 >
+			|| std::same_as< T, float > || std::same_as< T, double >;
+
+		/*
+		 * Kernels over contiguous elements, run with AVX2 when the CPU has it and
+		 * with the baseline instruction set (SSE2 on x86-64) otherwise. find returns
+		 * size when nothing matches. minMax needs at least one element
+		 */
+#define T_STL_SIMD_KERNELS( T ) \
+		uint64 find( T const* data, uint64 size, T value ); \
+		uint64 count( T const* data, uint64 size, T value ); \
+		void minMax( T const* data, uint64 size, T& min, T& max ); \
+		bool equal( T const* lhs, T const* rhs, uint64 size );
+
+		T_STL_SIMD_KERNELS( int8 )
+		T_STL_SIMD_KERNELS( uint8 )
+		T_STL_SIMD_KERNELS( int16 )
+		T_STL_SIMD_KERNELS( uint16 )
+		T_STL_SIMD_KERNELS( int32 )
+		T_STL_SIMD_KERNELS( uint32 )
+		T_STL_SIMD_KERNELS( int64 )
+		T_STL_SIMD_KERNELS( uint64 )
+		T_STL_SIMD_KERNELS( float )
+		T_STL_SIMD_KERNELS( double )
+
+#undef T_STL_SIMD_KERNELS
+	}
+}
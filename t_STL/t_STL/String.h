@@ -279,6 +279,22 @@ namespace t
 			return *this;
 		}
 
+		/*
+		 * Replaces the contents, reusing the current allocation when it is big enough
+		 */
+		constexpr GenericString& assign( const CharTy* str, SizeType length )
+		{
+			if ( m_capacity >= length && m_data != nullptr )
+			{
+				strcpy( m_data, str, length );
+				m_size = length;
+				m_data[ m_size ] = '\0';
+				return *this;
+			}
+			*this = GenericString( str, length );
+			return *this;
+		}
+
 		constexpr CharTy const* cbegin() const { return m_data; }
 		constexpr CharTy const* cend() const { return m_data + m_size; }
 		constexpr CharTy* begin() { return m_data; }
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "Array.h"
+#include "Tint.h"
+
+namespace t
+{
+	/*
+	 * Fixed set of threads for data parallel loops. The calling thread takes
+	 * part in every loop, so a pool of n threads starts n - 1 workers
+	 */
+	class ThreadPool
+	{
+	public:
+		/*
+		 * 0 uses one thread per hardware thread
+		 */
+		explicit ThreadPool( uint64 threads = 0 )
+		{
+			if ( threads == 0 )
+				threads = std::thread::hardware_concurrency();
+
+			if ( threads == 0 )
+				threads = 1;
+
+			m_workers.reserve( threads - 1 );
+
+			for ( uint64 i = 1; i < threads; ++i )
+				m_workers.pushBack( std::thread( [ this ]() { workerLoop(); } ) );
+		}
+
+		ThreadPool( ThreadPool const& ) = delete;
+		ThreadPool& operator=( ThreadPool const& ) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard lock( m_mutex );
+				m_stopping = true;
+			}
+
+			m_wake.notify_all();
+
+			for ( auto& worker : m_workers )
+				worker.join();
+		}
+
+		/*
+		 * Pool with one thread per hardware thread, started on first use
+		 */
+		static ThreadPool& shared()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+
+		[[nodiscard]] uint64 threadCount() const { return m_workers.size() + 1; }
+
+		/*
+		 * Calls func( i ) for every i in [0, count) and returns once all calls
+		 * have finished. The first exception thrown stops the remaining calls
+		 * and is rethrown here. Loops started from inside a call run serially
+		 */
+		template< class Func >
+		void parallelFor( uint64 count, Func&& func )
+		{
+			if ( m_workers.size() == 0 || count < 2 || s_current == this )
+			{
+				for ( uint64 i = 0; i < count; ++i )
+					func( i );
+				return;
+			}
+
+			std::lock_guard serial( m_loopMutex );
+
+			{
+				std::lock_guard lock( m_mutex );
+				m_loop = const_cast< void* >( static_cast< const void* >( &func ) );
+				m_invoke = []( void* loop, uint64 i )
+				{
+					( *static_cast< std::remove_reference_t< Func >* >( loop ) )( i );
+				};
+				m_count = count;
+				m_next = 0;
+				m_busy = m_workers.size();
+				m_error = nullptr;
+				++m_generation;
+			}
+
+			m_wake.notify_all();
+
+			work();
+
+			std::unique_lock lock( m_mutex );
+			m_done.wait( lock, [ this ]() { return m_busy == 0; } );
+
+			if ( m_error )
+				std::rethrow_exception( std::exchange( m_error, nullptr ) );
+		}
+	private:
+		void workerLoop()
+		{
+			uint64 seen = 0;
+
+			while ( true )
+			{
+				{
+					std::unique_lock lock( m_mutex );
+					m_wake.wait( lock, [ & ]() { return m_stopping || m_generation != seen; } );
+
+					if ( m_stopping )
+						return;
+
+					seen = m_generation;
+				}
+
+				work();
+
+				std::lock_guard lock( m_mutex );
+
+				if ( --m_busy == 0 )
+					m_done.notify_one();
+			}
+		}
+
+		void work()
+		{
+			auto const* previous = s_current;
+			s_current = this;
+
+			while ( true )
+			{
+				auto const i = m_next.fetch_add( 1, std::memory_order_relaxed );
+
+				if ( i >= m_count )
+					break;
+
+				try
+				{
+					m_invoke( m_loop, i );
+				}
+				catch ( ... )
+				{
+					std::lock_guard lock( m_mutex );
+
+					if ( !m_error )
+						m_error = std::current_exception();
+
+					m_next = m_count;
+				}
+			}
+
+			s_current = previous;
+		}
+	private:
+		// the pool whose loop the current thread is running, if any
+		static inline thread_local const ThreadPool* s_current = nullptr;
+
+		Array< std::thread > m_workers;
+		std::mutex m_loopMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		void* m_loop = nullptr;
+		void( *m_invoke )( void*, uint64 ) = nullptr;
+		uint64 m_count = 0;
+		std::atomic< uint64 > m_next = 0;
+		uint64 m_busy = 0;
+		uint64 m_generation = 0;
+		std::exception_ptr m_error;
+		bool m_stopping = false;
+	};
+}
@@ -93,5 +93,25 @@ namespace t
 			using _Arr = details::_TypeArray< 0, Types... >;
 			return details::allUnique< _Arr, _Arr >();
 		}
+
+		/*
+		 * Size in bytes of the largest type
+		 */
+		static consteval uint64 maxSize()
+		{
+			uint64 size = 0;
+			( ( size = sizeof( Types ) > size ? sizeof( Types ) : size ), ... );
+			return size;
+		}
+
+		/*
+		 * Strictest alignment requirement of all the types
+		 */
+		static consteval uint64 maxAlignment()
+		{
+			uint64 alignment = 1;
+			( ( alignment = alignof( Types ) > alignment ? alignof( Types ) : alignment ), ... );
+			return alignment;
+		}
 	};
 }
\ No newline at end of file
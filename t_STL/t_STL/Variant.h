@@ -1,10 +1,14 @@
 #pragma once
 
+#include <new>
+#include <utility>
+
 #include "Type.h"
 #include "Tint.h"
 #include "Tuple.h"
 #include "Error.h"
 #include "TypeArray.h"
+#include "utility.h"
 
 namespace t
 {
@@ -12,100 +16,21 @@ namespace t
 	{
 		namespace variant
 		{
-			using DeleterType = void (*)( void* );
-			using CopyerType  = void* (*)( void const* );
-
-			struct CallBackStruct
-			{
-				DeleterType deleter;
-				CopyerType copyer;
-			};
-
-			template< uint64 _index, typename... Types >
-			struct _Callbacks;
-
-			template< uint64 _index, typename T, typename... Types >
-			struct _Callbacks< _index, T, Types... > : _Callbacks< _index + 1, Types... >
-			{
-				static constexpr uint64 index = _index;
-				using Type = T;
-				using BaseType = _Callbacks< _index + 1, Types... >;
-				static constexpr bool valid = true;
-
-				static constexpr void deleter( void* ptr )
-				{
-					delete static_cast< T* >( ptr );
-				}
-
-				static constexpr void* copyer( void const* ptr )
-				{
-					return new T( *static_cast< T const* >( ptr ) );
-				}
-			};
-
-			template< uint64 _index >
-			struct _Callbacks< _index >
-			{
-				static constexpr bool valid = false;
-			};
-
-			template< typename T, typename _callbacks >
-			constexpr DeleterType getDeleter()
-			{
-				if constexpr ( t::type::is_same< T, _callbacks::Type > )
-				{
-					return &_callbacks::deleter;
-				}
-
-				return getDeleter< T, _callbacks::BaseType >();
-			}
-
-			template< typename T, typename _callbacks >
-			constexpr CopyerType getCopyer()
-			{
-				if constexpr ( t::type::is_same< T, _callbacks::Type > )
-				{
-					return &_callbacks::copyer;
-				}
-
-				return getCopyer< T, _callbacks::BaseType >();
-			}
-
-			template< typename _callbacks >
-			constexpr DeleterType getDeleter( uint64 index )
-			{
-				if constexpr ( _callbacks::valid )
-				{
-					if ( index == _callbacks::index )
-					{
-						return &_callbacks::deleter;
-					}
-
-					return getDeleter< typename _callbacks::BaseType >( index );
-				}
-				else
-				{
-					throw Error( "Bad", 1 );
-				}
-			}
-
-			template< typename _callbacks >
-			constexpr CopyerType getCopyer( uint64 index )
-			{
-				if constexpr ( _callbacks::valid )
-				{
-					if ( index == _callbacks::index )
-					{
-						return &_callbacks::copyer;
-					}
-
-					return getCopyer< typename _callbacks::BaseType >( index );
-				}
-				else
-				{
-					throw Error( "Bad", 1 );
-				}
-			}
+			/*
+			 * Alternatives larger than this many bytes are kept on the heap,
+			 * so that one large type does not blow up every Variant it appears in
+			 */
+			constexpr uint64 InlineSizeThreshold = 32;
+
+			template< typename T >
+			constexpr bool storedInline = sizeof( T ) <= InlineSizeThreshold
+				&& std::is_nothrow_move_constructible_v< T >;
+
+			/*
+			 * What actually lives in the Variant's buffer for an alternative of type T
+			 */
+			template< typename T >
+			using StoredType = t::type::ternary< storedInline< T >, T, T* >;
 		}
 	}
 
@@ -115,19 +40,15 @@ namespace t
 	public:
 		Variant() = default;
 
-		Variant( Variant const& other ):
-			m_ptr( [&](){
-				if ( other.m_typeIndex < NumTypes )
-				{
-					return Callbacks[ other.m_typeIndex ].second( other.m_ptr );
-				}
-				return nullptr;
-			}() ),
-			m_typeIndex( other.m_typeIndex ) {}
+		Variant( Variant const& other )
+		{
+			copyFrom( other );
+		}
 
-		Variant( Variant&& other ) noexcept:
-			m_ptr( t::exchange( other.m_ptr, nullptr ) ),
-			m_typeIndex( t::exchange( other.m_typeIndex, NumTypes ) ) {}
+		Variant( Variant&& other ) noexcept
+		{
+			moveFrom( std::move( other ) );
+		}
 
 		Variant& operator=( Variant const& rhs )
 		{
@@ -137,17 +58,7 @@ namespace t
 			}
 
 			destroyData();
-
-			if ( rhs.m_typeIndex < NumTypes )
-			{
-				m_ptr = Callbacks[ rhs.m_typeIndex ].copyer( rhs.m_ptr );
-			}
-			else
-			{
-				m_ptr = nullptr;
-			}
-
-			m_typeIndex = rhs.m_typeIndex;
+			copyFrom( rhs );
 
 			return *this;
 		}
@@ -160,22 +71,22 @@ namespace t
 			}
 
 			destroyData();
-
-			m_ptr = t::exchange( rhs.m_ptr, nullptr );
-			m_typeIndex = t::exchange( rhs.m_typeIndex, NumTypes );
+			moveFrom( std::move( rhs ) );
 
 			return *this;
 		}
 
 		template< typename T, class = t::type::enable_if< t::type::is_any_of< T, Ts... > > >
-		Variant( T const& val ):
-			m_ptr( make_value< T >( val ) ),
-			m_typeIndex( get_type_index< T >() ) {}
+		Variant( T const& val )
+		{
+			emplace< T >( val );
+		}
 
 		template< typename T, class = t::type::enable_if< t::type::is_any_of< T, Ts... > > >
-		Variant( T&& val ):
-			m_ptr( make_value< T >( std::move( val ) ) ),
-			m_typeIndex( get_type_index< T >() ) {}
+		Variant( T&& val )
+		{
+			emplace< T >( std::move( val ) );
+		}
 
 		template< typename T, class = t::type::enable_if< t::type::is_any_of< T, Ts... > > >
 		Variant& operator=( T const& val )
@@ -207,7 +118,7 @@ namespace t
 				return nullptr;
 			}
 
-			return static_cast< T* >( m_ptr );
+			return get< T >();
 		}
 
 		template< typename T >
@@ -220,60 +131,122 @@ namespace t
 				return nullptr;
 			}
 
-			return static_cast< T const* >( m_ptr );
+			return get< T >();
 		}
 
 	private:
-
-		void destroyData()
+		template< typename T, typename... Args >
+		void emplace( Args&&... args )
 		{
-			if ( m_ptr )
+			if constexpr ( details::variant::storedInline< T > )
 			{
-				Callbacks[ m_typeIndex ].deleter( m_ptr );
-				m_typeIndex = NumTypes;
-				m_ptr = nullptr;
+				new ( m_storage ) T( std::forward< Args >( args )... );
 			}
+			else
+			{
+				new ( m_storage ) T*( new T( std::forward< Args >( args )... ) );
+			}
+
+			m_typeIndex = get_type_index< T >();
 		}
 
-	private:
-		static constexpr uint64 NumTypes = sizeof...(Ts);
+		template< typename T >
+		T* get()
+		{
+			if constexpr ( details::variant::storedInline< T > )
+			{
+				return std::launder( reinterpret_cast< T* >( m_storage ) );
+			}
+			else
+			{
+				return *std::launder( reinterpret_cast< T** >( m_storage ) );
+			}
+		}
 
-		using DeleterType = details::variant::DeleterType;
-		using CopyerType = details::variant::CopyerType;
+		template< typename T >
+		T const* get() const
+		{
+			if constexpr ( details::variant::storedInline< T > )
+			{
+				return std::launder( reinterpret_cast< T const* >( m_storage ) );
+			}
+			else
+			{
+				return *std::launder( reinterpret_cast< T* const* >( m_storage ) );
+			}
+		}
 
-		using CallbackArrayType = t::StaticArray< details::variant::CallBackStruct, NumTypes >;
+		/*
+		 * Calls func with a null pointer of the active alternative's type
+		 */
+		template< typename Func >
+		void visit( Func&& func ) const
+		{
+			visit( std::forward< Func >( func ), std::make_integer_sequence< uint64, NumTypes >() );
+		}
 
-		template< typename T, typename... Args >
-		static void* make_value( Args&&... args )
+		template< typename Func, uint64... Is >
+		void visit( Func&& func, std::integer_sequence< uint64, Is... > ) const
 		{
-			return new T( std::forward< Args >( args )... );
+			( ( m_typeIndex == Is ? ( func( static_cast< Ts* >( nullptr ) ), true ) : false ) || ... );
 		}
 
-		template< typename T >
-		static consteval uint64 get_type_index()
+		void copyFrom( Variant const& other )
 		{
-			return TypeArray< Ts... >::template indexOf< T >();
+			other.visit( [&]< typename T >( T* )
+			{
+				emplace< T >( *other.template get< T >() );
+			} );
 		}
 
-	private:
-		static consteval auto make_callbacks()
+		void moveFrom( Variant&& other ) noexcept
 		{
-			CallbackArrayType callbacks;
+			other.visit( [&]< typename T >( T* )
+			{
+				if constexpr ( details::variant::storedInline< T > )
+				{
+					emplace< T >( std::move( *other.template get< T >() ) );
+					other.destroyData();
+				}
+				else
+				{
+					// just steal the allocation
+					new ( m_storage ) T*( other.template get< T >() );
+					m_typeIndex = t::exchange( other.m_typeIndex, NumTypes );
+				}
+			} );
+		}
 
-			for ( uint64 i = 0; i < NumTypes; ++i )
+		void destroyData()
+		{
+			visit( [&]< typename T >( T* )
 			{
-				using namespace details::variant;
-				callbacks[ i ].deleter = getDeleter< _Callbacks< 0, Ts... > >( i );
-				callbacks[ i ].copyer  = getCopyer< _Callbacks< 0, Ts... > >( i );
-			}
+				if constexpr ( details::variant::storedInline< T > )
+				{
+					get< T >()->~T();
+				}
+				else
+				{
+					delete get< T >();
+				}
+			} );
 
-			return callbacks;
+			m_typeIndex = NumTypes;
 		}
 
-		static inline constexpr CallbackArrayType Callbacks = make_callbacks();
+	private:
+		static constexpr uint64 NumTypes = sizeof...(Ts);
+
+		using StorageTypes = TypeArray< details::variant::StoredType< Ts >... >;
+
+		template< typename T >
+		static consteval uint64 get_type_index()
+		{
+			return TypeArray< Ts... >::template indexOf< T >();
+		}
 
 	private:
-		void* m_ptr = nullptr;
+		alignas( StorageTypes::maxAlignment() ) uint8 m_storage[ StorageTypes::maxSize() ];
 		uint64 m_typeIndex = NumTypes;
 	};
 }
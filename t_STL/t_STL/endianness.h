@@ -1,6 +1,7 @@
 #pragma once
 
 #include <bit>
+#include <type_traits>
 
 #include "Tint.h"
 
@@ -21,6 +22,11 @@ namespace t
 		{
 			return data;
 		}
+		else if constexpr ( std::is_signed_v< T > )
+		{
+			// shifting negative values is not portable, swap the unsigned representation instead
+			return static_cast< T >( byteswap( static_cast< std::make_unsigned_t< T > >( data ) ) );
+		}
 		else if constexpr ( sizeof( T ) == 2 )
 		{
 			return ((data >> 8) & 0xff) | ((data & 0xff) << 8);
@@ -50,6 +56,17 @@ namespace t
 		return std::bit_cast< double >( byteswap( std::bit_cast< uint64 >( data ) ) );
 	}
 
+	/*
+	 * Byte swaps every element of the array.
+	 * Kept as a plain loop over aligned elements so that the compiler can vectorize it
+	 */
+	template< typename T >
+	inline void byteswapInPlace( T* data, uint64 numel )
+	{
+		for ( uint64 i = 0; i < numel; ++i )
+			data[ i ] = byteswap( data[ i ] );
+	}
+
 	static_assert( sizeof( float )  == sizeof( uint32 ) );
 	static_assert( sizeof( double ) == sizeof( uint64 ) );
 }
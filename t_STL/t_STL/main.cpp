@@ -1,10 +1,18 @@
 #include <iostream>
 #include <unordered_map>
+#include <string_view>
 
 #include "t.h"
 #include "variant/serialization/Serialize.h"
 #include "variant/serialization/Deserialize.h"
+#include "variant/serialization/MapView.h"
+#include "variant/serialization/MappedFile.h"
+#include "variant/serialization/Compression.h"
+#include "variant/serialization/Checksum.h"
+#include "variant/serialization/ParallelDeserialize.h"
+#include "variant/serialization/Schema.h"
 #include "Timer.h"
+#include "ParallelAlgorithm.h"
 #include "HashSet.h"
 
 #include "BasicHashMap.h"
@@ -22,6 +30,10 @@
 #include <variant>
 
 #include "Tree.h"
+#include "tests/RuntimeTests.h"
+#include "EytzingerIndex.h"
+#include "PriorityQueue.h"
+#include <queue>
 
 template< typename T >
 void printSizeOf()
@@ -41,6 +53,54 @@ using t::variant::Map;
 using t::String;
 using t::Array;
 
+struct Sample
+{
+    int32 id = 0;
+    uint64 timestamp = 0;
+    double value = 0;
+    String name;
+    Array< float > samples;
+    Array< String > tags;
+};
+
+using SampleSchema = t::variant::Schema< Sample,
+    t::variant::Field< "id", &Sample::id >,
+    t::variant::Field< "timestamp", &Sample::timestamp >,
+    t::variant::Field< "value", &Sample::value >,
+    t::variant::Field< "name", &Sample::name >,
+    t::variant::Field< "samples", &Sample::samples >,
+    t::variant::Field< "tags", &Sample::tags > >;
+
+Sample makeSample( int32 i )
+{
+    Sample sample;
+    sample.id = i;
+    sample.timestamp = 1700000000 + uint64( i );
+    sample.value = i * 0.5;
+    sample.name = "sensor";
+    sample.samples = Array< float >{ 1.f, 2.f, 3.f, float( i ) };
+    sample.tags = Array< String >{ "a", "bb" };
+    return sample;
+}
+
+Map sampleToMap( Sample const& sample )
+{
+    Map map;
+    map["id"] = sample.id;
+    map["timestamp"] = sample.timestamp;
+    map["value"] = sample.value;
+    map["name"] = sample.name;
+    map["samples"] = sample.samples;
+    map["tags"] = sample.tags;
+    return map;
+}
+
+bool operator==( Sample const& lhs, Sample const& rhs )
+{
+    return lhs.id == rhs.id && lhs.timestamp == rhs.timestamp && lhs.value == rhs.value
+        && lhs.name == rhs.name && lhs.samples == rhs.samples && lhs.tags == rhs.tags;
+}
+
 constexpr int testVm()
 {
     Map vm;
@@ -74,17 +134,23 @@ constexpr int testVm()
 
     auto vm2 = Map( vm );
 
-    if ( &vm2.at("int32").As< int32 const& >() != &vm.at("int32").As< int32 const& >() )
+    if ( &vm2.at("string").As< String const& >() != &vm.at("string").As< String const& >() )
         throw std::runtime_error("wornfwr");
 
-    if ( &vm2.at("int32").As< int32& >() == &vm.at("int32").As< int32 const& >() )
+    if ( &vm2.at("string").As< String& >() == &vm.at("string").As< String const& >() )
         throw std::runtime_error("wofnwv");
 
-    if ( &vm2.at("int32").As< int32& >() != &vm2.at("int32").As< int32& >() )
+    if ( &vm2.at("string").As< String& >() != &vm2.at("string").As< String& >() )
         throw std::runtime_error("3ougnrw");
 
+    // scalars are stored inline, so every copy owns its own
+    vm2.at("int32").As< int32& >() = 70;
+
+    if ( vm.at("int32").As< int32 >() != 7 )
+        throw std::runtime_error("scalar was shared");
 
-    return vm2.at("int32").As< int32 >();
+
+    return vm.at("int32").As< int32 >();
 }
 
 t::pair< int64, int64 > testTvm()
@@ -143,6 +209,307 @@ t::pair< int64, int64 > testTvm()
     if ( vm_2 != vm )
         throw std::runtime_error("Maps were not the same");
 
+    {
+        // stream through a buffer smaller than some of the values
+        uint8 scratch[ 32 ];
+        Array< uint8 > streamed( buffer.size() );
+        t::variant::BufferViewSink sink( t::BufferView< uint8 >( streamed.data(), streamed.size() ) );
+
+        t::variant::Serialize( vm, sink, t::BufferView< uint8 >( scratch, sizeof( scratch ) ) );
+
+        if ( sink.bytesWritten() != buffer.size() || streamed != buffer )
+            throw std::runtime_error("Streamed serialization differs");
+
+        uint64 chunks = 0;
+        uint64 total = 0;
+        auto counter = t::variant::CallbackSink( [&]( const uint8*, uint64 size )
+        {
+            ++chunks;
+            total += size;
+        } );
+
+        t::variant::Serialize< t::endianness::big >( vm, counter );
+
+        if ( chunks != 1 || total != buffer.size() )
+            throw std::runtime_error("Streamed serialization was not buffered");
+    }
+
+    {
+        t::variant::MapView view( buffer );
+
+        if ( view.size() != vm.size() || view.contains( "missing" ) )
+            throw std::runtime_error("Map view has the wrong entries");
+
+        if ( String( view.at( "string" ).As< t::StringView >() ) != vm.at( "string" ).As< String const& >() )
+            throw std::runtime_error("Map view read the wrong string");
+
+        if ( view.at( "int32" ).As< int32 >() != vm.at( "int32" ).As< int32 >() )
+            throw std::runtime_error("Map view read the wrong number");
+
+        if ( view.at( "vm" ).As< t::variant::MapView >().at( "test2" ).As< t::StringView >().size() != 6 )
+            throw std::runtime_error("Map view read the wrong nested value");
+
+        auto const u32 = view.at( "u32 vector" );
+
+        if ( u32.canViewArray< uint32 >() && u32.As< t::ArrayView< const uint32 > >()[ 1 ] != 12 )
+            throw std::runtime_error("Map view read the wrong array");
+
+        if ( u32.Materialize() != vm.at( "u32 vector" ) || view.Materialize() != vm )
+            throw std::runtime_error("Map view materialized the wrong values");
+
+        auto big = t::variant::Serialize< t::endianness::big >( vm );
+
+        if ( t::variant::MapView( big ).at( "double vector" ).Materialize() != vm.at( "double vector" ) )
+            throw std::runtime_error("Map view did not swap bytes");
+    }
+
+    for ( bool withIndex : { true, false } )
+    {
+        auto v2 = t::variant::bitstream_v2::Serialize( vm, withIndex );
+        auto v2big = t::variant::bitstream_v2::Serialize< t::endianness::big >( vm, withIndex );
+
+        if ( v2[ 3 ] != 2 || t::variant::Deserialize( v2 ) != vm || t::variant::Deserialize( v2big ) != vm )
+            throw std::runtime_error("bitstream_v2 did not round trip");
+
+        for ( auto const* bytes : { &v2, &v2big } )
+        {
+            t::variant::MapView view( *bytes );
+
+            if ( view.at( "int32" ).As< int32 >() != vm.at( "int32" ).As< int32 >() || view.contains( "missing" ) )
+                throw std::runtime_error("bitstream_v2 view read the wrong value");
+
+            if ( view.at( "vm" ).As< t::variant::MapView >().at( "test" ).Materialize() != t::variant::Value( "value" ) )
+                throw std::runtime_error("bitstream_v2 view read the wrong nested value");
+
+            if ( view.Materialize() != vm )
+                throw std::runtime_error("bitstream_v2 view did not materialize");
+        }
+    }
+
+    {
+        auto const packed = t::variant::compact::Serialize( vm );
+
+        if ( packed.size() != t::variant::compact::SerializedSize( vm ) || t::variant::Deserialize( packed ) != vm )
+            throw std::runtime_error("Compact encoding did not round trip");
+
+        // small records repeating the same keys, where the key dictionary pays off
+        Map records;
+
+        for ( int32 i = 0; i < 100; ++i )
+        {
+            Map record;
+            record["identifier"] = int32( 1000 + i );
+            record["timestamp"] = uint64( 1700000000 + i );
+            record["samples"] = Array< int32 >{ i, i + 1, i + 2, i + 3 };
+            auto const key = std::to_string( i );
+            records[ String( key.c_str(), key.size() ) ] = std::move( record );
+        }
+
+        auto const compactRecords = t::variant::compact::Serialize( records );
+
+        if ( t::variant::Deserialize( compactRecords ) != records )
+            throw std::runtime_error("Compact records did not round trip");
+
+        if ( compactRecords.size() * 3 > t::variant::Serialize( records ).size() )
+            throw std::runtime_error("Compact encoding did not shrink repeated records");
+
+        auto const compressed = t::variant::SerializeCompressed( records );
+
+        if ( t::variant::Deserialize( compressed ) != records || compressed.size() * 2 > t::variant::Serialize( records ).size() )
+            throw std::runtime_error("Compressed serialization did not round trip");
+
+        // feed the frame through in awkward chunk sizes
+        t::variant::ArraySink raw;
+        t::variant::DecompressingSink decompressor( raw );
+
+        for ( uint64 i = 0; i < compressed.size(); i += 7 )
+            decompressor.write( compressed.data() + i, compressed.size() - i < 7 ? compressed.size() - i : 7 );
+
+        if ( !decompressor.finished() || raw.take() != t::variant::Serialize( records ) )
+            throw std::runtime_error("Streaming decompression did not round trip");
+    }
+
+    {
+        const char check[] = "123456789";
+
+        if ( t::variant::Crc32c( reinterpret_cast< const uint8* >( check ), 9 ) != 0xe3069283
+            || t::variant::Crc32c( reinterpret_cast< const uint8* >( check ) + 4, 5, t::variant::Crc32c( reinterpret_cast< const uint8* >( check ), 4 ) ) != 0xe3069283 )
+            throw std::runtime_error("CRC32C is wrong");
+
+        auto checksummed = t::variant::SerializeChecksummed( vm );
+
+        if ( t::variant::Deserialize( checksummed ) != vm )
+            throw std::runtime_error("Checksummed frame did not round trip");
+
+        checksummed[ checksummed.size() / 2 ] ^= 1;
+
+        bool caught = false;
+
+        try
+        {
+            (void)t::variant::Deserialize( checksummed );
+        }
+        catch ( t::Error const& )
+        {
+            caught = true;
+        }
+
+        if ( !caught )
+            throw std::runtime_error("Checksum did not catch corruption");
+
+        // every truncation of a valid map must be rejected rather than read past the end
+        for ( uint64 size = 0; size < buffer.size(); ++size )
+        {
+            bool threw = false;
+
+            try
+            {
+                (void)t::variant::Deserialize( buffer.data(), size );
+            }
+            catch ( t::Error const& )
+            {
+                threw = true;
+            }
+
+            if ( !threw )
+                throw std::runtime_error("Truncated map was accepted");
+        }
+
+        // a chain of maps nested far deeper than any reader allows must be rejected before it exhausts the stack
+        uint64 const levels = 50000;
+        uint64 const headerSize = 4 + sizeof( uint16 ) + sizeof( uint64 );
+        uint64 const entrySize = sizeof( uint32 ) + sizeof( t::variant::Type );
+
+        // every map holds the next one under an empty key, and the innermost map is empty
+        Array< uint8 > deep( levels * ( headerSize + entrySize ) - entrySize );
+
+        for ( uint64 level = 0; level < levels; ++level )
+        {
+            auto* data = deep.data() + level * ( headerSize + entrySize );
+            uint16 const marker = 1;
+            uint64 const numel = level + 1 < levels ? 1 : 0;
+
+            std::memcpy( data, "tvm\1", 4 );
+            std::memcpy( data + 4, &marker, sizeof( marker ) );
+            std::memcpy( data + 6, &numel, sizeof( numel ) );
+
+            if ( numel == 0 )
+                break;
+
+            std::memset( data + headerSize, 0, sizeof( uint32 ) );
+            data[ headerSize + sizeof( uint32 ) ] = uint8( t::variant::Type::MAP );
+        }
+
+        auto const rejectsDeep = []( auto read )
+        {
+            try
+            {
+                read();
+            }
+            catch ( t::Error const& )
+            {
+                return true;
+            }
+
+            return false;
+        };
+
+        if ( !rejectsDeep( [ & ]{ (void)t::variant::Deserialize( deep ); } ) )
+            throw std::runtime_error("Deserialize accepted maps nested too deeply");
+
+        if ( !rejectsDeep( [ & ]{ (void)t::variant::MapView( deep ); } ) )
+            throw std::runtime_error("Map view accepted maps nested too deeply");
+
+        // large enough that the parallel decoder takes it through its pre-scan
+        t::ThreadPool pool( 4 );
+
+        if ( !rejectsDeep( [ & ]{ (void)t::variant::DeserializeParallel( deep, pool ); } ) )
+            throw std::runtime_error("DeserializeParallel accepted maps nested too deeply");
+
+        {
+            auto const path = String( "t_STL_deep_test.tvm" );
+
+            auto* file = std::fopen( path.c_str(), "wb" );
+
+            if ( !file )
+                throw std::runtime_error("Could not create the deep map file");
+
+            auto const written = std::fwrite( deep.data(), 1, deep.size(), file );
+            std::fclose( file );
+
+            if ( written != deep.size() )
+                throw std::runtime_error("Could not write the deep map file");
+
+            t::variant::MappedFile mapped( path );
+            bool const rejected = rejectsDeep( [ & ]{ (void)mapped.view(); } );
+
+            std::remove( path.c_str() );
+
+            if ( !rejected )
+                throw std::runtime_error("Mapped file view accepted maps nested too deeply");
+        }
+    }
+
+    {
+        auto const sample = makeSample( 42 );
+        auto const sampleMap = sampleToMap( sample );
+        auto const encoded = SampleSchema::Serialize( sample );
+
+        if ( encoded.size() != SampleSchema::SerializedSize( sample ) || encoded.size() != t::variant::Serialize( sampleMap ).size() )
+            throw std::runtime_error("Schema serialized to the wrong size");
+
+        if ( t::variant::Deserialize( encoded ) != sampleMap || t::variant::Deserialize( SampleSchema::Serialize< t::endianness::big >( sample ) ) != sampleMap )
+            throw std::runtime_error("Schema output was not a readable map");
+
+        if ( !( SampleSchema::Deserialize( encoded ) == sample )
+            || !( SampleSchema::Deserialize( t::variant::Serialize< t::endianness::big >( sampleMap ) ) == sample )
+            || !( SampleSchema::Deserialize( t::variant::bitstream_v2::Serialize( sampleMap ) ) == sample ) )
+            throw std::runtime_error("Schema did not read a serialized map");
+
+        auto wrongType = sampleMap;
+        wrongType["id"] = int64( 42 );
+        auto const wrongBytes = t::variant::Serialize( wrongType );
+
+        bool threw = false;
+
+        try
+        {
+            (void)SampleSchema::Deserialize( wrongBytes );
+        }
+        catch ( t::Error const& )
+        {
+            threw = true;
+        }
+
+        if ( !threw )
+            throw std::runtime_error("Schema accepted a field of the wrong type");
+    }
+
+    {
+        auto const path = String( "t_STL_snapshot_test.tvm" );
+
+        auto* file = std::fopen( path.c_str(), "wb" );
+
+        if ( !file )
+            throw std::runtime_error("Could not create the snapshot file");
+
+        auto const written = std::fwrite( buffer.data(), 1, buffer.size(), file );
+        std::fclose( file );
+
+        if ( written != buffer.size() )
+            throw std::runtime_error("Could not write the snapshot file");
+
+        auto loaded = t::variant::LoadMap( path );
+
+        t::variant::MappedFile mapped( path, t::variant::AccessPattern::Random );
+        auto const mappedString = mapped.view().at( "string" ).As< t::StringView >().size();
+
+        std::remove( path.c_str() );
+
+        if ( loaded != vm || mapped.size() != buffer.size() || mappedString != 5 )
+            throw std::runtime_error("Mapped snapshot did not load");
+    }
+
     auto val = t::variant::Value( t::move( vm_2 ) );
 
     auto val2 = val.Clone();
@@ -155,6 +522,102 @@ t::pair< int64, int64 > testTvm()
     return { ser, deser };
 }
 
+void benchmarkParallelDeserialize()
+{
+    // one large nested map next to many small top level entries, so both kinds of split are exercised
+    Map payload;
+    Map large;
+
+    for ( int32 i = 0; i < 20000; ++i )
+    {
+        auto key = String( std::to_string( i ).c_str() );
+
+        Map record;
+        record["name"] = key;
+        record["values"] = Array< double >( 16 );
+        record["id"] = int64( i );
+
+        if ( i % 2 == 0 )
+            payload[ std::move( key ) ] = std::move( record );
+        else
+            large[ std::move( key ) ] = std::move( record );
+    }
+
+    payload["large"] = std::move( large );
+
+    for ( bool v2 : { false, true } )
+    {
+        auto const buffer = v2 ? t::variant::bitstream_v2::Serialize( payload ) : t::variant::Serialize( payload );
+
+        std::cout << ( v2 ? "bitstream_v2" : "bitstream_v1" ) << " " << buffer.size() << " bytes\n";
+
+        for ( uint64 threads : { 1, 4, 16 } )
+        {
+            t::ThreadPool pool( threads );
+            Timer< microseconds > t;
+
+            t.start();
+
+            auto const decoded = t::variant::DeserializeParallel( buffer, pool );
+
+            auto const elapsed = t.stop();
+
+            if ( decoded != payload )
+                throw std::runtime_error("Parallel deserialization differs");
+
+            std::cout << "DeserializeParallel, " << threads << " threads: " << elapsed << "uS\n";
+        }
+    }
+}
+
+void benchmarkSchema()
+{
+    constexpr int32 count = 100000;
+
+    auto const sample = makeSample( 7 );
+    auto const map = sampleToMap( sample );
+    auto const buffer = t::variant::Serialize( map );
+
+    Timer< microseconds > t;
+    uint64 bytes = 0;
+
+    t.start();
+
+    for ( int32 i = 0; i < count; ++i )
+        bytes += t::variant::Serialize( map ).size();
+
+    auto const mapEncode = t.stop();
+
+    t.start();
+
+    for ( int32 i = 0; i < count; ++i )
+        bytes += t::variant::Deserialize( buffer ).size();
+
+    auto const mapDecode = t.stop();
+
+    t.start();
+
+    for ( int32 i = 0; i < count; ++i )
+        bytes += SampleSchema::Serialize( sample ).size();
+
+    auto const schemaEncode = t.stop();
+
+    Sample decoded;
+
+    t.start();
+
+    for ( int32 i = 0; i < count; ++i )
+    {
+        SampleSchema::Deserialize( buffer.data(), buffer.size(), decoded );
+        bytes += uint64( decoded.id );
+    }
+
+    auto const schemaDecode = t.stop();
+
+    std::cout << "Map encode: " << mapEncode << "uS, decode: " << mapDecode << "uS\n";
+    std::cout << "Schema encode: " << schemaEncode << "uS, decode: " << schemaDecode << "uS (" << bytes << ")\n";
+}
+
 String generateRandomString()
 {
     String x( "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz" );
@@ -188,41 +651,702 @@ double generateRandom< double >()
     return std::bit_cast< double >( rand );
 }
 
-template< uint64 CountSize, class T >
-void countSort( T* arr, uint64 numel, uint64 shift )
+template< class T, class Generate, class Compare = std::less<> >
+void benchmarkRadixSortOf( const char* name, uint64 numel, Generate generate, Compare comp = {} )
+{
+    auto arr = Array< T >( numel );
+
+    for ( auto& elem : arr )
+        elem = generate();
+
+    auto arrCpy = arr;
+
+    Timer< microseconds > t;
+
+    t.start();
+
+    t::radixSort( arr );
+
+    auto const radixElapsed = t.stop();
+
+    t.start();
+
+    t::sort( arrCpy.data(), arrCpy.data() + arrCpy.size(), comp );
+
+    auto const sortElapsed = t.stop();
+
+    for ( uint64 i = 0; i < numel; ++i )
+    {
+        if ( arr[ i ] != arrCpy[ i ] )
+            throw std::runtime_error( "radixSort disagrees with t::sort" );
+    }
+
+    std::cout << name << " x " << numel << ", t::radixSort: " << radixElapsed << "uS, t::sort: " << sortElapsed << "uS\n";
+}
+
+void benchmarkRadixSort()
+{
+    std::mt19937_64 rng( 42 );
+
+    benchmarkRadixSortOf< uint32 >( "uint32", 8'000'000, [ & ]() { return uint32( rng() ); } );
+    benchmarkRadixSortOf< int64 >( "int64", 8'000'000, [ & ]() { return int64( rng() ); } );
+    benchmarkRadixSortOf< double >( "double", 4'000'000, [ & ]() { return std::bit_cast< double >( rng() >> 2 ) - std::bit_cast< double >( rng() >> 2 ); } );
+    benchmarkRadixSortOf< String >( "String", 200'000, [ & ]()
+    {
+        auto str = String( "key" );
+        str += std::to_string( rng() % 1'000'000 ).c_str();
+        return str;
+    }, []( String const& lhs, String const& rhs )
+    {
+        return std::string_view( lhs.data(), lhs.size() ) < std::string_view( rhs.data(), rhs.size() );
+    } );
+}
+
+void testParallelSort()
+{
+    std::mt19937_64 rng( 7 );
+
+    auto const ascending = []( auto const lhs, auto const rhs ) { return lhs < rhs; };
+
+    for ( uint64 threads : { 1, 3, 4 } )
+    {
+        t::ThreadPool pool( threads );
+
+        // random, few unique and all equal values
+        for ( uint64 modulus : { 0, 10, 1 } )
+        {
+            auto arr = Array< int64 >( 300'000 );
+
+            for ( auto& elem : arr )
+                elem = modulus == 0 ? int64( rng() ) : int64( rng() % modulus );
+
+            auto expected = arr;
+            t::sort( expected.begin(), expected.end(), ascending );
+
+            auto radix = arr;
+
+            t::parallelSort( arr, ascending, pool );
+            t::parallelRadixSort( radix, pool );
+
+            if ( arr != expected || radix != expected )
+                throw std::runtime_error( "parallel sort disagrees with t::sort" );
+        }
+    }
+}
+
+void benchmarkParallelSort()
+{
+    std::mt19937_64 rng( 42 );
+
+    auto input = Array< int64 >( 8'000'000 );
+
+    for ( auto& elem : input )
+        elem = int64( rng() );
+
+    auto const hardwareThreads = uint64( std::max( std::thread::hardware_concurrency(), 1u ) );
+
+    for ( uint64 threads = 1; ; threads *= 2 )
+    {
+        threads = std::min( threads, hardwareThreads );
+
+        t::ThreadPool pool( threads );
+        Timer< microseconds > t;
+
+        auto arr = input;
+
+        t.start();
+        t::parallelSort( arr, []( auto const lhs, auto const rhs ) { return lhs < rhs; }, pool );
+        auto const sortElapsed = t.stop();
+
+        arr = input;
+
+        t.start();
+        t::parallelRadixSort( arr, pool );
+        auto const radixElapsed = t.stop();
+
+        std::cout << threads << " threads, t::parallelSort: " << sortElapsed << "uS, t::parallelRadixSort: " << radixElapsed << "uS\n";
+
+        if ( threads == hardwareThreads )
+            break;
+    }
+}
+
+void benchmarkMerge()
+{
+    std::mt19937_64 rng( 42 );
+
+    auto const ascending = []( auto const lhs, auto const rhs ) { return lhs < rhs; };
+
+    auto arr = Array< int64 >( 4'000'000 );
+
+    for ( auto& elem : arr )
+        elem = int64( rng() % 100'000 );
+
+    auto arrCpy = arr;
+
+    Timer< microseconds > t;
+
+    t.start();
+    t::stableSort( arr, ascending );
+    auto const stableElapsed = t.stop();
+
+    t.start();
+    std::stable_sort( arrCpy.data(), arrCpy.data() + arrCpy.size(), ascending );
+    auto const stdElapsed = t.stop();
+
+    if ( arr != arrCpy )
+        throw std::runtime_error( "stableSort disagrees with std::stable_sort" );
+
+    std::cout << "t::stableSort: " << stableElapsed << "uS, std::stable_sort: " << stdElapsed << "uS\n";
+
+    // 64 sorted shards, as they arrive from workers
+    auto shards = Array< Array< int64 > >( 64 );
+
+    for ( auto& shard : shards )
+    {
+        shard = Array< int64 >( 100'000 );
+
+        for ( auto& elem : shard )
+            elem = int64( rng() );
+
+        t::sort( shard.begin(), shard.end(), ascending );
+    }
+
+    auto merged = Array< int64 >( 64 * 100'000 );
+
+    t.start();
+    t::kwayMerge( shards, merged.begin() );
+    auto const mergeElapsed = t.stop();
+
+    auto concatenated = Array< int64 >( 0 );
+    concatenated.reserve( merged.size() );
+
+    for ( auto const& shard : shards )
+    {
+        for ( auto const elem : shard )
+            concatenated.pushBack( elem );
+    }
+
+    t.start();
+    t::sort( concatenated.begin(), concatenated.end(), ascending );
+    auto const sortElapsed = t.stop();
+
+    if ( merged != concatenated )
+        throw std::runtime_error( "kwayMerge disagrees with t::sort" );
+
+    std::cout << "t::kwayMerge of 64 shards: " << mergeElapsed << "uS, t::sort of all: " << sortElapsed << "uS\n";
+}
+
+void benchmarkSelection()
+{
+    std::mt19937_64 rng( 42 );
+
+    auto input = Array< int64 >( 10'000'000 );
+
+    for ( auto& elem : input )
+        elem = int64( rng() );
+
+    Timer< microseconds > t;
+
+    auto arr = input;
+
+    t.start();
+    t::nthElement( arr.begin(), arr.begin() + int64( arr.size() / 2 ), arr.end() );
+    auto const medianElapsed = t.stop();
+
+    auto const median = arr[ arr.size() / 2 ];
+
+    t.start();
+    auto const top = t::topK( input, 100 );
+    auto const topElapsed = t.stop();
+
+    arr = input;
+
+    t.start();
+    t::sort( arr.begin(), arr.end(), []( auto const lhs, auto const rhs ) { return lhs < rhs; } );
+    auto const sortElapsed = t.stop();
+
+    if ( arr[ arr.size() / 2 ] != median || top[ 0 ] != arr[ arr.size() - 1 ] || top[ 99 ] != arr[ arr.size() - 100 ] )
+        throw std::runtime_error( "selection disagrees with t::sort" );
+
+    std::cout << "t::nthElement median: " << medianElapsed << "uS, t::topK 100: " << topElapsed << "uS, t::sort: " << sortElapsed << "uS\n";
+}
+
+void benchmarkExecutionPolicies()
+{
+    auto input = Array< double >( 20'000'000 );
+
+    for ( uint64 i = 0; i < input.size(); ++i )
+        input[ i ] = double( i );
+
+    auto output = Array< double >( input.size() );
+
+    auto const hardwareThreads = uint64( std::max( std::thread::hardware_concurrency(), 1u ) );
+
+    for ( uint64 threads = 1; ; threads *= 2 )
+    {
+        threads = std::min( threads, hardwareThreads );
+
+        t::ThreadPool pool( threads );
+        Timer< microseconds > t;
+
+        t.start();
+        t::transform( t::execution::parUnseq.on( pool ), input.begin(), input.end(), output.begin(), []( double x ) { return x * 0.5 + 1.0; } );
+        auto const transformElapsed = t.stop();
+
+        t.start();
+        auto const found = t::findIf( t::execution::par.on( pool ), output, []( double x ) { return x >= 5'000'000.0; } );
+        auto const findElapsed = t.stop();
+
+        if ( found - output.begin() != 9'999'998 || output[ 123 ] != 62.5 )
+            throw std::runtime_error( "parallel transform or findIf gave the wrong result" );
+
+        std::cout << threads << " threads, transform: " << transformElapsed << "uS, findIf: " << findElapsed << "uS\n";
+
+        if ( threads == hardwareThreads )
+            break;
+    }
+}
+
+void benchmarkAggregation()
+{
+    auto values = Array< double >( 20'000'000 );
+    auto bytes = Array< uint8 >( values.size() );
+
+    uint64 state = 42;
+
+    for ( uint64 i = 0; i < values.size(); ++i )
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        values[ i ] = double( state >> 54 );
+        // mostly one value, as real columns often are
+        bytes[ i ] = ( state >> 60 ) == 0 ? uint8( state >> 33 ) : uint8( 0 );
+    }
+
+    Timer< microseconds > t;
+
+    t.start();
+    double loopSum = 0;
+    for ( auto const value : values )
+        loopSum += value;
+    auto const loopElapsed = t.stop();
+
+    t.start();
+    auto const sum = t::reduce( values, 0.0 );
+    auto const reduceElapsed = t.stop();
+
+    t.start();
+    auto const parallelSum = t::reduce( t::execution::par, values, 0.0 );
+    auto const parallelReduceElapsed = t.stop();
+
+    if ( sum != loopSum || parallelSum != loopSum )
+        throw std::runtime_error( "reduce gave the wrong sum" );
+
+    std::cout << "reduce, loop: " << loopElapsed << "uS, sequential: " << reduceElapsed << "uS, parallel: " << parallelReduceElapsed << "uS\n";
+
+    auto prefix = Array< double >( values.size() );
+
+    t.start();
+    t::inclusiveScan( values.begin(), values.end(), prefix.begin() );
+    auto const scanElapsed = t.stop();
+
+    auto const lastPrefix = prefix[ prefix.size() - 1 ];
+
+    t.start();
+    t::inclusiveScan( t::execution::par, values.begin(), values.end(), prefix.begin() );
+    auto const parallelScanElapsed = t.stop();
+
+    if ( prefix[ prefix.size() - 1 ] != lastPrefix || lastPrefix != sum )
+        throw std::runtime_error( "parallel inclusiveScan gave the wrong result" );
+
+    std::cout << "inclusiveScan, sequential: " << scanElapsed << "uS, parallel: " << parallelScanElapsed << "uS\n";
+
+    t.start();
+    auto loopCounts = Array< uint64 >( 256 );
+    for ( auto& count : loopCounts )
+        count = 0;
+    for ( auto const byte : bytes )
+        ++loopCounts[ byte ];
+    auto const loopHistogramElapsed = t.stop();
+
+    t.start();
+    auto const counts = t::histogram( bytes, 256 );
+    auto const histogramElapsed = t.stop();
+
+    t.start();
+    auto const parallelCounts = t::histogram( t::execution::par, bytes, 256 );
+    auto const parallelHistogramElapsed = t.stop();
+
+    if ( counts != loopCounts || parallelCounts != loopCounts )
+        throw std::runtime_error( "histogram gave the wrong counts" );
+
+    std::cout << "histogram, loop: " << loopHistogramElapsed << "uS, sequential: " << histogramElapsed << "uS, parallel: " << parallelHistogramElapsed << "uS\n";
+
+    bool threw = false;
+
+    try
+    {
+        t::histogram( t::execution::par, bytes, 16 );
+    }
+    catch ( t::Error const& )
+    {
+        threw = true;
+    }
+
+    if ( !threw )
+        throw std::runtime_error( "histogram accepted a bin out of range" );
+}
+
+template< class T >
+void testSimdSearchOf()
+{
+    std::mt19937_64 rng( 17 );
+
+    for ( uint64 size = 0; size < 300; ++size )
+    {
+        auto arr = Array< T >( size );
+
+        for ( auto& elem : arr )
+            elem = T( rng() % 13 );
+
+        auto const needle = T( 5 );
+        auto const* data = arr.data();
+
+        if ( t::find( arr, needle ) - arr.begin() != std::find( data, data + size, needle ) - data
+            || t::count( arr, needle ) != uint64( std::count( data, data + size, needle ) ) )
+        {
+            throw std::runtime_error( "vectorized find or count gave the wrong result" );
+        }
+
+        if ( size > 0 )
+        {
+            auto const [ smallest, largest ] = t::minMax( arr );
+
+            if ( smallest != *std::min_element( data, data + size ) || largest != *std::max_element( data, data + size ) )
+                throw std::runtime_error( "vectorized minMax gave the wrong result" );
+        }
+
+        auto copy = arr;
+
+        if ( !t::equal( arr, copy ) )
+            throw std::runtime_error( "vectorized equal missed equal ranges" );
+
+        if ( size > 0 )
+        {
+            copy[ rng() % size ] += T( 1 );
+
+            if ( t::equal( arr, copy ) )
+                throw std::runtime_error( "vectorized equal missed a difference" );
+        }
+    }
+}
+
+void testSimdSearch()
+{
+    testSimdSearchOf< int8 >();
+    testSimdSearchOf< uint8 >();
+    testSimdSearchOf< int16 >();
+    testSimdSearchOf< uint16 >();
+    testSimdSearchOf< int32 >();
+    testSimdSearchOf< uint32 >();
+    testSimdSearchOf< int64 >();
+    testSimdSearchOf< uint64 >();
+    testSimdSearchOf< float >();
+    testSimdSearchOf< double >();
+}
+
+void benchmarkSimdSearch()
+{
+    auto values = Array< uint32 >( 20'000'000 );
+
+    uint64 state = 7;
+
+    for ( auto& value : values )
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        value = uint32( state >> 40 );
+    }
+
+    values[ values.size() - 10 ] = ~0u;
+
+    auto const* data = values.data();
+    auto const size = values.size();
+
+    Timer< microseconds > t;
+
+    t.start();
+    uint64 loopIndex = 0;
+    while ( loopIndex < size && data[ loopIndex ] != ~0u )
+        ++loopIndex;
+    auto const loopFindElapsed = t.stop();
+
+    t.start();
+    auto const found = t::find( values, ~0u );
+    auto const findElapsed = t.stop();
+
+    t.start();
+    uint32 loopMin = data[ 0 ];
+    uint32 loopMax = data[ 0 ];
+    for ( uint64 i = 1; i < size; ++i )
+    {
+        if ( data[ i ] < loopMin )
+            loopMin = data[ i ];
+        if ( loopMax < data[ i ] )
+            loopMax = data[ i ];
+    }
+    auto const loopMinMaxElapsed = t.stop();
+
+    t.start();
+    auto const [ smallest, largest ] = t::minMax( values );
+    auto const minMaxElapsed = t.stop();
+
+    if ( uint64( found - values.begin() ) != loopIndex || smallest != loopMin || largest != loopMax )
+        throw std::runtime_error( "vectorized find or minMax gave the wrong result" );
+
+    std::cout << "find, loop: " << loopFindElapsed << "uS, vectorized: " << findElapsed << "uS\n";
+    std::cout << "minMax, loop: " << loopMinMaxElapsed << "uS, vectorized: " << minMaxElapsed << "uS\n";
+}
+
+void benchmarkBinarySearchOf( uint64 const numel, uint64 const numQueries )
 {
-    t::HeapArray< T > output( numel );
+    uint64 state = numel;
+
+    auto const next = [ &state ]()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return uint32( state >> 32 );
+    };
+
+    auto values = Array< uint32 >( numel );
+
+    for ( auto& value : values )
+        value = next();
+
+    t::radixSort( values );
+
+    auto queries = Array< uint32 >( numQueries );
+
+    for ( auto& query : queries )
+        query = next();
+
+    auto const* data = values.data();
+
+    Timer< microseconds > t;
+
+    // the textbook search, which branches on every comparison
+    t.start();
+    auto branchy = Array< uint64 >( numQueries );
+    for ( uint64 q = 0; q < numQueries; ++q )
+    {
+        uint64 low = 0;
+        uint64 high = numel;
+        while ( low < high )
+        {
+            auto const mid = low + ( high - low ) / 2;
+            if ( data[ mid ] < queries[ q ] )
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        branchy[ q ] = low;
+    }
+    auto const branchyElapsed = t.stop();
 
-    uint64 i = 0;
-    constinit uint64 count[ CountSize ] = { 0 };
+    t.start();
+    auto branchless = Array< uint64 >( numQueries );
+    for ( uint64 q = 0; q < numQueries; ++q )
+        branchless[ q ] = uint64( t::lowerBound( values, queries[ q ] ) - values.cbegin() );
+    auto const branchlessElapsed = t.stop();
 
-    for ( i = 0; i < numel; ++i )
-        ++count[ ( arr[ i ] >> shift ) % CountSize ];
+    t.start();
+    auto batched = Array< Array< uint32 >::ConstIterator >( numQueries );
+    t::lowerBounds( values.cbegin(), values.cend(), queries.cbegin(), queries.cend(), batched.begin() );
+    auto const batchedElapsed = t.stop();
 
-    for ( i = 1; i < CountSize; ++i )
-        count[ i ] += count[ i - 1 ];
+    auto const index = t::EytzingerIndex< uint32 >( values );
 
-    for ( i = numel; i > 0; --i ) {
-        output[ count [ ( arr[ i - 1 ] >> shift ) % CountSize ] - 1 ] = arr[ i - 1 ];
-        --count[ ( arr[ i - 1 ] >> shift ) % CountSize ];
+    t.start();
+    auto eytzinger = Array< uint64 >( numQueries );
+    for ( uint64 q = 0; q < numQueries; ++q )
+        eytzinger[ q ] = index.lowerBound( queries[ q ] );
+    auto const eytzingerElapsed = t.stop();
+
+    t.start();
+    auto eytzingerBatched = Array< uint64 >( numQueries );
+    index.lowerBounds( queries.cbegin(), queries.cend(), eytzingerBatched.begin() );
+    auto const eytzingerBatchedElapsed = t.stop();
+
+    for ( uint64 q = 0; q < numQueries; ++q )
+    {
+        if ( branchless[ q ] != branchy[ q ] || uint64( batched[ q ] - values.cbegin() ) != branchy[ q ]
+            || eytzinger[ q ] != branchy[ q ] || eytzingerBatched[ q ] != branchy[ q ] )
+        {
+            throw std::runtime_error( "binary searches disagree" );
+        }
     }
 
-    for ( i = 0; i < numel; ++i )
-        arr[ i ] = output[ i ];
+    std::cout << "lowerBound over " << numel << " values, branchy: " << branchyElapsed << "uS, branchless: " << branchlessElapsed
+        << "uS, batched: " << batchedElapsed << "uS, eytzinger: " << eytzingerElapsed << "uS, eytzinger batched: " << eytzingerBatchedElapsed << "uS\n";
 }
 
-template< uint64 BitsAtOnce = 4, class T >
-void radixSort( T* data, uint64 numel )
+void benchmarkBinarySearch()
 {
-    constexpr uint64 NumBuckets = 0x1 << BitsAtOnce;
-    static_assert( BitsAtOnce != 0 );
+    benchmarkBinarySearchOf( 1'000, 1'000'000 );
+    benchmarkBinarySearchOf( 16'000'000, 1'000'000 );
 
-    constexpr double Temp = sizeof( T ) * 8.0 / static_cast< double >( BitsAtOnce );
-    constexpr uint64 NumLoops = static_cast< uint64 >( Temp ) == Temp ? Temp : static_cast< uint64 >( Temp ) + 1;
+    bool threw = false;
 
-    for ( uint64 i = 0; i < NumLoops; ++i )
+    try
     {
-        countSort< NumBuckets >( data, numel, i * BitsAtOnce );
+        t::EytzingerIndex< int >( Array< int >{ 1, 3, 2 } );
+    }
+    catch ( t::Error const& )
+    {
+        threw = true;
+    }
+
+    if ( !threw )
+        throw std::runtime_error( "EytzingerIndex accepted unsorted values" );
+}
+
+template< class Queue >
+void testPriorityQueueOf()
+{
+    std::mt19937_64 rng( 11 );
+
+    Queue queue;
+    std::priority_queue< uint64, std::vector< uint64 >, std::greater< uint64 > > expected;
+
+    for ( int i = 0; i < 100'000; ++i )
+    {
+        if ( expected.empty() || rng() % 3 != 0 )
+        {
+            auto const value = rng() % 1000;
+            queue.push( value );
+            expected.push( value );
+        }
+        else
+        {
+            if ( queue.pop() != expected.top() )
+                throw std::runtime_error( "PriorityQueue popped out of order" );
+
+            expected.pop();
+        }
+    }
+
+    if ( queue.size() != expected.size() )
+        throw std::runtime_error( "PriorityQueue lost elements" );
+}
+
+void testPriorityQueue()
+{
+    testPriorityQueueOf< t::PriorityQueue< uint64 > >();
+    testPriorityQueueOf< t::QuaternaryPriorityQueue< uint64 > >();
+
+    // random decreaseKey and erase against a brute force search for the smallest value
+    std::mt19937_64 rng( 12 );
+
+    constexpr uint64 capacity = 300;
+
+    t::IndexedPriorityQueue< uint64 > queue( capacity );
+    Array< uint64 > values( capacity );
+    Array< bool > queued( capacity );
+
+    for ( auto& isQueued : queued )
+        isQueued = false;
+
+    for ( int i = 0; i < 100'000; ++i )
+    {
+        auto const id = rng() % capacity;
+        auto const op = rng() % 4;
+
+        if ( !queued[ id ] )
+        {
+            values[ id ] = rng() % 10'000;
+            queue.push( id, values[ id ] );
+            queued[ id ] = true;
+        }
+        else if ( op == 0 )
+        {
+            values[ id ] -= rng() % ( values[ id ] + 1 );
+            queue.decreaseKey( id, values[ id ] );
+        }
+        else if ( op == 1 )
+        {
+            queue.erase( id );
+            queued[ id ] = false;
+        }
+        else if ( op == 2 )
+        {
+            auto const [ topId, topValue ] = queue.pop();
+
+            for ( uint64 other = 0; other < capacity; ++other )
+            {
+                if ( queued[ other ] && values[ other ] < topValue )
+                    throw std::runtime_error( "IndexedPriorityQueue popped out of order" );
+            }
+
+            if ( !queued[ topId ] || values[ topId ] != topValue )
+                throw std::runtime_error( "IndexedPriorityQueue popped the wrong value" );
+
+            queued[ topId ] = false;
+        }
+    }
+}
+
+/*
+ * Event scheduling with a fixed number of pending events: every step takes
+ * the earliest one off the queue and schedules another a random delay later
+ */
+template< class Queue, class Pop >
+int64 benchmarkSchedulerOf( Queue& queue, Pop pop, uint64 const pending, uint64 const steps, uint64& checksum )
+{
+    uint64 state = 5;
+
+    auto const next = [ &state ]()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state >> 44;
+    };
+
+    for ( uint64 i = 0; i < pending; ++i )
+        queue.push( next() );
+
+    Timer< microseconds > t;
+
+    t.start();
+    for ( uint64 i = 0; i < steps; ++i )
+    {
+        auto const now = pop( queue );
+        checksum += now;
+        queue.push( now + next() );
+    }
+    return t.stop();
+}
+
+void benchmarkPriorityQueue()
+{
+    for ( uint64 const pending : { uint64( 1'000 ), uint64( 1'000'000 ) } )
+    {
+        constexpr uint64 steps = 2'000'000;
+
+        uint64 stdChecksum = 0;
+        uint64 binaryChecksum = 0;
+        uint64 quaternaryChecksum = 0;
+
+        std::priority_queue< uint64, std::vector< uint64 >, std::greater< uint64 > > stdQueue;
+        t::PriorityQueue< uint64 > binary;
+        t::QuaternaryPriorityQueue< uint64 > quaternary;
+
+        auto const stdElapsed = benchmarkSchedulerOf( stdQueue, []( auto& queue ){ auto const top = queue.top(); queue.pop(); return top; }, pending, steps, stdChecksum );
+        auto const binaryElapsed = benchmarkSchedulerOf( binary, []( auto& queue ){ return queue.pop(); }, pending, steps, binaryChecksum );
+        auto const quaternaryElapsed = benchmarkSchedulerOf( quaternary, []( auto& queue ){ return queue.pop(); }, pending, steps, quaternaryChecksum );
+
+        if ( binaryChecksum != stdChecksum || quaternaryChecksum != stdChecksum )
+            throw std::runtime_error( "priority queues disagree" );
+
+        std::cout << "scheduling with " << pending << " pending events, std::priority_queue: " << stdElapsed << "uS, t::PriorityQueue: " << binaryElapsed
+            << "uS, t::QuaternaryPriorityQueue: " << quaternaryElapsed << "uS\n";
     }
 }
 
@@ -234,7 +1358,24 @@ struct Yapper
 
 int main()
 {
+    testVariant();
+    testAny();
+    testVm();
     testTvm();
+    benchmarkParallelDeserialize();
+    benchmarkSchema();
+    benchmarkRadixSort();
+    testParallelSort();
+    benchmarkParallelSort();
+    benchmarkMerge();
+    benchmarkSelection();
+    benchmarkExecutionPolicies();
+    benchmarkAggregation();
+    testSimdSearch();
+    benchmarkSimdSearch();
+    benchmarkBinarySearch();
+    testPriorityQueue();
+    benchmarkPriorityQueue();
 
     std::cout << "main\n\n";
 
@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
 #include "../Algorithm.h"
 #include "../Array.h"
+#include "../EytzingerIndex.h"
+#include "../PriorityQueue.h"
+#include "../String.h"
 
 #include "TestAssert.h"
 
@@ -147,6 +155,564 @@ static constexpr bool testQuickSort()
 
 static constexpr bool quickSort = testQuickSort();
 
+static constexpr bool testSortPatterns()
+{
+	constexpr int64 size = 500;
+
+	auto const ascending = []( auto lhs, auto rhs ){ return lhs < rhs; };
+
+	// random, sorted, reversed, organ pipe and few unique values, large enough to reach the partitioning code
+	for ( int pattern = 0; pattern < 5; ++pattern )
+	{
+		t::Array< int64 > arr( size );
+		uint64 state = 12345;
+
+		for ( int64 i = 0; i < size; ++i )
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+
+			switch ( pattern )
+			{
+			case 0: arr[ i ] = int64( state >> 33 ); break;
+			case 1: arr[ i ] = i; break;
+			case 2: arr[ i ] = size - i; break;
+			case 3: arr[ i ] = i < size / 2 ? i : size - i; break;
+			default: arr[ i ] = int64( state >> 62 ); break;
+			}
+		}
+
+		auto copy = arr;
+
+		t::sort( arr.begin(), arr.end(), ascending );
+		test_assert( t::isSorted( arr ) );
+
+		// non-arithmetic elements take the branchy partition
+		t::Array< t::Array< int64 > > boxed( size );
+
+		for ( int64 i = 0; i < size; ++i )
+			boxed[ i ] = t::Array< int64 >{ copy[ i ] };
+
+		t::quickSort( boxed, []( auto const& lhs, auto const& rhs ){ return lhs[ 0 ] < rhs[ 0 ]; } );
+
+		for ( int64 i = 0; i < size; ++i )
+			test_assert( boxed[ i ][ 0 ] == arr[ i ] );
+	}
+
+	// a comparator that turns into always true partway through must not move the scans out of the range, which constant evaluation would reject
+	for ( int64 consistentCalls : { 20, 50, 200, 400 } )
+	{
+		t::Array< t::Array< int64 > > boxed( size );
+		int64 sum = 0;
+
+		for ( int64 i = 0; i < size; ++i )
+		{
+			boxed[ i ] = t::Array< int64 >{ ( i * 37 ) % 101 };
+			sum += ( i * 37 ) % 101;
+		}
+
+		int64 calls = 0;
+
+		t::sort( boxed.begin(), boxed.end(), [ & ]( auto const& lhs, auto const& rhs )
+		{
+			return ++calls > consistentCalls || lhs[ 0 ] < rhs[ 0 ];
+		} );
+
+		for ( auto const& value : boxed )
+			sum -= value[ 0 ];
+
+		test_assert( sum == 0 );
+	}
+
+	return true;
+}
+
+static constexpr bool sortPatterns = testSortPatterns();
+
+static constexpr bool testRadixSort()
+{
+	constexpr int64 size = 300;
+
+	auto const ascending = []( auto lhs, auto rhs ){ return lhs < rhs; };
+
+	{
+		t::Array< int64 > arr( size );
+		uint64 state = 12345;
+
+		for ( int64 i = 0; i < size; ++i )
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			arr[ i ] = int64( state ) >> ( i % 40 );
+		}
+
+		auto copy = arr;
+
+		t::radixSort( arr );
+		t::sort( copy.begin(), copy.end(), ascending );
+
+		test_assert( arr == copy );
+	}
+
+	{
+		t::Array< double > arr( size );
+
+		for ( int64 i = 0; i < size; ++i )
+			arr[ i ] = double( ( i * 7919 ) % size - size / 2 ) / 8.0;
+
+		arr[ 0 ] = -0.0;
+
+		auto copy = arr;
+
+		t::radixSort( arr );
+		t::sort( copy.begin(), copy.end(), ascending );
+
+		test_assert( arr == copy );
+	}
+
+	// sorting by a key keeps equal keys in their original order
+	{
+		t::Array< t::pair< int8, int32 > > arr( size );
+
+		for ( int32 i = 0; i < size; ++i )
+			arr[ i ] = { int8( ( i * 37 ) % 11 - 5 ), i };
+
+		t::radixSort( arr, []( auto const& elem ){ return elem.first; } );
+
+		for ( int64 i = 1; i < size; ++i )
+		{
+			test_assert( arr[ i - 1 ].first <= arr[ i ].first );
+
+			if ( arr[ i - 1 ].first == arr[ i ].first )
+				test_assert( arr[ i - 1 ].second < arr[ i ].second );
+		}
+	}
+
+	// strings share long prefixes and include empty strings and prefixes of each other
+	{
+		constexpr char text[] = "abaabbbaaabababbbbaaaabbababaaabbbabababbaabbaabbbaaababbbabaaba";
+
+		auto const lexicographic = []( t::StringView lhs, t::StringView rhs )
+		{
+			for ( uint64 i = 0; i < lhs.size() && i < rhs.size(); ++i )
+			{
+				if ( lhs.data()[ i ] != rhs.data()[ i ] )
+					return lhs.data()[ i ] < rhs.data()[ i ];
+			}
+
+			return lhs.size() < rhs.size();
+		};
+
+		t::Array< t::StringView > arr( size );
+
+		for ( uint64 i = 0; i < size; ++i )
+			arr[ i ] = t::StringView( text + ( i * 13 ) % 40, ( i * 7 ) % 9 );
+
+		auto copy = arr;
+
+		t::radixSort( arr );
+		t::sort( copy.begin(), copy.end(), lexicographic );
+
+		for ( uint64 i = 0; i < size; ++i )
+			test_assert( !lexicographic( arr[ i ], copy[ i ] ) && !lexicographic( copy[ i ], arr[ i ] ) );
+	}
+
+	return true;
+}
+
+static constexpr bool radixSort = testRadixSort();
+
+// std::pair also checks that the helpers are not ambiguous with the std algorithms found through ADL
+template< class Pair >
+static constexpr bool testStableSortOf()
+{
+	constexpr int32 size = 300;
+
+	auto const byFirst = []( auto const& lhs, auto const& rhs ){ return lhs.first < rhs.first; };
+
+	t::Array< Pair > arr( size );
+
+	for ( int32 i = 0; i < size; ++i )
+		arr[ i ] = { ( i * 37 ) % 13, i };
+
+	auto inPlace = arr;
+
+	t::stableSort( arr, byFirst );
+	t::details::algorithm::mergeSort( inPlace.begin(), inPlace.end(), static_cast< Pair* >( nullptr ), byFirst );
+
+	for ( int32 i = 1; i < size; ++i )
+	{
+		test_assert( arr[ i - 1 ].first <= arr[ i ].first );
+
+		if ( arr[ i - 1 ].first == arr[ i ].first )
+			test_assert( arr[ i - 1 ].second < arr[ i ].second );
+
+		test_assert( arr[ i ].first == inPlace[ i ].first && arr[ i ].second == inPlace[ i ].second );
+	}
+
+	return true;
+}
+
+static constexpr bool testStableSort()
+{
+	return testStableSortOf< t::pair< int32, int32 > >() && testStableSortOf< std::pair< int32, int32 > >();
+}
+
+static constexpr bool stableSort = testStableSort();
+
+static constexpr bool testKwayMerge()
+{
+	// runs of different lengths, including an empty one, with equal keys across runs
+	t::Array< t::Array< t::pair< int32, int32 > > > runs( 5 );
+
+	for ( int32 run = 0; run < 5; ++run )
+	{
+		for ( int32 i = 0; i < run * 7; ++i )
+			runs[ run ].pushBack( { i * ( run + 1 ) / 3, run } );
+	}
+
+	t::Array< t::pair< int32, int32 > > merged( 0 + 7 + 14 + 21 + 28 );
+
+	auto const last = t::kwayMerge( runs, merged.begin(), []( auto const& lhs, auto const& rhs ){ return lhs.first < rhs.first; } );
+
+	test_assert( last == merged.end() );
+
+	for ( uint64 i = 1; i < merged.size(); ++i )
+	{
+		test_assert( merged[ i - 1 ].first <= merged[ i ].first );
+
+		if ( merged[ i - 1 ].first == merged[ i ].first )
+			test_assert( merged[ i - 1 ].second <= merged[ i ].second );
+	}
+
+	t::Array< t::Array< int > > single{ t::Array< int >{ 1, 2, 3 } };
+	t::Array< int > out( 3 );
+
+	t::kwayMerge( single, out.begin() );
+
+	test_assert( ( out == t::Array< int >{ 1, 2, 3 } ) );
+
+	return true;
+}
+
+static constexpr bool kwayMerge = testKwayMerge();
+
+static constexpr bool testSelection()
+{
+	constexpr int64 size = 400;
+
+	auto const ascending = []( auto lhs, auto rhs ){ return lhs < rhs; };
+
+	// random and few unique values
+	for ( int pattern = 0; pattern < 2; ++pattern )
+	{
+		t::Array< int64 > arr( size );
+		uint64 state = 777;
+
+		for ( int64 i = 0; i < size; ++i )
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			arr[ i ] = pattern == 0 ? int64( state >> 33 ) : int64( state >> 62 );
+		}
+
+		auto sorted = arr;
+		t::sort( sorted.begin(), sorted.end(), ascending );
+
+		for ( int64 nth : { int64( 0 ), size / 2, size / 10, size - 1 } )
+		{
+			auto copy = arr;
+			t::nthElement( copy.begin(), copy.begin() + nth, copy.end() );
+
+			test_assert( copy[ nth ] == sorted[ nth ] );
+
+			for ( int64 i = 0; i < size; ++i )
+				test_assert( i < nth ? copy[ i ] <= copy[ nth ] : copy[ i ] >= copy[ nth ] );
+
+			copy = arr;
+			t::partialSort( copy.begin(), copy.begin() + nth, copy.end() );
+
+			for ( int64 i = 0; i < nth; ++i )
+				test_assert( copy[ i ] == sorted[ i ] );
+		}
+
+		auto const top = t::topK( arr, 10 );
+
+		test_assert( top.size() == 10 );
+
+		for ( int64 i = 0; i < 10; ++i )
+			test_assert( top[ i ] == sorted[ size - 1 - i ] );
+
+		auto const bottom = t::topK( arr.begin(), arr.end(), 5, ascending );
+
+		for ( int64 i = 0; i < 5; ++i )
+			test_assert( bottom[ i ] == sorted[ i ] );
+	}
+
+	test_assert( t::topK( t::Array< int >{ 1, 2 }, 5 ).size() == 2 );
+	test_assert( t::topK( t::Array< int >{ 1, 2 }, 0 ).size() == 0 );
+
+	return true;
+}
+
+static constexpr bool selection = testSelection();
+
+static constexpr bool testSearch()
+{
+	auto const arr = t::Array< int >{ 4, -2, 9, 4, 0, 9, 4 };
+
+	test_assert( t::find( arr, 9 ) == arr.begin() + 2 );
+	test_assert( t::find( arr, 5 ) == arr.end() );
+	test_assert( t::count( arr, 4 ) == 3 );
+	test_assert( t::count( arr.begin(), arr.begin() + 3, 4 ) == 1 );
+
+	test_assert( t::min( arr ) == -2 );
+	test_assert( t::max( arr.begin(), arr.end() ) == 9 );
+
+	auto const [ smallest, largest ] = t::minMax( arr );
+
+	test_assert( smallest == -2 && largest == 9 );
+
+	auto copy = arr;
+
+	test_assert( t::equal( arr, copy ) );
+
+	copy[ 6 ] = 5;
+
+	test_assert( !t::equal( arr, copy ) );
+	test_assert( t::equal( arr.begin(), arr.begin() + 6, copy.begin() ) );
+	test_assert( !t::equal( arr, t::Array< int >{ 4, -2 } ) );
+
+	// argument dependent lookup also finds the std algorithms for std containers
+	std::vector< int > const vec{ 4, -2, 9, 4 };
+
+	test_assert( t::count( vec, 4 ) == 2 );
+	test_assert( t::min( vec ) == -2 && t::max( vec ) == 9 );
+	test_assert( t::equal( vec, vec ) );
+
+	return true;
+}
+
+static constexpr bool search = testSearch();
+
+static constexpr bool testReduceScan()
+{
+	constexpr int64 size = 100;
+
+	t::Array< int64 > arr( size );
+
+	for ( int64 i = 0; i < size; ++i )
+		arr[ i ] = i % 7 - 3;
+
+	int64 expected = 5;
+
+	for ( auto const elem : arr )
+		expected += elem;
+
+	test_assert( t::reduce( arr, int64( 5 ) ) == expected );
+	test_assert( t::reduce( arr.begin(), arr.begin() + 3, int64( 0 ) ) == -6 );
+	test_assert( t::reduce( arr, int64( -10 ), []( int64 lhs, int64 rhs ){ return lhs > rhs ? lhs : rhs; } ) == 3 );
+	test_assert( t::reduce( t::Array< double >{ 0.5, 0.25 }, 1.0 ) == 1.75 );
+
+	// std::reduce is found by argument dependent lookup as well
+	std::vector< int > const vec{ 1, 2, 3 };
+
+	test_assert( t::reduce( vec, 0 ) == 6 );
+	test_assert( t::reduce( vec, 1, []( int lhs, int rhs ){ return lhs * rhs; } ) == 6 );
+
+	t::Array< int64 > out( size );
+
+	test_assert( t::inclusiveScan( arr, out.begin() ) == out.end() );
+
+	int64 sum = 0;
+
+	for ( int64 i = 0; i < size; ++i )
+	{
+		sum += arr[ i ];
+		test_assert( out[ i ] == sum );
+	}
+
+	t::exclusiveScan( arr.begin(), arr.end(), arr.begin(), int64( 1 ) );
+
+	test_assert( arr[ 0 ] == 1 );
+
+	for ( int64 i = 1; i < size; ++i )
+		test_assert( arr[ i ] == out[ i - 1 ] + 1 );
+
+	auto const products = t::Array< int >{ 1, 2, 3, 4 };
+	t::Array< int > scanned( 4 );
+	t::inclusiveScan( products.begin(), products.end(), scanned.begin(), []( int lhs, int rhs ){ return lhs * rhs; } );
+
+	test_assert( ( scanned == t::Array< int >{ 1, 2, 6, 24 } ) );
+
+	return true;
+}
+
+static constexpr bool reduceScan = testReduceScan();
+
+static constexpr bool testHistogram()
+{
+	t::Array< uint8 > bytes( 1000 );
+
+	for ( uint64 i = 0; i < bytes.size(); ++i )
+		bytes[ i ] = uint8( i % 3 == 0 ? 7 : i );
+
+	auto const counts = t::histogram( bytes, 256 );
+
+	uint64 sevens = 0;
+
+	for ( auto const byte : bytes )
+		sevens += byte == 7;
+
+	test_assert( counts.size() == 256 );
+	test_assert( counts[ 7 ] == sevens );
+	test_assert( counts[ 0 ] == 2 );
+	test_assert( t::reduce( counts, uint64( 0 ) ) == bytes.size() );
+
+	auto const parity = t::histogram( bytes.begin(), bytes.end(), 2, []( uint8 byte ){ return byte % 2; } );
+
+	test_assert( parity[ 1 ] == 667 );
+	test_assert( parity[ 0 ] + parity[ 1 ] == bytes.size() );
+
+	return true;
+}
+
+static constexpr bool histogram = testHistogram();
+
+static constexpr bool testBinarySearch()
+{
+	auto const arr = t::Array< int >{ -3, 0, 0, 2, 5, 5, 5, 8 };
+
+	test_assert( t::lowerBound( arr, 5 ) == arr.begin() + 4 );
+	test_assert( t::upperBound( arr, 5 ) == arr.begin() + 7 );
+	test_assert( t::lowerBound( arr, -9 ) == arr.begin() );
+	test_assert( t::upperBound( arr, 8 ) == arr.end() );
+	test_assert( t::lowerBound( arr.begin(), arr.begin() + 3, 1 ) == arr.begin() + 3 );
+	test_assert( t::binarySearch( arr, 2 ) );
+	test_assert( !t::binarySearch( arr, 3 ) );
+	test_assert( !t::binarySearch( t::Array< int >{}, 3 ) );
+
+	auto const descending = t::Array< int >{ 9, 7, 7, 1 };
+
+	test_assert( t::upperBound( descending.begin(), descending.end(), 7, []( int lhs, int rhs ){ return lhs > rhs; } ) == descending.begin() + 3 );
+
+	auto const keys = t::Array< int >{ 8, -4, 5, 1, 9 };
+	t::Array< t::Array< int >::ConstIterator > found( keys.size() );
+
+	t::lowerBounds( arr.begin(), arr.end(), keys.begin(), keys.end(), found.begin() );
+
+	for ( uint64 i = 0; i < keys.size(); ++i )
+		test_assert( found[ i ] == t::lowerBound( arr, keys[ i ] ) );
+
+	// every size up to a few full levels, with runs of equal values
+	for ( int size = 0; size < 40; ++size )
+	{
+		t::Array< int > values( size );
+
+		for ( int i = 0; i < size; ++i )
+			values[ i ] = i / 3 * 2;
+
+		auto const index = t::EytzingerIndex< int >( values );
+
+		test_assert( index.size() == uint64( size ) );
+
+		t::Array< int > queries( size + 4 );
+		t::Array< uint64 > ranks( size + 4 );
+
+		for ( int i = 0; i < size + 4; ++i )
+			queries[ i ] = i - 2;
+
+		index.lowerBounds( queries.begin(), queries.end(), ranks.begin() );
+
+		for ( int i = 0; i < size + 4; ++i )
+		{
+			auto const value = queries[ i ];
+			auto const lower = uint64( t::lowerBound( values, value ) - values.cbegin() );
+
+			test_assert( index.lowerBound( value ) == lower );
+			test_assert( ranks[ i ] == lower );
+			test_assert( index.upperBound( value ) == uint64( t::upperBound( values, value ) - values.cbegin() ) );
+			test_assert( index.contains( value ) == t::binarySearch( values, value ) );
+		}
+	}
+
+	return true;
+}
+
+static constexpr bool binarySearch = testBinarySearch();
+
+template< class Queue >
+static constexpr bool popsInOrder( Queue queue, t::Array< int > const& expected )
+{
+	for ( auto const value : expected )
+	{
+		if ( queue.top() != value || queue.pop() != value )
+			return false;
+	}
+
+	return queue.isEmpty();
+}
+
+static constexpr bool testPriorityQueue()
+{
+	auto const values = t::Array< int >{ 5, -1, 8, 5, 0, 12, 3, -7, 8, 2 };
+	auto const ascending = t::Array< int >{ -7, -1, 0, 2, 3, 5, 5, 8, 8, 12 };
+	auto const descending = t::Array< int >{ 12, 8, 8, 5, 5, 3, 2, 0, -1, -7 };
+
+	{
+		t::PriorityQueue< int > queue;
+
+		for ( auto const value : values )
+			queue.push( value );
+
+		test_assert( queue.size() == values.size() );
+		test_assert( popsInOrder( queue, ascending ) );
+	}
+
+	{
+		auto const greater = []( int lhs, int rhs ){ return lhs > rhs; };
+
+		test_assert( popsInOrder( t::PriorityQueue< int, decltype( greater ) >( values, greater ), descending ) );
+		test_assert( popsInOrder( t::QuaternaryPriorityQueue< int, decltype( greater ) >( values, greater ), descending ) );
+	}
+
+	{
+		t::QuaternaryPriorityQueue< int > queue;
+
+		for ( auto const value : values )
+			queue.push( value );
+
+		test_assert( popsInOrder( queue, ascending ) );
+
+		queue.heapify( values );
+
+		test_assert( popsInOrder( queue, ascending ) );
+	}
+
+	{
+		t::IndexedPriorityQueue< int > queue( 10 );
+
+		for ( uint64 id = 0; id < values.size(); ++id )
+			queue.push( id, values[ id ] );
+
+		queue.decreaseKey( 2, -9 );
+		queue.decreaseKey( 5, 1 );
+		queue.erase( 0 );
+
+		test_assert( !queue.contains( 0 ) && queue.contains( 3 ) );
+		test_assert( queue.value( 5 ) == 1 );
+		test_assert( queue.topId() == 2 && queue.top() == -9 );
+
+		auto const order = t::Array< uint64 >{ 2, 7, 1, 4, 5, 9, 6, 3, 8 };
+
+		for ( auto const id : order )
+			test_assert( queue.pop().first == id );
+
+		test_assert( queue.isEmpty() );
+	}
+
+	return true;
+}
+
+static constexpr bool priorityQueue = testPriorityQueue();
+
 static constexpr bool testIsSorted()
 {
 	{
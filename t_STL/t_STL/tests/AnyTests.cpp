@@ -0,0 +1,136 @@
+#include "../Any.h"
+
+#include "RuntimeTests.h"
+#include "TestAssert.h"
+
+namespace
+{
+	struct Small
+	{
+		uint64 a = 0;
+		uint64 b = 0;
+		uint64 c = 0;
+	};
+
+	struct Large
+	{
+		uint64 values[ 8 ] {};
+	};
+
+	// small enough, but moving it may throw, so it has to live on the heap
+	struct ThrowingMove
+	{
+		int value = 0;
+
+		ThrowingMove( int value ):
+			value( value ) {}
+
+		ThrowingMove( ThrowingMove const& ) = default;
+		ThrowingMove( ThrowingMove&& other ) noexcept( false ):
+			value( other.value ) {}
+	};
+
+	static_assert( sizeof( Small ) == 24 );
+
+	template< class T >
+	bool storedIn( t::Any const& any )
+	{
+		auto const* address = reinterpret_cast< uint8 const* >( any.tryGet< T >() );
+		auto const* begin = reinterpret_cast< uint8 const* >( &any );
+		return address >= begin && address < begin + sizeof( any );
+	}
+
+	template< class T >
+	bool getThrows( t::Any const& any )
+	{
+		try
+		{
+			( void )any.get< T >();
+		}
+		catch ( t::Error const& )
+		{
+			return true;
+		}
+
+		return false;
+	}
+}
+
+static void testAnyStorage()
+{
+	auto const number = t::Any( 42 );
+	auto const small = t::Any( Small{ 1, 2, 3 } );
+	auto const large = t::Any( Large{ { 9 } } );
+	auto const throwing = t::Any( ThrowingMove( 5 ) );
+
+	test_assert( number.get< int >() == 42 );
+	test_assert( storedIn< int >( number ) );
+
+	test_assert( small.get< Small >().c == 3 );
+	test_assert( storedIn< Small >( small ) );
+
+	test_assert( large.get< Large >().values[ 0 ] == 9 );
+	test_assert( !storedIn< Large >( large ) );
+
+	test_assert( throwing.get< ThrowingMove >().value == 5 );
+	test_assert( !storedIn< ThrowingMove >( throwing ) );
+
+	test_assert( !number.tryGet< Small >() );
+	test_assert( getThrows< Small >( number ) );
+}
+
+static void testAnyCopyMove()
+{
+	auto small = t::Any( Small{ 1, 2, 3 } );
+	auto large = t::Any( Large{ { 9 } } );
+
+	auto smallCopy = small;
+	auto largeCopy = large;
+
+	test_assert( smallCopy.get< Small >().b == 2 );
+	test_assert( largeCopy.get< Large >().values[ 0 ] == 9 );
+	test_assert( largeCopy.tryGet< Large >() != large.tryGet< Large >() );
+
+	// moving a heap value hands over the allocation
+	auto const* allocation = large.tryGet< Large >();
+	auto moved = std::move( large );
+
+	test_assert( moved.tryGet< Large >() == allocation );
+	test_assert( !large.hasValue() );
+
+	moved = std::move( small );
+
+	test_assert( moved.get< Small >().a == 1 );
+	test_assert( !small.hasValue() );
+
+	smallCopy = largeCopy;
+
+	test_assert( smallCopy.get< Large >().values[ 0 ] == 9 );
+	test_assert( largeCopy.hasValue() );
+
+	moved.clear();
+
+	test_assert( !moved.hasValue() );
+	test_assert( !moved.tryGet< Small >() );
+}
+
+static void testEmptyAny()
+{
+	t::Any empty;
+
+	test_assert( !empty.hasValue() );
+	test_assert( !empty.tryGet< int >() );
+	test_assert( getThrows< int >( empty ) );
+
+	auto cleared = t::Any( 1 );
+	cleared.clear();
+
+	test_assert( getThrows< int >( cleared ) );
+}
+
+void testAny()
+{
+	testAnyStorage();
+	testAnyCopyMove();
+	testEmptyAny();
+}
@@ -0,0 +1,195 @@
+#include "../Memory.h"
+
+#include "TestAssert.h"
+
+static constexpr bool testMakeShared()
+{
+	{
+		auto ptr = t::make_shared< int >( 5 );
+
+		test_assert( *ptr == 5 );
+		test_assert( ptr.isUnique() );
+
+		auto cpy = ptr;
+
+		test_assert( cpy.get() == ptr.get() );
+		test_assert( ptr.useCount() == 2 );
+
+		*cpy = 7;
+
+		test_assert( *ptr == 7 );
+	}
+
+	{
+		t::SharedPtr< int > ptr = new int( 3 );
+		t::SharedPtr< int > other = t::make_shared< int >( 4 );
+
+		ptr = other;
+
+		test_assert( *ptr == 4 );
+		test_assert( other.useCount() == 2 );
+
+		other = nullptr;
+
+		test_assert( ptr.isUnique() );
+	}
+
+	return true;
+}
+
+static constexpr auto makeShared = testMakeShared();
+
+namespace
+{
+	struct Base
+	{
+		constexpr virtual ~Base() = default;
+		constexpr virtual int value() const = 0;
+	};
+
+	struct Derived : Base
+	{
+		constexpr Derived( int v ):
+			m_value( v ) {}
+
+		constexpr ~Derived() override {}
+
+		constexpr int value() const override { return m_value; }
+
+		int m_value;
+	};
+}
+
+static constexpr bool testSharedConversion()
+{
+	t::SharedPtr< Base > base = t::make_shared< Derived >( 9 );
+
+	test_assert( base->value() == 9 );
+
+	t::SharedPtr< Base > cpy = base;
+
+	test_assert( cpy.useCount() == 2 );
+
+	return true;
+}
+
+static constexpr auto sharedConversion = testSharedConversion();
+
+static constexpr bool testImmutableShared()
+{
+	auto ptr = t::make_immutable_shared< int >( 1 );
+	auto cpy = ptr;
+
+	test_assert( ptr.isShared() );
+
+	*cpy.get() = 2;
+
+	test_assert( *ptr == 1 );
+	test_assert( *cpy == 2 );
+	test_assert( ptr.isUnique() && cpy.isUnique() );
+
+	return true;
+}
+
+static constexpr auto immutableShared = testImmutableShared();
+
+namespace
+{
+	struct Counted : t::RefCounted
+	{
+		constexpr Counted( int v ):
+			m_value( v ) {}
+
+		int m_value;
+	};
+}
+
+static constexpr bool testIntrusive()
+{
+	auto ptr = t::make_intrusive< Counted >( 4 );
+
+	test_assert( ptr->refCount() == 1 );
+
+	{
+		auto cpy = ptr;
+
+		test_assert( ptr->refCount() == 2 );
+		test_assert( ptr.isShared() );
+	}
+
+	test_assert( ptr.isUnique() );
+	test_assert( ptr->m_value == 4 );
+
+	return true;
+}
+
+static constexpr auto intrusive = testIntrusive();
+
+static constexpr bool testWeakPtr()
+{
+	{
+		t::WeakPtr< int > weak;
+
+		test_assert( weak.expired() );
+		test_assert( weak.lock() == nullptr );
+	}
+
+	{
+		auto ptr = t::make_shared< int >( 6 );
+		t::WeakPtr< int > weak = ptr;
+
+		test_assert( !weak.expired() );
+		test_assert( ptr.useCount() == 1 );
+
+		{
+			auto locked = weak.lock();
+
+			test_assert( locked.get() == ptr.get() );
+			test_assert( ptr.useCount() == 2 );
+		}
+
+		ptr = nullptr;
+
+		test_assert( weak.expired() );
+		test_assert( weak.lock() == nullptr );
+	}
+
+	{
+		t::WeakPtr< Base > weak;
+
+		{
+			t::SharedPtr< Derived > ptr = new Derived( 2 );
+			weak = ptr;
+
+			test_assert( weak.lock()->value() == 2 );
+		}
+
+		test_assert( weak.expired() );
+	}
+
+	return true;
+}
+
+static constexpr auto weakPtr = testWeakPtr();
+
+static constexpr bool testImmutableWeakPtr()
+{
+	auto ptr = t::make_immutable_shared< int >( 1 );
+	auto cpy = ptr;
+
+	t::ImmutableWeakPtr< int > weak = ptr;
+
+	// writing detaches cpy, the weak reference keeps observing the original
+	*cpy.get() = 2;
+
+	test_assert( *weak.lock() == 1 );
+
+	ptr = t::ImmutableSharedPtr< int >();
+
+	test_assert( weak.expired() );
+	test_assert( *cpy == 2 );
+
+	return true;
+}
+
+static constexpr auto immutableWeakPtr = testImmutableWeakPtr();
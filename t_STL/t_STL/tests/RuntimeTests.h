@@ -0,0 +1,7 @@
+#pragma once
+
+/*
+ * Tests of types that cannot be used in constant expressions, run from main
+ */
+void testVariant();
+void testAny();
@@ -0,0 +1,136 @@
+#include "../Variant.h"
+
+#include "RuntimeTests.h"
+#include "TestAssert.h"
+
+namespace
+{
+	// counts how many live copies are destroyed; moved from copies do not count
+	struct Counted
+	{
+		int* destroyed = nullptr;
+		int value = 0;
+
+		Counted( int* destroyed, int value ):
+			destroyed( destroyed ),
+			value( value ) {}
+
+		Counted( Counted const& other ) = default;
+
+		Counted( Counted&& other ) noexcept:
+			destroyed( t::exchange( other.destroyed, nullptr ) ),
+			value( other.value ) {}
+
+		Counted& operator=( Counted const& ) = default;
+
+		~Counted()
+		{
+			if ( destroyed )
+				++*destroyed;
+		}
+	};
+
+	// too large to be stored inline
+	struct Big
+	{
+		Counted counted;
+		uint8 padding[ t::details::variant::InlineSizeThreshold ] {};
+	};
+
+	static_assert( t::details::variant::storedInline< Counted > );
+	static_assert( !t::details::variant::storedInline< Big > );
+
+	template< class T, class V >
+	bool storedIn( V const& variant )
+	{
+		auto const* address = reinterpret_cast< uint8 const* >( variant.template tryGet< T >() );
+		auto const* begin = reinterpret_cast< uint8 const* >( &variant );
+		return address >= begin && address < begin + sizeof( variant );
+	}
+}
+
+static void testVariantStorage()
+{
+	using Variant = t::Variant< int, Counted, Big >;
+
+	// large alternatives only cost the Variant a pointer
+	static_assert( sizeof( Variant ) < sizeof( Big ) );
+
+	int destroyed = 0;
+
+	{
+		Variant small = Counted( &destroyed, 1 );
+		Variant big = Big{ Counted( &destroyed, 2 ) };
+
+		test_assert( small.tryGet< Counted >() && small.tryGet< Counted >()->value == 1 );
+		test_assert( storedIn< Counted >( small ) );
+		test_assert( !small.tryGet< Big >() && !small.tryGet< int >() );
+
+		test_assert( big.tryGet< Big >() && big.tryGet< Big >()->counted.value == 2 );
+		test_assert( !storedIn< Big >( big ) );
+	}
+
+	test_assert( destroyed == 2 );
+}
+
+static void testVariantCopyMove()
+{
+	using Variant = t::Variant< int, Counted, Big >;
+
+	int destroyed = 0;
+
+	{
+		Variant number = 7;
+		Variant small = Counted( &destroyed, 1 );
+		Variant big = Big{ Counted( &destroyed, 2 ) };
+
+		// copying over a different alternative destroys the old one
+		number = small;
+
+		test_assert( number.tryGet< Counted >() && number.tryGet< Counted >()->value == 1 );
+		test_assert( small.tryGet< Counted >() && small.tryGet< Counted >()->value == 1 );
+		test_assert( destroyed == 0 );
+
+		small = big;
+
+		test_assert( destroyed == 1 );
+		test_assert( small.tryGet< Big >() && big.tryGet< Big >() );
+		test_assert( small.tryGet< Big >() != big.tryGet< Big >() );
+		test_assert( small.tryGet< Big >()->counted.value == 2 );
+
+		// moving a heap alternative hands over the allocation
+		auto const* allocation = big.tryGet< Big >();
+
+		number = std::move( big );
+
+		test_assert( destroyed == 2 );
+		test_assert( number.tryGet< Big >() == allocation );
+		test_assert( !big.tryGet< Big >() );
+
+		Variant moved = std::move( small );
+
+		test_assert( moved.tryGet< Big >() && moved.tryGet< Big >()->counted.value == 2 );
+
+		moved = 3;
+
+		test_assert( destroyed == 3 );
+		test_assert( moved.tryGet< int >() && *moved.tryGet< int >() == 3 );
+
+		// and moving an inline one moves the value
+		Variant inlined = Counted( &destroyed, 4 );
+		big = std::move( inlined );
+
+		test_assert( big.tryGet< Counted >() && big.tryGet< Counted >()->value == 4 );
+		test_assert( !inlined.tryGet< Counted >() );
+		test_assert( destroyed == 3 );
+	}
+
+	// the Big in number and the Counted in big
+	test_assert( destroyed == 5 );
+}
+
+void testVariant()
+{
+	testVariantStorage();
+	testVariantCopyMove();
+}
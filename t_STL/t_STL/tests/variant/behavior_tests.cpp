@@ -23,3 +23,48 @@ void test()
 
 	test_assert( uint == 123 );
 }
+
+static constexpr bool testValueCopies()
+{
+	using namespace t::variant;
+	using t::String;
+
+	{
+		auto val = Value( uint32( 5 ) );
+		auto cpy = val;
+
+		cpy.As< uint32& >() = 6;
+
+		test_assert( val.As< uint32 >() == 5 );
+		test_assert( cpy.As< uint32 >() == 6 );
+		test_assert( cpy.Is< uint32 >() );
+	}
+
+	{
+		auto val = Value( "hello" );
+		auto cpy = val;
+
+		test_assert( &val.As< String const& >() == &cpy.As< String const& >() );
+
+		cpy.As< String& >() += "!";
+
+		test_assert( val.As< String >() == "hello" );
+		test_assert( cpy.As< String >() == "hello!" );
+	}
+
+	{
+		auto val = Value( double( 1.5 ) );
+		auto clone = val.Clone();
+
+		test_assert( clone.As< double >() == 1.5 );
+
+		val = Value( "now a string" );
+
+		test_assert( val.Is< String >() );
+		test_assert( clone.Is< double >() );
+	}
+
+	return true;
+}
+
+static constexpr auto valueCopies = testValueCopies();
@@ -0,0 +1,236 @@
+#include "Checksum.h"
+
+#include <cstring>
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+#define T_STL_CRC32C_X86 1
+#include <nmmintrin.h>
+#else
+#define T_STL_CRC32C_X86 0
+#endif
+
+#if defined( __aarch64__ ) && defined( __ARM_FEATURE_CRC32 )
+#define T_STL_CRC32C_ARM 1
+#include <arm_acle.h>
+#else
+#define T_STL_CRC32C_ARM 0
+#endif
+
+#include "Format.h"
+#include "../../endianness.h"
+#include "../../Error.h"
+
+namespace t
+{
+	namespace variant
+	{
+		namespace details
+		{
+			namespace crc
+			{
+				// reflected Castagnoli polynomial
+				constexpr uint32 Polynomial = 0x82f63b78;
+
+				/*
+				 * Slicing-by-8 tables: table[ k ][ b ] is the CRC of byte b followed by k zero bytes
+				 */
+				struct Tables
+				{
+					uint32 table[ 8 ][ 256 ] {};
+
+					constexpr Tables()
+					{
+						for ( uint32 b = 0; b < 256; ++b )
+						{
+							uint32 crc = b;
+
+							for ( int i = 0; i < 8; ++i )
+								crc = ( crc >> 1 ) ^ ( Polynomial & ( 0 - ( crc & 1 ) ) );
+
+							table[ 0 ][ b ] = crc;
+						}
+
+						for ( uint32 b = 0; b < 256; ++b )
+							for ( int k = 1; k < 8; ++k )
+								table[ k ][ b ] = ( table[ k - 1 ][ b ] >> 8 ) ^ table[ 0 ][ table[ k - 1 ][ b ] & 0xff ];
+					}
+				};
+
+				constexpr Tables tables;
+
+				uint32 Software( const uint8* data, uint64 size, uint32 crc )
+				{
+					auto const& t = tables.table;
+
+					for ( ; size >= 8; size -= 8, data += 8 )
+					{
+						uint32 lo, hi;
+						std::memcpy( &lo, data, sizeof( lo ) );
+						std::memcpy( &hi, data + 4, sizeof( hi ) );
+
+						if constexpr ( endianness::native != endianness::little )
+						{
+							lo = byteswap( lo );
+							hi = byteswap( hi );
+						}
+
+						lo ^= crc;
+
+						crc = t[ 7 ][ lo & 0xff ] ^ t[ 6 ][ ( lo >> 8 ) & 0xff ] ^ t[ 5 ][ ( lo >> 16 ) & 0xff ] ^ t[ 4 ][ lo >> 24 ]
+							^ t[ 3 ][ hi & 0xff ] ^ t[ 2 ][ ( hi >> 8 ) & 0xff ] ^ t[ 1 ][ ( hi >> 16 ) & 0xff ] ^ t[ 0 ][ hi >> 24 ];
+					}
+
+					for ( ; size > 0; --size, ++data )
+						crc = ( crc >> 8 ) ^ t[ 0 ][ ( crc ^ *data ) & 0xff ];
+
+					return crc;
+				}
+
+#if T_STL_CRC32C_X86
+				__attribute__(( target( "sse4.2" ) ))
+				uint32 Hardware( const uint8* data, uint64 size, uint32 crc )
+				{
+					uint64 crc64 = crc;
+
+					for ( ; size >= 8; size -= 8, data += 8 )
+					{
+						uint64 chunk;
+						std::memcpy( &chunk, data, sizeof( chunk ) );
+						crc64 = _mm_crc32_u64( crc64, chunk );
+					}
+
+					crc = uint32( crc64 );
+
+					for ( ; size > 0; --size, ++data )
+						crc = _mm_crc32_u8( crc, *data );
+
+					return crc;
+				}
+
+				bool HasHardware()
+				{
+					static bool const supported = __builtin_cpu_supports( "sse4.2" );
+					return supported;
+				}
+#elif T_STL_CRC32C_ARM
+				uint32 Hardware( const uint8* data, uint64 size, uint32 crc )
+				{
+					for ( ; size >= 8; size -= 8, data += 8 )
+					{
+						uint64 chunk;
+						std::memcpy( &chunk, data, sizeof( chunk ) );
+						crc = __crc32cd( crc, chunk );
+					}
+
+					for ( ; size > 0; --size, ++data )
+						crc = __crc32cb( crc, *data );
+
+					return crc;
+				}
+
+				constexpr bool HasHardware() { return true; }
+#endif
+			}
+		}
+
+		uint32 Crc32c( const uint8* data, uint64 size, uint32 crc )
+		{
+			crc = ~crc;
+
+#if T_STL_CRC32C_X86 || T_STL_CRC32C_ARM
+			if ( details::crc::HasHardware() )
+				return ~details::crc::Hardware( data, size, crc );
+#endif
+
+			return ~details::crc::Software( data, size, crc );
+		}
+
+		void ChecksummingSink::writeHeader()
+		{
+			constexpr uint8 header[ details::checksum::FrameHeaderSize ] = { 't', 'v', 's', 1 };
+
+			m_downstream.write( header, sizeof( header ) );
+			m_headerWritten = true;
+		}
+
+		void ChecksummingSink::write( const uint8* data, uint64 size )
+		{
+			if ( m_finished )
+			{
+				throw Error( "Cannot write to a finished checksum frame", 1 );
+			}
+
+			if ( !m_headerWritten )
+				writeHeader();
+
+			m_crc = Crc32c( data, size, m_crc );
+			m_downstream.write( data, size );
+		}
+
+		void ChecksummingSink::finish()
+		{
+			if ( m_finished )
+				return;
+
+			if ( !m_headerWritten )
+				writeHeader();
+
+			auto crc = m_crc;
+
+			if constexpr ( endianness::native != endianness::little )
+				crc = byteswap( crc );
+
+			uint8 trailer[ details::checksum::FrameTrailerSize ];
+			std::memcpy( trailer, &crc, sizeof( crc ) );
+
+			m_downstream.write( trailer, sizeof( trailer ) );
+			m_finished = true;
+		}
+
+		ArrayView< const uint8 > VerifyChecksum( const uint8* data, uint64 size )
+		{
+			constexpr auto overhead = details::checksum::FrameHeaderSize + details::checksum::FrameTrailerSize;
+
+			if ( size < overhead || data[ 0 ] != 't' || data[ 1 ] != 'v' || data[ 2 ] != 's' )
+			{
+				throw Error( "Expected a checksummed frame!", 1 );
+			}
+
+			if ( data[ 3 ] != 1 )
+			{
+				throw Error( "Unsupported checksum version!", 1 );
+			}
+
+			auto const* payload = data + details::checksum::FrameHeaderSize;
+			auto const payloadSize = size - overhead;
+
+			uint32 stored;
+			std::memcpy( &stored, payload + payloadSize, sizeof( stored ) );
+
+			if constexpr ( endianness::native != endianness::little )
+				stored = byteswap( stored );
+
+			if ( stored != Crc32c( payload, payloadSize ) )
+			{
+				throw Error( "Checksum mismatch!", 1 );
+			}
+
+			return ArrayView< const uint8 >( payload, payloadSize );
+		}
+
+		template< endianness e >
+		Array< uint8 > SerializeChecksummed( Map const& map )
+		{
+			ArraySink out;
+			ChecksummingSink checksummer( out );
+
+			Serialize< e >( map, checksummer );
+			checksummer.finish();
+
+			return out.take();
+		}
+
+		template Array< uint8 > SerializeChecksummed< endianness::little >( Map const& );
+		template Array< uint8 > SerializeChecksummed< endianness::big >( Map const& );
+	}
+}
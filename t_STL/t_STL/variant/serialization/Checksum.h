@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Serialize.h"
+#include "../../ArrayView.h"
+
+namespace t
+{
+	namespace variant
+	{
+		/*
+		 * CRC32C (Castagnoli), using the CPU's CRC instruction when there is one.
+		 * Pass the previous result as crc to checksum data that arrives in pieces
+		 */
+		uint32 Crc32c( const uint8* data, uint64 size, uint32 crc = 0 );
+
+		/*
+		 * Wraps everything written to it in a "tvs" frame, which ends with the
+		 * CRC32C of the payload. finish must be called once all data has been written
+		 */
+		class ChecksummingSink final : public Sink
+		{
+		public:
+			explicit ChecksummingSink( Sink& downstream ):
+				m_downstream( downstream ) {}
+
+			void write( const uint8* data, uint64 size ) final override;
+
+			/*
+			 * Writes the checksum, terminating the frame
+			 */
+			void finish();
+		private:
+			void writeHeader();
+		private:
+			Sink& m_downstream;
+			uint32 m_crc = 0;
+			bool m_headerWritten = false;
+			bool m_finished = false;
+		};
+
+		/*
+		 * Returns the payload of a "tvs" frame, throwing if the checksum does not match
+		 */
+		ArrayView< const uint8 > VerifyChecksum( const uint8* data, uint64 size );
+
+		/*
+		 * Serializes the map into a checksummed frame. Deserialize verifies it before decoding
+		 */
+		template< endianness = endianness::native >
+		Array< uint8 > SerializeChecksummed( Map const& map );
+
+		extern template Array< uint8 > SerializeChecksummed< endianness::little >( Map const& );
+		extern template Array< uint8 > SerializeChecksummed< endianness::big >( Map const& );
+	}
+}
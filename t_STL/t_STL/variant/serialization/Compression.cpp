@@ -0,0 +1,519 @@
+#include "Compression.h"
+
+#include <cstring>
+
+#include "../../endianness.h"
+#include "../../Error.h"
+
+namespace t
+{
+	namespace variant
+	{
+		namespace details
+		{
+			namespace lz
+			{
+				/*
+				 * Blocks are compressed independently, and never larger than
+				 * this, so match offsets always fit in 16 bits
+				 */
+				constexpr uint64 BlockSize = 64 * 1024;
+
+				//                                     raw size          stored size
+				constexpr uint64 BlockHeaderSize = sizeof( uint32 ) + sizeof( uint32 );
+
+				// set in the stored size when the block did not compress and is kept as is
+				constexpr uint32 StoredRaw = 0x80000000;
+
+				constexpr uint64 MinMatch = 4;
+
+				constexpr uint64 HashBits = 14;
+
+				// the last few bytes of a block are always literals, a match could not pay for itself there
+				constexpr uint64 TailLiterals = 12;
+
+				inline uint32 Read32( const uint8* data )
+				{
+					uint32 val;
+					std::memcpy( &val, data, sizeof( val ) );
+					return val;
+				}
+
+				inline uint32 Hash( uint32 sequence )
+				{
+					return ( sequence * 2654435761u ) >> ( 32 - HashBits );
+				}
+
+				template< typename T >
+				void WriteLittle( uint8* out, T value )
+				{
+					if constexpr ( endianness::native != endianness::little )
+						value = byteswap( value );
+
+					std::memcpy( out, &value, sizeof( T ) );
+				}
+
+				template< typename T >
+				T ReadLittle( const uint8* in )
+				{
+					T value;
+					std::memcpy( &value, in, sizeof( T ) );
+
+					if constexpr ( endianness::native != endianness::little )
+						value = byteswap( value );
+
+					return value;
+				}
+
+				/*
+				 * Bounds checked output for the compressor; running out of room
+				 * just means the block is better stored raw
+				 */
+				class Output
+				{
+				public:
+					Output( uint8* out, uint64 capacity ):
+						m_begin( out ),
+						m_pos( out ),
+						m_end( out + capacity ) {}
+
+					bool put( uint8 byte )
+					{
+						if ( m_pos == m_end )
+							return false;
+
+						*m_pos++ = byte;
+						return true;
+					}
+
+					bool put( const uint8* data, uint64 size )
+					{
+						if ( size > uint64( m_end - m_pos ) )
+							return false;
+
+						std::memcpy( m_pos, data, size );
+						m_pos += size;
+						return true;
+					}
+
+					/*
+					 * The part of a length that did not fit in its token nibble, 255 at a time
+					 */
+					bool putLength( uint64 length )
+					{
+						for ( ; length >= 255; length -= 255 )
+						{
+							if ( !put( 255 ) )
+								return false;
+						}
+
+						return put( uint8( length ) );
+					}
+
+					uint64 size() const { return uint64( m_pos - m_begin ); }
+				private:
+					uint8* m_begin;
+					uint8* m_pos;
+					uint8* m_end;
+				};
+
+				/*
+				 * A token byte holds the literal count and the match length in a nibble
+				 * each, followed by the literals, then the 16-bit match offset
+				 */
+				bool EmitSequence( Output& out, const uint8* literals, uint64 literalCount, uint64 offset, uint64 matchLength )
+				{
+					auto const matchCode = matchLength - MinMatch;
+
+					uint8 const token = uint8( ( literalCount < 15 ? literalCount : 15 ) << 4 )
+						| uint8( matchCode < 15 ? matchCode : 15 );
+
+					if ( !out.put( token ) )
+						return false;
+
+					if ( literalCount >= 15 && !out.putLength( literalCount - 15 ) )
+						return false;
+
+					if ( !out.put( literals, literalCount ) )
+						return false;
+
+					uint8 offsetBytes[ 2 ];
+					WriteLittle( offsetBytes, uint16( offset ) );
+
+					if ( !out.put( offsetBytes, 2 ) )
+						return false;
+
+					return matchCode < 15 || out.putLength( matchCode - 15 );
+				}
+
+				bool EmitLastLiterals( Output& out, const uint8* literals, uint64 literalCount )
+				{
+					if ( !out.put( uint8( ( literalCount < 15 ? literalCount : 15 ) << 4 ) ) )
+						return false;
+
+					if ( literalCount >= 15 && !out.putLength( literalCount - 15 ) )
+						return false;
+
+					return out.put( literals, literalCount );
+				}
+
+				/*
+				 * Returns the compressed size, or 0 if the block would not get any smaller
+				 */
+				uint64 CompressBlock( const uint8* src, uint64 size, uint8* dst, uint64 capacity, uint32* table, uint32 acceleration )
+				{
+					std::memset( table, 0, sizeof( uint32 ) << HashBits );
+
+					Output out( dst, capacity );
+
+					uint64 anchor = 0;
+					uint64 pos = 0;
+					uint64 misses = 0;
+
+					auto const matchLimit = size > TailLiterals ? size - TailLiterals : 0;
+
+					while ( pos < matchLimit )
+					{
+						auto const sequence = Read32( src + pos );
+						auto const hash = Hash( sequence );
+						uint64 candidate = table[ hash ];
+						table[ hash ] = uint32( pos );
+
+						if ( candidate >= pos || Read32( src + candidate ) != sequence )
+						{
+							// the longer nothing matches, the faster we skip ahead
+							pos += acceleration + ( misses++ >> 5 );
+							continue;
+						}
+
+						auto length = MinMatch;
+
+						while ( pos + length < size && src[ candidate + length ] == src[ pos + length ] )
+							++length;
+
+						while ( pos > anchor && candidate > 0 && src[ pos - 1 ] == src[ candidate - 1 ] )
+						{
+							--pos;
+							--candidate;
+							++length;
+						}
+
+						if ( !EmitSequence( out, src + anchor, pos - anchor, pos - candidate, length ) )
+							return 0;
+
+						pos += length;
+						anchor = pos;
+						misses = 0;
+
+						if ( pos - 2 < matchLimit )
+							table[ Hash( Read32( src + pos - 2 ) ) ] = uint32( pos - 2 );
+					}
+
+					if ( !EmitLastLiterals( out, src + anchor, size - anchor ) )
+						return 0;
+
+					return out.size() < size ? out.size() : 0;
+				}
+
+				/*
+				 * Checks every length and offset against the buffers, so corrupt input cannot escape them
+				 */
+				void DecompressBlock( const uint8* src, uint64 size, uint8* dst, uint64 rawSize )
+				{
+					uint64 in = 0;
+					uint64 out = 0;
+
+					auto const readLength = [ & ]( uint64 length )
+					{
+						if ( length != 15 )
+							return length;
+
+						uint8 byte;
+
+						do
+						{
+							if ( in == size )
+								throw Error( "Compressed block is truncated!", 1 );
+
+							byte = src[ in++ ];
+							length += byte;
+						} while ( byte == 255 );
+
+						return length;
+					};
+
+					while ( true )
+					{
+						if ( in == size )
+							throw Error( "Compressed block is truncated!", 1 );
+
+						auto const token = src[ in++ ];
+
+						auto const literalCount = readLength( token >> 4 );
+
+						if ( literalCount > size - in || literalCount > rawSize - out )
+							throw Error( "Compressed block is corrupt!", 1 );
+
+						std::memcpy( dst + out, src + in, literalCount );
+						in += literalCount;
+						out += literalCount;
+
+						// the last sequence has no match
+						if ( in == size )
+							break;
+
+						if ( size - in < 2 )
+							throw Error( "Compressed block is truncated!", 1 );
+
+						auto const offset = ReadLittle< uint16 >( src + in );
+						in += 2;
+
+						auto const matchLength = readLength( token & 15 ) + MinMatch;
+
+						if ( offset == 0 || offset > out || matchLength > rawSize - out )
+							throw Error( "Compressed block is corrupt!", 1 );
+
+						auto const* match = dst + out - offset;
+
+						if ( offset >= matchLength )
+						{
+							std::memcpy( dst + out, match, matchLength );
+						}
+						else
+						{
+							// overlapping copies repeat the last offset bytes
+							for ( uint64 i = 0; i < matchLength; ++i )
+								dst[ out + i ] = match[ i ];
+						}
+
+						out += matchLength;
+					}
+
+					if ( out != rawSize )
+						throw Error( "Compressed block has the wrong size!", 1 );
+				}
+			}
+		}
+
+		CompressingSink::CompressingSink( Sink& downstream, CompressionOptions options ):
+			m_downstream( downstream ),
+			m_options( options ),
+			m_block( details::lz::BlockSize ),
+			m_compressed( details::lz::BlockHeaderSize + details::lz::BlockSize ),
+			m_table( uint64( 1 ) << details::lz::HashBits )
+		{
+			if ( m_options.acceleration == 0 )
+				m_options.acceleration = 1;
+		}
+
+		void CompressingSink::write( const uint8* data, uint64 size )
+		{
+			if ( m_finished )
+			{
+				throw Error( "Cannot write to a finished compressor!", 1 );
+			}
+
+			writeHeader();
+
+			while ( size > 0 )
+			{
+				auto const space = m_block.size() - m_used;
+				auto const count = size < space ? size : space;
+
+				std::memcpy( m_block.data() + m_used, data, count );
+				m_used += count;
+				data += count;
+				size -= count;
+
+				if ( m_used == m_block.size() )
+					flushBlock();
+			}
+		}
+
+		void CompressingSink::finish()
+		{
+			if ( m_finished )
+				return;
+
+			writeHeader();
+			flushBlock();
+
+			// a block header with no data ends the frame
+			uint8 end[ details::lz::BlockHeaderSize ] = {};
+			m_downstream.write( end, sizeof( end ) );
+
+			m_finished = true;
+		}
+
+		void CompressingSink::writeHeader()
+		{
+			if ( m_headerWritten )
+				return;
+
+			constexpr uint8 header[] = { 't', 'v', 'z', 1 };
+			m_downstream.write( header, sizeof( header ) );
+
+			m_headerWritten = true;
+		}
+
+		void CompressingSink::flushBlock()
+		{
+			using namespace details::lz;
+
+			if ( m_used == 0 )
+				return;
+
+			auto* out = m_compressed.data();
+
+			auto const compressedSize = CompressBlock( m_block.data(), m_used, out + BlockHeaderSize,
+				m_compressed.size() - BlockHeaderSize, m_table.data(), m_options.acceleration );
+
+			WriteLittle( out, uint32( m_used ) );
+
+			if ( compressedSize == 0 )
+			{
+				WriteLittle( out + sizeof( uint32 ), uint32( m_used ) | StoredRaw );
+				m_downstream.write( out, BlockHeaderSize );
+				m_downstream.write( m_block.data(), m_used );
+			}
+			else
+			{
+				WriteLittle( out + sizeof( uint32 ), uint32( compressedSize ) );
+				m_downstream.write( out, BlockHeaderSize + compressedSize );
+			}
+
+			m_used = 0;
+		}
+
+		DecompressingSink::DecompressingSink( Sink& downstream ):
+			m_downstream( downstream ),
+			m_pending( details::lz::BlockSize ),
+			m_block( details::lz::BlockSize ),
+			m_needed( 4 ) {}
+
+		void DecompressingSink::write( const uint8* data, uint64 size )
+		{
+			while ( size > 0 )
+			{
+				if ( m_state == State::Done )
+				{
+					throw Error( "Data after the end of the compressed frame!", 1 );
+				}
+
+				auto const missing = m_needed - m_pendingSize;
+				auto const count = size < missing ? size : missing;
+
+				std::memcpy( m_pending.data() + m_pendingSize, data, count );
+				m_pendingSize += count;
+				data += count;
+				size -= count;
+
+				if ( m_pendingSize == m_needed )
+				{
+					process();
+					m_pendingSize = 0;
+				}
+			}
+		}
+
+		void DecompressingSink::process()
+		{
+			using namespace details::lz;
+
+			auto const* data = m_pending.data();
+
+			switch ( m_state )
+			{
+			case State::Header:
+				if ( data[ 0 ] != 't' || data[ 1 ] != 'v' || data[ 2 ] != 'z' || data[ 3 ] != 1 )
+				{
+					throw Error( "Expected valid compressed frame header!", 1 );
+				}
+
+				m_state = State::BlockHeader;
+				m_needed = BlockHeaderSize;
+				return;
+			case State::BlockHeader:
+			{
+				m_rawSize = ReadLittle< uint32 >( data );
+
+				if ( m_rawSize == 0 )
+				{
+					m_state = State::Done;
+					return;
+				}
+
+				auto const stored = ReadLittle< uint32 >( data + sizeof( uint32 ) );
+
+				m_storedRaw = ( stored & StoredRaw ) != 0;
+				m_needed = stored & ~StoredRaw;
+
+				if ( m_rawSize > BlockSize || m_needed > BlockSize || m_needed == 0 || ( m_storedRaw && m_needed != m_rawSize ) )
+				{
+					throw Error( "Invalid compressed block header!", 1 );
+				}
+
+				m_state = State::Block;
+				return;
+			}
+			case State::Block:
+				if ( m_storedRaw )
+				{
+					m_downstream.write( data, m_rawSize );
+				}
+				else
+				{
+					DecompressBlock( data, m_needed, m_block.data(), m_rawSize );
+					m_downstream.write( m_block.data(), m_rawSize );
+				}
+
+				m_state = State::BlockHeader;
+				m_needed = BlockHeaderSize;
+				return;
+			case State::Done:
+				return;
+			}
+		}
+
+		Array< uint8 > Compress( const uint8* data, uint64 size, CompressionOptions options )
+		{
+			ArraySink out;
+			CompressingSink compressor( out, options );
+
+			compressor.write( data, size );
+			compressor.finish();
+
+			return out.take();
+		}
+
+		Array< uint8 > Decompress( const uint8* data, uint64 size )
+		{
+			ArraySink out;
+			DecompressingSink decompressor( out );
+
+			decompressor.write( data, size );
+
+			if ( !decompressor.finished() )
+			{
+				throw Error( "Compressed frame is truncated!", 1 );
+			}
+
+			return out.take();
+		}
+
+		template< endianness e >
+		Array< uint8 > SerializeCompressed( Map const& map, CompressionOptions options )
+		{
+			ArraySink out;
+			CompressingSink compressor( out, options );
+
+			Serialize< e >( map, compressor );
+			compressor.finish();
+
+			return out.take();
+		}
+
+		template Array< uint8 > SerializeCompressed< endianness::little >( Map const&, CompressionOptions );
+		template Array< uint8 > SerializeCompressed< endianness::big >( Map const&, CompressionOptions );
+	}
+}
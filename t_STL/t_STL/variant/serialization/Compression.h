@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Serialize.h"
+
+namespace t
+{
+	namespace variant
+	{
+		struct CompressionOptions
+		{
+			/*
+			 * 1 searches hardest for matches. Larger values skip ahead faster
+			 * through data that is not compressing, trading ratio for speed
+			 */
+			uint32 acceleration = 1;
+		};
+
+		/*
+		 * Compresses everything written to it into a "tvz" frame of independently
+		 * compressed blocks, forwarding each block to the downstream sink as soon
+		 * as it is full. finish must be called once all data has been written
+		 */
+		class CompressingSink final : public Sink
+		{
+		public:
+			explicit CompressingSink( Sink& downstream, CompressionOptions options = {} );
+
+			void write( const uint8* data, uint64 size ) final override;
+
+			/*
+			 * Compresses whatever is buffered and terminates the frame
+			 */
+			void finish();
+		private:
+			void writeHeader();
+
+			void flushBlock();
+		private:
+			Sink& m_downstream;
+			CompressionOptions m_options;
+			Array< uint8 > m_block;
+			Array< uint8 > m_compressed;
+			Array< uint32 > m_table;
+			uint64 m_used = 0;
+			bool m_headerWritten = false;
+			bool m_finished = false;
+		};
+
+		/*
+		 * Accepts a "tvz" frame in chunks of any size and forwards the
+		 * decompressed data to the downstream sink a block at a time
+		 */
+		class DecompressingSink final : public Sink
+		{
+		public:
+			explicit DecompressingSink( Sink& downstream );
+
+			void write( const uint8* data, uint64 size ) final override;
+
+			/*
+			 * Whether the end of the frame has been reached
+			 */
+			[[nodiscard]] bool finished() const { return m_state == State::Done; }
+		private:
+			enum class State : uint8
+			{
+				Header,
+				BlockHeader,
+				Block,
+				Done
+			};
+
+			void process();
+		private:
+			Sink& m_downstream;
+			Array< uint8 > m_pending;
+			Array< uint8 > m_block;
+			uint64 m_pendingSize = 0;
+			uint64 m_needed;
+			uint32 m_rawSize = 0;
+			bool m_storedRaw = false;
+			State m_state = State::Header;
+		};
+
+		Array< uint8 > Compress( const uint8* data, uint64 size, CompressionOptions options = {} );
+
+		Array< uint8 > Decompress( const uint8* data, uint64 size );
+
+		/*
+		 * Serializes straight into the compressor, so the uncompressed encoding is never held in full
+		 */
+		template< endianness = endianness::native >
+		Array< uint8 > SerializeCompressed( Map const& map, CompressionOptions options = {} );
+
+		extern template Array< uint8 > SerializeCompressed< endianness::little >( Map const&, CompressionOptions );
+		extern template Array< uint8 > SerializeCompressed< endianness::big >( Map const&, CompressionOptions );
+	}
+}
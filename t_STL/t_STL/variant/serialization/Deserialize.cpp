@@ -1,5 +1,8 @@
-#include <cassert>
+#include <cstring>
 #include "Deserialize.h"
+#include "Format.h"
+#include "Compression.h"
+#include "Checksum.h"
 
 #include "../../endianness.h"
 #include "../../Error.h"
@@ -24,44 +27,63 @@ namespace t
 			return val;
 		}
 
-		String DeserializeString( const uint8* buffer, uint64& bufferOffset, bool swapbytes )
+		/*
+		 * Each read is covered by one of these, spanning as much of the value as is known up front
+		 */
+		inline void RequireBytes( uint64 bufferSize, uint64 bufferOffset, uint64 size )
 		{
+			if ( size > bufferSize - bufferOffset )
+			{
+				throw Error( "Invalid buffer length! Value runs past the end!", 1 );
+			}
+		}
+
+		String DeserializeString( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, bool swapbytes )
+		{
+			RequireBytes( bufferSize, bufferOffset, sizeof( uint32 ) );
 			auto length = ReadValueFromBuffer< uint32 >( &buffer[ bufferOffset ], swapbytes );
 			bufferOffset += sizeof( length );
+			RequireBytes( bufferSize, bufferOffset, length );
 			auto str = String( reinterpret_cast< const char* >( &buffer[ bufferOffset ] ), length );
 			bufferOffset += length;
 			return str;
 		}
 
 		template< typename T >
-		Value DeserializeArray( const uint8* buffer, uint64& bufferOffset, uint64 numel, const bool swapbytes )
+		Value DeserializeArray( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 numel, const bool swapbytes )
 		{
 			if constexpr ( std::is_same_v< T, Array< String > > )
 			{
+				// every string takes at least its length, which bounds numel before allocating
+				if ( numel > ( bufferSize - bufferOffset ) / sizeof( uint32 ) )
+				{
+					throw Error( "Invalid buffer length! Array runs past the end!", 1 );
+				}
+
 				Array< String > vec( numel );
 
 				for ( uint64 i = 0; i < numel; ++i )
 				{
-					vec[ i ] = DeserializeString( buffer, bufferOffset, swapbytes );
+					vec[ i ] = DeserializeString( buffer, bufferSize, bufferOffset, swapbytes );
 				}
 
 				return Value( std::move( vec ) );
 			}
 			else
 			{
-				T vec( numel );
-
-				auto reinterp_buffer = reinterpret_cast< const T::ValueType* >( &buffer[ bufferOffset ] );
-
-				for ( uint64 i = 0; i < numel; ++i )
+				if ( numel > ( bufferSize - bufferOffset ) / sizeof( typename T::ValueType ) )
 				{
-					auto val = reinterp_buffer[ i ];
+					throw Error( "Invalid buffer length! Array runs past the end!", 1 );
+				}
 
-					if ( swapbytes )
-						val = byteswap( val );
+				T vec( numel );
 
-					vec[ i ] = val;
-				}
+				// the buffer has no alignment guarantees, so copy rather than cast
+				if ( numel != 0 )
+					std::memcpy( vec.data(), &buffer[ bufferOffset ], sizeof( typename T::ValueType ) * numel );
+
+				if ( swapbytes )
+					byteswapInPlace( vec.data(), numel );
 
 				bufferOffset += sizeof( typename T::ValueType ) * numel;
 
@@ -70,18 +92,15 @@ namespace t
 		}
 
 		template< typename T >
-		Value DeserializeValue( const uint8* buffer, uint64& bufferOffset, const bool swapbytes )
+		Value DeserializeValue( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, const bool swapbytes )
 		{
 			if constexpr ( std::is_same_v< T, String > )
 			{
-				auto length = ReadValueFromBuffer< uint32 >( &buffer[ bufferOffset ], swapbytes );
-				bufferOffset += sizeof( length );
-				auto str = String( reinterpret_cast<const char*>( &buffer[ bufferOffset ] ), length );
-				bufferOffset += length;
-				return Value( std::move( str ) );
+				return Value( DeserializeString( buffer, bufferSize, bufferOffset, swapbytes ) );
 			}
 			else
 			{
+				RequireBytes( bufferSize, bufferOffset, sizeof( T ) );
 				auto val = ReadValueFromBuffer< T >( &buffer[bufferOffset], swapbytes );
 				bufferOffset += sizeof( val );
 				return Value( val );
@@ -93,51 +112,31 @@ namespace t
 			return Value();
 		}
 
-		namespace bitstream_v1
-		{
-			Map Deserialize( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset );
-		}
+		/*
+		 * Reads a map of any version, starting at its "tvm" header
+		 */
+		Map DeserializeMap( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 depth );
 
-		void DeserializeAndInsertMap( Map& map, String&& key, const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, const bool /*swapbytes*/)
+		void DeserializeAndInsertMap( Map& map, String&& key, const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 depth )
 		{
-			//                "tvm<n>"     endianness         numel
-			if ( bufferSize < 4 + sizeof( uint16 ) + sizeof( uint64 ) )
-			{
-				throw Error( "Invalid buffer length! Must be long enough for Header!", 1 );
-			}
-			const auto t = buffer[ bufferOffset ];
-			const auto v = buffer[ bufferOffset + 1 ];
-			const auto m = buffer[ bufferOffset + 2 ];
-
-			if ( t != 't' || v != 'v' || m != 'm' )
-			{
-				throw Error( "Expected valid Header!", 1 );
-			}
-
-			const auto version = buffer[ bufferOffset + 3 ];
-
-			if ( version != 1 )
-				throw Error( "Invalid Map version!", 1 );
-
-			bufferOffset += 4;
-
-			map.insert( { std::move( key ), Value( bitstream_v1::Deserialize( buffer, bufferSize, bufferOffset ) ) } );
+			map.insert( { std::move( key ), Value( DeserializeMap( buffer, bufferSize, bufferOffset, depth + 1 ) ) } );
 		}
 
 		namespace bitstream_v1
 		{
 			template< typename T >
-			void DeserializeAndInsertArray( Map& map, String&& key, const uint8* buffer, uint64& bufferOffset, bool swapbytes )
+			void DeserializeAndInsertArray( Map& map, String&& key, const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, bool swapbytes )
 			{
+				RequireBytes( bufferSize, bufferOffset, sizeof( uint64 ) );
 				auto numel = ReadValueFromBuffer< uint64 >( &buffer[ bufferOffset ], swapbytes );
 				bufferOffset += sizeof( uint64 );
-				map.insert( { std::move( key ), DeserializeArray< T >( buffer, bufferOffset, numel, swapbytes ) } );
+				map.insert( { std::move( key ), DeserializeArray< T >( buffer, bufferSize, bufferOffset, numel, swapbytes ) } );
 			}
 
 			template< typename T >
-			void DeserializeAndInsertValue( Map& map, String&& key, const uint8* buffer, uint64& bufferOffset, bool swapbytes )
+			void DeserializeAndInsertValue( Map& map, String&& key, const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, bool swapbytes )
 			{
-				map.insert( { std::move( key ), DeserializeValue< T >( buffer, bufferOffset, swapbytes ) } );
+				map.insert( { std::move( key ), DeserializeValue< T >( buffer, bufferSize, bufferOffset, swapbytes ) } );
 			}
 
 			void DeserializeAndInsertEmptyValue( Map& map, String&& key )
@@ -145,25 +144,20 @@ namespace t
 				map.insert( { std::move( key ), DeserializeEmptyValue() } );
 			}
 
-			Map Deserialize( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset )
+			Map DeserializeEntries( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 numel, const bool swapbytes, uint64 depth )
 			{
-				auto const endianness = *reinterpret_cast< const uint16* >( &buffer[ bufferOffset ] );
-				bufferOffset += sizeof( uint16 );
-
-				const bool swapbytes = endianness != 1;
-
-				auto numel = *reinterpret_cast< const uint64* >( &buffer[ bufferOffset ] );
-
-				if ( swapbytes )
-					numel = byteswap( numel );
-
-				bufferOffset += sizeof( uint64 );
-
 				Map out_vm;
 
 				for ( uint64 numel_found = 0; numel_found < numel; ++numel_found )
 				{
-					String key = DeserializeString( buffer, bufferOffset, swapbytes );
+					RequireBytes( bufferSize, bufferOffset, sizeof( uint32 ) );
+					auto const keyLength = ReadValueFromBuffer< uint32 >( &buffer[ bufferOffset ], swapbytes );
+					bufferOffset += sizeof( uint32 );
+
+					// the key and the type byte after it
+					RequireBytes( bufferSize, bufferOffset, uint64( keyLength ) + sizeof( Type ) );
+					String key( reinterpret_cast< const char* >( &buffer[ bufferOffset ] ), keyLength );
+					bufferOffset += keyLength;
 
 					Type type = static_cast< Type >( buffer[ bufferOffset ] );
 					bufferOffset += sizeof( Type );
@@ -174,104 +168,488 @@ namespace t
 						DeserializeAndInsertEmptyValue( out_vm, std::move( key ) );
 						continue;
 					case Type::INT8:
-						DeserializeAndInsertValue< int8 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< int8 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT16:
-						DeserializeAndInsertValue< int16 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< int16 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT32:
-						DeserializeAndInsertValue< int32 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< int32 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT64:
-						DeserializeAndInsertValue< int64 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< int64 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT8:
-						DeserializeAndInsertValue< uint8 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< uint8 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT16:
-						DeserializeAndInsertValue< uint16 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< uint16 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT32:
-						DeserializeAndInsertValue< uint32 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< uint32 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT64:
-						DeserializeAndInsertValue< uint64 >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< uint64 >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::FLOAT:
-						DeserializeAndInsertValue< float >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< float >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::DOUBLE:
-						DeserializeAndInsertValue< double >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< double >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::STRING:
-						DeserializeAndInsertValue< String >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertValue< String >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::MAP:
-						DeserializeAndInsertMap( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
+						DeserializeAndInsertMap( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, depth );
 						continue;
 					case Type::INT8_ARRAY:
-						DeserializeAndInsertArray< Array< int8 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< int8 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT16_ARRAY:
-						DeserializeAndInsertArray< Array< int16 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< int16 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT32_ARRAY:
-						DeserializeAndInsertArray< Array< int32 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< int32 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::INT64_ARRAY:
-						DeserializeAndInsertArray< Array< int64 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< int64 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT8_ARRAY:
-						DeserializeAndInsertArray< Array< uint8 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< uint8 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT16_ARRAY:
-						DeserializeAndInsertArray< Array< uint16 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< uint16 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT32_ARRAY:
-						DeserializeAndInsertArray< Array< uint32 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< uint32 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::UINT64_ARRAY:
-						DeserializeAndInsertArray< Array< uint64 > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< uint64 > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::FLOAT_ARRAY:
-						DeserializeAndInsertArray< Array< float > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< float > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::DOUBLE_ARRAY:
-						DeserializeAndInsertArray< Array< double > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< double > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					case Type::STRING_ARRAY:
-						DeserializeAndInsertArray< Array< String > >( out_vm, std::move( key ), buffer, bufferOffset, swapbytes );
+						DeserializeAndInsertArray< Array< String > >( out_vm, std::move( key ), buffer, bufferSize, bufferOffset, swapbytes );
 						continue;
 					}
-					assert( false );
+
+					throw Error( "Invalid value type!", 1 );
 				}
 
 				return out_vm;
 			}
+
+			Map Deserialize( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 depth )
+			{
+				auto const endianness = ReadValueFromBuffer< uint16 >( &buffer[ bufferOffset ], false );
+				bufferOffset += sizeof( uint16 );
+
+				const bool swapbytes = endianness != 1;
+
+				auto const numel = ReadValueFromBuffer< uint64 >( &buffer[ bufferOffset ], swapbytes );
+				bufferOffset += sizeof( uint64 );
+
+				return DeserializeEntries( buffer, bufferSize, bufferOffset, numel, swapbytes, depth );
+			}
 		}
 
-		Map Deserialize( const uint8* buffer, uint64 bufferSize )
+		namespace bitstream_v2
+		{
+			Map Deserialize( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 depth )
+			{
+				auto const mapStart = bufferOffset - 4;
+
+				if ( bufferSize - mapStart < details::v2::MapHeaderSize )
+				{
+					throw Error( "Invalid buffer length! Must be long enough for Header!", 1 );
+				}
+
+				auto const endianness = ReadValueFromBuffer< uint16 >( &buffer[ bufferOffset ], false );
+				bufferOffset += sizeof( uint16 );
+
+				const bool swapbytes = endianness != 1;
+
+				// flags only describe the index, which a full decode does not need
+				bufferOffset += sizeof( uint8 );
+
+				auto const numel = ReadValueFromBuffer< uint64 >( &buffer[ bufferOffset ], swapbytes );
+				bufferOffset += sizeof( uint64 );
+
+				auto const byteLength = ReadValueFromBuffer< uint64 >( &buffer[ bufferOffset ], swapbytes );
+				bufferOffset += sizeof( uint64 );
+
+				if ( byteLength > bufferSize - mapStart )
+				{
+					throw Error( "Invalid buffer length! Map runs past the end!", 1 );
+				}
+
+				if ( byteLength < details::v2::MapHeaderSize )
+				{
+					throw Error( "Invalid map length!", 1 );
+				}
+
+				// the entries must end within the map, before its index
+				auto map = bitstream_v1::DeserializeEntries( buffer, mapStart + byteLength, bufferOffset, numel, swapbytes, depth );
+
+				// step over the index
+				bufferOffset = mapStart + byteLength;
+
+				return map;
+			}
+		}
+
+		namespace compact
+		{
+			/*
+			 * Bounds checked cursor over a compact message
+			 */
+			class Reader
+			{
+			public:
+				Reader( const uint8* buffer, uint64 size, uint64 offset ):
+					m_buffer( buffer ),
+					m_size( size ),
+					m_offset( offset ) {}
+
+				const uint8* take( uint64 size )
+				{
+					if ( size > m_size - m_offset )
+					{
+						throw Error( "Compact message is truncated!", 1 );
+					}
+
+					auto const* data = m_buffer + m_offset;
+					m_offset += size;
+					return data;
+				}
+
+				uint8 readByte()
+				{
+					return *take( 1 );
+				}
+
+				uint64 readVarint()
+				{
+					uint64 value = 0;
+
+					for ( uint64 shift = 0; shift < 64; shift += 7 )
+					{
+						auto const byte = readByte();
+
+						value |= uint64( byte & 0x7f ) << shift;
+
+						if ( ( byte & 0x80 ) == 0 )
+							return value;
+					}
+
+					throw Error( "Invalid varint!", 1 );
+				}
+
+				/*
+				 * A count of things that each take at least one byte, so it cannot exceed what is left
+				 */
+				uint64 readCount()
+				{
+					auto const count = readVarint();
+
+					if ( count > m_size - m_offset )
+					{
+						throw Error( "Compact message is truncated!", 1 );
+					}
+
+					return count;
+				}
+
+				template< typename T >
+				T readInteger()
+				{
+					if constexpr ( sizeof( T ) == 1 )
+					{
+						return T( readByte() );
+					}
+					else if constexpr ( type::is_signed< T > )
+					{
+						auto const value = details::compact::UnZigZag( readVarint() );
+
+						if ( value < int64( limit< T >::min ) || value > int64( limit< T >::max ) )
+							throw Error( "Integer out of range!", 1 );
+
+						return T( value );
+					}
+					else
+					{
+						auto const value = readVarint();
+
+						if ( value > uint64( limit< T >::max ) )
+							throw Error( "Integer out of range!", 1 );
+
+						return T( value );
+					}
+				}
+
+				template< typename T >
+				T readRaw()
+				{
+					T val;
+					std::memcpy( &val, take( sizeof( T ) ), sizeof( T ) );
+
+					if constexpr ( endianness::native != endianness::little )
+						val = byteswap( val );
+
+					return val;
+				}
+
+				StringView readString()
+				{
+					auto const length = readCount();
+					return StringView( reinterpret_cast< const char* >( take( length ) ), length );
+				}
+			private:
+				const uint8* m_buffer;
+				uint64 m_size;
+				uint64 m_offset;
+			};
+
+			template< typename T >
+			Value DeserializeArray( Reader& reader )
+			{
+				auto const numel = reader.readCount();
+
+				Array< T > arr( numel );
+
+				if constexpr ( type::is_floating_point< T > || sizeof( T ) == 1 )
+				{
+					if ( numel > 0 )
+						std::memcpy( arr.data(), reader.take( numel * sizeof( T ) ), numel * sizeof( T ) );
+
+					if constexpr ( sizeof( T ) > 1 && endianness::native != endianness::little )
+						byteswapInPlace( arr.data(), numel );
+				}
+				else
+				{
+					using Unsigned = std::make_unsigned_t< T >;
+
+					Unsigned previous = 0;
+
+					for ( uint64 i = 0; i < numel; ++i )
+					{
+						previous = Unsigned( previous + Unsigned( details::compact::UnZigZag( reader.readVarint() ) ) );
+						arr[ i ] = T( previous );
+					}
+				}
+
+				return Value( std::move( arr ) );
+			}
+
+			Map Deserialize( Reader& reader, Array< String >& keys, uint64 depth );
+
+			Value DeserializeValue( Reader& reader, Type type, Array< String >& keys, uint64 depth )
+			{
+				switch ( type )
+				{
+				case Type::VOID:
+					return Value();
+				case Type::INT8:
+					return Value( reader.readInteger< int8 >() );
+				case Type::INT16:
+					return Value( reader.readInteger< int16 >() );
+				case Type::INT32:
+					return Value( reader.readInteger< int32 >() );
+				case Type::INT64:
+					return Value( reader.readInteger< int64 >() );
+				case Type::UINT8:
+					return Value( reader.readInteger< uint8 >() );
+				case Type::UINT16:
+					return Value( reader.readInteger< uint16 >() );
+				case Type::UINT32:
+					return Value( reader.readInteger< uint32 >() );
+				case Type::UINT64:
+					return Value( reader.readInteger< uint64 >() );
+				case Type::FLOAT:
+					return Value( reader.readRaw< float >() );
+				case Type::DOUBLE:
+					return Value( reader.readRaw< double >() );
+				case Type::STRING:
+					return Value( String( reader.readString() ) );
+				case Type::MAP:
+					return Value( Deserialize( reader, keys, depth + 1 ) );
+				case Type::INT8_ARRAY:
+					return DeserializeArray< int8 >( reader );
+				case Type::INT16_ARRAY:
+					return DeserializeArray< int16 >( reader );
+				case Type::INT32_ARRAY:
+					return DeserializeArray< int32 >( reader );
+				case Type::INT64_ARRAY:
+					return DeserializeArray< int64 >( reader );
+				case Type::UINT8_ARRAY:
+					return DeserializeArray< uint8 >( reader );
+				case Type::UINT16_ARRAY:
+					return DeserializeArray< uint16 >( reader );
+				case Type::UINT32_ARRAY:
+					return DeserializeArray< uint32 >( reader );
+				case Type::UINT64_ARRAY:
+					return DeserializeArray< uint64 >( reader );
+				case Type::FLOAT_ARRAY:
+					return DeserializeArray< float >( reader );
+				case Type::DOUBLE_ARRAY:
+					return DeserializeArray< double >( reader );
+				case Type::STRING_ARRAY:
+				{
+					auto const numel = reader.readCount();
+
+					Array< String > arr( numel );
+
+					for ( uint64 i = 0; i < numel; ++i )
+						arr[ i ] = String( reader.readString() );
+
+					return Value( std::move( arr ) );
+				}
+				}
+
+				throw Error( "Invalid value type!", 1 );
+			}
+
+			Map Deserialize( Reader& reader, Array< String >& keys, uint64 depth )
+			{
+				// nesting is only bounded by the input, so guard the stack against hostile messages
+				if ( depth > details::MaxNestingDepth )
+				{
+					throw Error( "Maps are nested too deeply!", 1 );
+				}
+
+				auto const numel = reader.readCount();
+
+				Map map;
+
+				for ( uint64 i = 0; i < numel; ++i )
+				{
+					auto const tag = reader.readByte();
+					auto const type = static_cast< Type >( tag & ~details::compact::NewKey );
+
+					String key;
+
+					if ( tag & details::compact::NewKey )
+					{
+						key = String( reader.readString() );
+						keys.pushBack( key );
+					}
+					else
+					{
+						auto const index = reader.readVarint();
+
+						if ( index >= keys.size() )
+						{
+							throw Error( "Invalid key reference!", 1 );
+						}
+
+						key = keys[ index ];
+					}
+
+					if ( map.find( key ) != nullptr )
+					{
+						throw Error( "Duplicate key in map!", 1 );
+					}
+
+					auto value = DeserializeValue( reader, type, keys, depth );
+
+					map.insert( { std::move( key ), std::move( value ) } );
+				}
+
+				return map;
+			}
+
+			Map DeserializeMessage( const uint8* buffer, uint64 bufferSize )
+			{
+				if ( bufferSize < details::compact::MessageHeaderSize )
+				{
+					throw Error( "Invalid buffer length! Must be long enough for Header!", 1 );
+				}
+
+				if ( buffer[ 3 ] != 1 )
+					throw Error( "Invalid compact message version!", 1 );
+
+				Reader reader( buffer, bufferSize, details::compact::MessageHeaderSize );
+
+				Array< String > keys;
+
+				return Deserialize( reader, keys, 0 );
+			}
+		}
+
+		Map DeserializeMap( const uint8* buffer, uint64 bufferSize, uint64& bufferOffset, uint64 depth )
 		{
-			//            "tvm<n>"    endianness         numel
-			if ( bufferSize < 4 + sizeof( uint16 ) + sizeof( uint64 ) )
+			if ( depth > details::MaxNestingDepth )
+			{
+				throw Error( "Maps are nested too deeply!", 1 );
+			}
+
+			if ( bufferSize - bufferOffset < details::MapHeaderSize )
 			{
 				throw Error( "Invalid buffer length! Must be long enough for Header!", 1 );
 			}
-			const auto t = buffer[ 0 ];
-			const auto v = buffer[ 1 ];
-			const auto m = buffer[ 2 ];
+			const auto t = buffer[ bufferOffset ];
+			const auto v = buffer[ bufferOffset + 1 ];
+			const auto m = buffer[ bufferOffset + 2 ];
 
 			if ( t != 't' || v != 'v' || m != 'm' )
 				throw Error( "Expected valid Header!", 1 );
 
-			const auto version = buffer[ 3 ];
+			const auto version = buffer[ bufferOffset + 3 ];
+
+			bufferOffset += 4;
+
+			switch ( version )
+			{
+			case 1:
+				return bitstream_v1::Deserialize( buffer, bufferSize, bufferOffset, depth );
+			case 2:
+				return bitstream_v2::Deserialize( buffer, bufferSize, bufferOffset, depth );
+			}
+
+			throw Error( "Invalid Map version!", 1 );
+		}
+
+		/*
+		 * Each layer of framing is accepted once, in a fixed order, so
+		 * hostile input cannot nest frames to exhaust the stack
+		 */
+		Map DeserializeEncoding( const uint8* buffer, uint64 bufferSize )
+		{
+			if ( bufferSize >= 4 && buffer[ 0 ] == 't' && buffer[ 1 ] == 'v' && buffer[ 2 ] == 'c' )
+			{
+				return compact::DeserializeMessage( buffer, bufferSize );
+			}
+
+			uint64 offset = 0;
+
+			return DeserializeMap( buffer, bufferSize, offset, 0 );
+		}
+
+		Map DeserializeFrame( const uint8* buffer, uint64 bufferSize )
+		{
+			if ( bufferSize >= 4 && buffer[ 0 ] == 't' && buffer[ 1 ] == 'v' && buffer[ 2 ] == 'z' )
+			{
+				auto const decompressed = Decompress( buffer, bufferSize );
+				return DeserializeEncoding( decompressed.data(), decompressed.size() );
+			}
 
-			if ( version != 1 )
-				throw Error( "Invalid Map version!", 1 );
+			return DeserializeEncoding( buffer, bufferSize );
+		}
 
-			uint64 offset = 4;
+		Map Deserialize( const uint8* buffer, uint64 bufferSize )
+		{
+			if ( bufferSize >= 4 && buffer[ 0 ] == 't' && buffer[ 1 ] == 'v' && buffer[ 2 ] == 's' )
+			{
+				auto const payload = VerifyChecksum( buffer, bufferSize );
+				return DeserializeFrame( payload.data(), payload.size() );
+			}
 
-			return bitstream_v1::Deserialize( buffer, bufferSize, offset );
+			return DeserializeFrame( buffer, bufferSize );
 		}
 
 		Map Deserialize( Array< uint8 > const& buffer )
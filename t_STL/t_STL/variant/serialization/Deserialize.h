@@ -6,6 +6,11 @@ namespace t
 {
 	namespace variant
 	{
+		/*
+		 * Accepts bitstream_v1, bitstream_v2 and compact encodings, optionally in a
+		 * compressed frame, optionally inside a checksummed frame. Every read is
+		 * bounds checked, so untrusted buffers need no separate validation pass
+		 */
 		Map Deserialize( Array< uint8 > const& buffer );
 
 		Map Deserialize( const uint8_t* buffer, uint64 bufferSize );
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../../Tint.h"
+
+namespace t
+{
+	namespace variant
+	{
+		namespace details
+		{
+			//                                  "tvm<n>"      endianness         numel
+			constexpr uint64 MapHeaderSize = 4 + sizeof( uint16 ) + sizeof( uint64 );
+
+			/*
+			 * Deepest nesting of maps readers accept, so hostile input cannot exhaust the stack.
+			 * Deserialize checks it while decoding, and MapView while validating its buffer,
+			 * which covers MappedFile::view() and the pre-scan of DeserializeParallel
+			 */
+			constexpr uint64 MaxNestingDepth = 1024;
+
+			namespace v2
+			{
+				//                                  "tvm<n>"      endianness        flags             numel        byte length
+				constexpr uint64 MapHeaderSize = 4 + sizeof( uint16 ) + sizeof( uint8 ) + sizeof( uint64 ) + sizeof( uint64 );
+
+				/*
+				 * Set in the flags when the entries are followed by a key hash index
+				 */
+				constexpr uint8 HasIndex = 1;
+
+				//                                     key hash       entry offset
+				constexpr uint64 IndexEntrySize = sizeof( uint64 ) + sizeof( uint64 );
+
+				/*
+				 * 64-bit FNV-1a. Stored in serialized data, so it must never change
+				 */
+				constexpr uint64 KeyHash( const char* data, uint64 size )
+				{
+					uint64 hash = 0xcbf29ce484222325;
+
+					for ( uint64 i = 0; i < size; ++i )
+					{
+						hash ^= uint8( data[ i ] );
+						hash *= 0x100000001b3;
+					}
+
+					return hash;
+				}
+			}
+
+			namespace checksum
+			{
+				//                                  "tvs<n>"
+				constexpr uint64 FrameHeaderSize = 4;
+
+				//                                   CRC32C
+				constexpr uint64 FrameTrailerSize = sizeof( uint32 );
+			}
+
+			namespace compact
+			{
+				//                                  "tvc<n>"
+				constexpr uint64 MessageHeaderSize = 4;
+
+				/*
+				 * Set in an entry's type tag when the key follows in full rather than as a dictionary index
+				 */
+				constexpr uint8 NewKey = 0x80;
+
+				constexpr uint64 MaxVarintSize = 10;
+
+				constexpr uint64 ZigZag( int64 value )
+				{
+					return ( uint64( value ) << 1 ) ^ uint64( value >> 63 );
+				}
+
+				constexpr int64 UnZigZag( uint64 value )
+				{
+					return int64( value >> 1 ) ^ -int64( value & 1 );
+				}
+			}
+		}
+	}
+}
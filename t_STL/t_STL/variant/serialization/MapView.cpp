@@ -0,0 +1,524 @@
+#include "MapView.h"
+
+#include "Deserialize.h"
+#include "Format.h"
+#include "../../Error.h"
+
+namespace t
+{
+	namespace variant
+	{
+		namespace details
+		{
+			template< typename T >
+			T ReadAt( const uint8* data, bool swapBytes )
+			{
+				T val;
+				std::memcpy( &val, data, sizeof( T ) );
+
+				if ( swapBytes )
+					return byteswap( val );
+				return val;
+			}
+
+			void Require( uint64 needed, uint64 available )
+			{
+				if ( needed > available )
+				{
+					throw Error( "Serialized map is truncated!", 1 );
+				}
+			}
+
+			struct MapHeader
+			{
+				bool swapBytes;
+				uint64 numel;
+				uint64 headerSize;
+				// v2 only, 0 when unknown
+				uint64 byteLength;
+				uint64 indexOffset;
+			};
+
+			MapHeader ReadMapHeader( const uint8* data, uint64 available )
+			{
+				Require( MapHeaderSize, available );
+
+				if ( data[ 0 ] != 't' || data[ 1 ] != 'v' || data[ 2 ] != 'm' )
+				{
+					throw Error( "Expected valid Header!", 1 );
+				}
+
+				auto const version = data[ 3 ];
+
+				if ( version != 1 && version != 2 )
+				{
+					throw Error( "Invalid Map version!", 1 );
+				}
+
+				auto const marker = ReadAt< uint16 >( data + 4, false );
+
+				if ( marker != 1 && marker != byteswap( uint16( 1 ) ) )
+				{
+					throw Error( "Invalid endianness marker!", 1 );
+				}
+
+				bool const swapBytes = marker != 1;
+
+				if ( version == 1 )
+				{
+					return { swapBytes, ReadAt< uint64 >( data + 6, swapBytes ), MapHeaderSize, 0, 0 };
+				}
+
+				Require( v2::MapHeaderSize, available );
+
+				auto const flags = data[ 6 ];
+				auto const numel = ReadAt< uint64 >( data + 7, swapBytes );
+				auto const byteLength = ReadAt< uint64 >( data + 15, swapBytes );
+
+				Require( byteLength, available );
+
+				if ( byteLength < v2::MapHeaderSize )
+				{
+					throw Error( "Invalid map length!", 1 );
+				}
+
+				uint64 indexOffset = 0;
+
+				if ( flags & v2::HasIndex )
+				{
+					if ( numel > ( byteLength - v2::MapHeaderSize ) / v2::IndexEntrySize )
+					{
+						throw Error( "Invalid map index!", 1 );
+					}
+
+					indexOffset = byteLength - numel * v2::IndexEntrySize;
+				}
+
+				return { swapBytes, numel, v2::MapHeaderSize, byteLength, indexOffset };
+			}
+
+			uint64 ElementSize( Type type )
+			{
+				switch ( type )
+				{
+				case Type::INT8_ARRAY:
+				case Type::UINT8_ARRAY:
+					return sizeof( uint8 );
+				case Type::INT16_ARRAY:
+				case Type::UINT16_ARRAY:
+					return sizeof( uint16 );
+				case Type::INT32_ARRAY:
+				case Type::UINT32_ARRAY:
+				case Type::FLOAT_ARRAY:
+					return sizeof( uint32 );
+				case Type::INT64_ARRAY:
+				case Type::UINT64_ARRAY:
+				case Type::DOUBLE_ARRAY:
+					return sizeof( uint64 );
+				default:
+					return 0;
+				}
+			}
+
+			uint64 StringExtent( const uint8* data, uint64 available, bool swapBytes )
+			{
+				Require( sizeof( uint32 ), available );
+
+				uint64 const length = ReadAt< uint32 >( data, swapBytes );
+
+				Require( sizeof( uint32 ) + length, available );
+
+				return sizeof( uint32 ) + length;
+			}
+
+			uint64 MapExtent( const uint8* data, uint64 available, uint64 depth = 0 );
+
+			/*
+			 * Number of bytes the payload of a value of the given type takes up,
+			 * throwing if it would run past the end of the buffer.
+			 * Once the buffer has been validated, nested v2 maps are skipped using their length.
+			 * depth is the nesting of the map holding the value
+			 */
+			uint64 ValueExtent( Type type, const uint8* data, uint64 available, bool swapBytes, bool validated = false, uint64 depth = 0 )
+			{
+				if ( type == Type::MAP && validated )
+				{
+					auto const header = ReadMapHeader( data, available );
+
+					if ( header.byteLength != 0 )
+						return header.byteLength;
+				}
+
+				uint64 size = 0;
+
+				switch ( type )
+				{
+				case Type::VOID:
+					return 0;
+				case Type::INT8:
+				case Type::UINT8:
+					size = sizeof( uint8 );
+					break;
+				case Type::INT16:
+				case Type::UINT16:
+					size = sizeof( uint16 );
+					break;
+				case Type::INT32:
+				case Type::UINT32:
+				case Type::FLOAT:
+					size = sizeof( uint32 );
+					break;
+				case Type::INT64:
+				case Type::UINT64:
+				case Type::DOUBLE:
+					size = sizeof( uint64 );
+					break;
+				case Type::STRING:
+					return StringExtent( data, available, swapBytes );
+				case Type::MAP:
+					return MapExtent( data, available, depth + 1 );
+				case Type::STRING_ARRAY:
+				{
+					Require( sizeof( uint64 ), available );
+
+					auto const numel = ReadAt< uint64 >( data, swapBytes );
+					uint64 offset = sizeof( uint64 );
+
+					for ( uint64 i = 0; i < numel; ++i )
+					{
+						offset += StringExtent( data + offset, available - offset, swapBytes );
+					}
+
+					return offset;
+				}
+				default:
+				{
+					auto const elementSize = ElementSize( type );
+
+					if ( elementSize == 0 )
+					{
+						throw Error( "Invalid value type!", 1 );
+					}
+
+					Require( sizeof( uint64 ), available );
+
+					auto const numel = ReadAt< uint64 >( data, swapBytes );
+
+					if ( numel > ( available - sizeof( uint64 ) ) / elementSize )
+					{
+						throw Error( "Serialized map is truncated!", 1 );
+					}
+
+					return sizeof( uint64 ) + numel * elementSize;
+				}
+				}
+
+				Require( size, available );
+
+				return size;
+			}
+
+			/*
+			 * Whether the index has an entry for the key at this offset, with the right hash
+			 */
+			bool IndexHasEntry( const uint8* data, MapHeader const& header, uint64 hash, uint64 entryOffset )
+			{
+				uint64 low = 0;
+				uint64 high = header.numel;
+
+				while ( low < high )
+				{
+					auto const mid = low + ( high - low ) / 2;
+
+					if ( ReadAt< uint64 >( data + header.indexOffset + mid * v2::IndexEntrySize, header.swapBytes ) < hash )
+						low = mid + 1;
+					else
+						high = mid;
+				}
+
+				for ( ; low < header.numel; ++low )
+				{
+					auto const* entry = data + header.indexOffset + low * v2::IndexEntrySize;
+
+					if ( ReadAt< uint64 >( entry, header.swapBytes ) != hash )
+						return false;
+
+					if ( ReadAt< uint64 >( entry + sizeof( uint64 ), header.swapBytes ) == entryOffset )
+						return true;
+				}
+
+				return false;
+			}
+
+			uint64 MapExtent( const uint8* data, uint64 available, uint64 depth )
+			{
+				// every reader of untrusted bytes validates through here, so it bounds the stack as Deserialize does
+				if ( depth > MaxNestingDepth )
+				{
+					throw Error( "Maps are nested too deeply!", 1 );
+				}
+
+				auto const header = ReadMapHeader( data, available );
+
+				// entries must not run into the index or past the recorded length
+				auto const entriesEnd = header.indexOffset != 0 ? header.indexOffset
+					: header.byteLength != 0 ? header.byteLength
+					: available;
+
+				uint64 offset = header.headerSize;
+
+				for ( uint64 i = 0; i < header.numel; ++i )
+				{
+					auto const entryOffset = offset;
+
+					offset += StringExtent( data + offset, entriesEnd - offset, header.swapBytes );
+
+					if ( header.indexOffset != 0 )
+					{
+						auto const* key = reinterpret_cast< const char* >( data + entryOffset + sizeof( uint32 ) );
+						auto const hash = v2::KeyHash( key, offset - entryOffset - sizeof( uint32 ) );
+
+						if ( !IndexHasEntry( data, header, hash, entryOffset ) )
+						{
+							throw Error( "Invalid map index!", 1 );
+						}
+					}
+
+					Require( offset + sizeof( Type ), entriesEnd );
+
+					auto const type = static_cast< Type >( data[ offset ] );
+					offset += sizeof( Type );
+
+					offset += ValueExtent( type, data + offset, entriesEnd - offset, header.swapBytes, false, depth );
+				}
+
+				if ( header.byteLength == 0 )
+					return offset;
+
+				if ( offset != entriesEnd )
+				{
+					throw Error( "Map length does not match its entries!", 1 );
+				}
+
+				return header.byteLength;
+			}
+
+			template< typename T >
+			Value MaterializeArray( const uint8* data, bool swapBytes )
+			{
+				auto const numel = ReadAt< uint64 >( data, swapBytes );
+
+				Array< T > arr( numel );
+
+				if ( numel != 0 )
+				{
+					std::memcpy( arr.data(), data + sizeof( uint64 ), numel * sizeof( T ) );
+				}
+
+				if ( swapBytes )
+					byteswapInPlace( arr.data(), numel );
+
+				return Value( std::move( arr ) );
+			}
+		}
+
+		void ValueView::checkType( bool matches ) const
+		{
+			if ( !matches )
+			{
+				String msg = "Type did not match!\nFound: ";
+				msg += typeToString( m_type );
+				throw Error( msg.c_str() );
+			}
+		}
+
+		Value ValueView::Materialize() const
+		{
+			switch ( m_type )
+			{
+			case Type::VOID:
+				return Value();
+			case Type::INT8:
+				return Value( As< int8 >() );
+			case Type::INT16:
+				return Value( As< int16 >() );
+			case Type::INT32:
+				return Value( As< int32 >() );
+			case Type::INT64:
+				return Value( As< int64 >() );
+			case Type::UINT8:
+				return Value( As< uint8 >() );
+			case Type::UINT16:
+				return Value( As< uint16 >() );
+			case Type::UINT32:
+				return Value( As< uint32 >() );
+			case Type::UINT64:
+				return Value( As< uint64 >() );
+			case Type::FLOAT:
+				return Value( As< float >() );
+			case Type::DOUBLE:
+				return Value( As< double >() );
+			case Type::STRING:
+				return Value( String( As< StringView >() ) );
+			case Type::MAP:
+				return Value( As< MapView >().Materialize() );
+			case Type::INT8_ARRAY:
+				return details::MaterializeArray< int8 >( m_data, m_swapBytes );
+			case Type::INT16_ARRAY:
+				return details::MaterializeArray< int16 >( m_data, m_swapBytes );
+			case Type::INT32_ARRAY:
+				return details::MaterializeArray< int32 >( m_data, m_swapBytes );
+			case Type::INT64_ARRAY:
+				return details::MaterializeArray< int64 >( m_data, m_swapBytes );
+			case Type::UINT8_ARRAY:
+				return details::MaterializeArray< uint8 >( m_data, m_swapBytes );
+			case Type::UINT16_ARRAY:
+				return details::MaterializeArray< uint16 >( m_data, m_swapBytes );
+			case Type::UINT32_ARRAY:
+				return details::MaterializeArray< uint32 >( m_data, m_swapBytes );
+			case Type::UINT64_ARRAY:
+				return details::MaterializeArray< uint64 >( m_data, m_swapBytes );
+			case Type::FLOAT_ARRAY:
+				return details::MaterializeArray< float >( m_data, m_swapBytes );
+			case Type::DOUBLE_ARRAY:
+				return details::MaterializeArray< double >( m_data, m_swapBytes );
+			case Type::STRING_ARRAY:
+			{
+				auto const numel = read< uint64 >( 0 );
+
+				Array< String > arr( numel );
+
+				uint64 offset = sizeof( uint64 );
+
+				for ( uint64 i = 0; i < numel; ++i )
+				{
+					auto const length = read< uint32 >( offset );
+					offset += sizeof( uint32 );
+					arr[ i ] = String( reinterpret_cast< const char* >( m_data + offset ), length );
+					offset += length;
+				}
+
+				return Value( std::move( arr ) );
+			}
+			}
+
+			throw Error( "Invalid value type!", 1 );
+		}
+
+		MapView::MapView( const uint8* buffer, uint64 size ):
+			MapView( buffer, details::MapExtent( buffer, size ), Trusted{} ) {}
+
+		MapView::MapView( const uint8* buffer, uint64 size, Trusted ):
+			m_data( buffer ),
+			m_size( size )
+		{
+			auto const header = details::ReadMapHeader( m_data, m_size );
+
+			m_numel = header.numel;
+			m_swapBytes = header.swapBytes;
+			m_firstEntry = header.headerSize;
+			m_indexOffset = header.indexOffset;
+		}
+
+		StringView MapView::readKey( uint64& offset ) const
+		{
+			auto const length = details::ReadAt< uint32 >( m_data + offset, m_swapBytes );
+			auto const key = StringView( reinterpret_cast< const char* >( m_data + offset + sizeof( uint32 ) ), length );
+			offset += sizeof( uint32 ) + length;
+			return key;
+		}
+
+		ValueView MapView::readValue( uint64& offset ) const
+		{
+			auto const type = static_cast< Type >( m_data[ offset ] );
+			offset += sizeof( Type );
+
+			auto const size = details::ValueExtent( type, m_data + offset, m_size - offset, m_swapBytes, true );
+			auto const value = ValueView( m_data + offset, size, type, m_swapBytes );
+			offset += size;
+
+			return value;
+		}
+
+		Optional< ValueView > MapView::find( StringView key ) const
+		{
+			if ( m_indexOffset != 0 )
+			{
+				return findIndexed( key );
+			}
+
+			uint64 offset = m_firstEntry;
+
+			for ( uint64 i = 0; i < m_numel; ++i )
+			{
+				auto const candidate = readKey( offset );
+
+				if ( candidate.size() == key.size() && std::memcmp( candidate.data(), key.data(), key.size() ) == 0 )
+				{
+					return readValue( offset );
+				}
+
+				// skip the value without building a view of it
+				auto const type = static_cast< Type >( m_data[ offset ] );
+				offset += sizeof( Type );
+				offset += details::ValueExtent( type, m_data + offset, m_size - offset, m_swapBytes, true );
+			}
+
+			return Optional< ValueView >();
+		}
+
+		Optional< ValueView > MapView::findIndexed( StringView key ) const
+		{
+			auto const hash = details::v2::KeyHash( key.data(), key.size() );
+
+			auto const entryAt = [ this ]( uint64 i )
+			{
+				return m_data + m_indexOffset + i * details::v2::IndexEntrySize;
+			};
+
+			uint64 low = 0;
+			uint64 high = m_numel;
+
+			while ( low < high )
+			{
+				auto const mid = low + ( high - low ) / 2;
+
+				if ( details::ReadAt< uint64 >( entryAt( mid ), m_swapBytes ) < hash )
+					low = mid + 1;
+				else
+					high = mid;
+			}
+
+			// keys whose hashes collide sit next to each other
+			for ( ; low < m_numel && details::ReadAt< uint64 >( entryAt( low ), m_swapBytes ) == hash; ++low )
+			{
+				auto offset = details::ReadAt< uint64 >( entryAt( low ) + sizeof( uint64 ), m_swapBytes );
+				auto const candidate = readKey( offset );
+
+				if ( candidate.size() == key.size() && std::memcmp( candidate.data(), key.data(), key.size() ) == 0 )
+				{
+					return readValue( offset );
+				}
+			}
+
+			return Optional< ValueView >();
+		}
+
+		ValueView MapView::at( StringView key ) const
+		{
+			auto value = find( key );
+
+			if ( !value )
+			{
+				throw Error( "Could not find key!", 1 );
+			}
+
+			return value.value();
+		}
+
+		Map MapView::Materialize() const
+		{
+			return Deserialize( m_data, m_size );
+		}
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstring>
+
+#include "../variant.h"
+#include "../../Array.h"
+#include "../../ArrayView.h"
+#include "../../Optional.h"
+#include "../../endianness.h"
+
+namespace t
+{
+	namespace variant
+	{
+		class MapView;
+
+		namespace details
+		{
+			template< typename T >
+			struct ArrayViewTraits
+			{
+				static constexpr bool isArrayView = false;
+			};
+
+			template< typename T >
+			struct ArrayViewTraits< ArrayView< const T > >
+			{
+				static constexpr bool isArrayView = true;
+				using ElementType = T;
+			};
+		}
+
+		/*
+		 * Read-only view of one value inside a serialized map.
+		 * Nothing is copied out of the buffer until asked for
+		 */
+		class ValueView
+		{
+		public:
+			ValueView() = default;
+
+			[[nodiscard]] Type getType() const { return m_type; }
+
+			/*
+			 * Bytes the value occupies in the buffer, not counting its type
+			 */
+			[[nodiscard]] uint64 encodedSize() const { return m_size; }
+
+			template< class T >
+			[[nodiscard]] bool Is() const
+			{
+				if constexpr ( type::is_same< T, StringView > )
+					return m_type == Type::STRING;
+				else if constexpr ( type::is_same< T, MapView > )
+					return m_type == Type::MAP;
+				else if constexpr ( details::ArrayViewTraits< T >::isArrayView )
+					return m_type == details::templateToVariantType< Array< typename details::ArrayViewTraits< T >::ElementType > >();
+				else
+					return m_type == details::templateToVariantType< T >();
+			}
+
+			/*
+			 * Supports arithmetic types, StringView, MapView and ArrayView< const T >.
+			 * Array views point straight into the buffer, so they need the data to
+			 * be in native byte order and suitably aligned; Materialize always works
+			 */
+			template< class T >
+			[[nodiscard]] T As() const;
+
+			/*
+			 * Copies the value out into a regular Value
+			 */
+			[[nodiscard]] Value Materialize() const;
+
+			/*
+			 * Whether As< ArrayView< const T > >() can point into the buffer
+			 */
+			template< class T >
+			[[nodiscard]] bool canViewArray() const
+			{
+				return Is< ArrayView< const T > >()
+					&& ( !m_swapBytes || sizeof( T ) == 1 )
+					&& reinterpret_cast< uintptr_t >( m_data + sizeof( uint64 ) ) % alignof( T ) == 0;
+			}
+		private:
+			friend class MapView;
+
+			ValueView( const uint8* data, uint64 size, Type type, bool swapBytes ):
+				m_data( data ),
+				m_size( size ),
+				m_type( type ),
+				m_swapBytes( swapBytes ) {}
+
+			template< class T >
+			T read( uint64 offset ) const
+			{
+				T val;
+				std::memcpy( &val, m_data + offset, sizeof( T ) );
+
+				if ( m_swapBytes )
+					return byteswap( val );
+				return val;
+			}
+
+			void checkType( bool matches ) const;
+		private:
+			// the payload, after the type byte
+			const uint8* m_data = nullptr;
+			uint64 m_size = 0;
+			Type m_type = Type::VOID;
+			bool m_swapBytes = false;
+		};
+
+		/*
+		 * Read-only view over a serialized map. The whole buffer is validated
+		 * once on construction, after which lookups only walk the bytes, or
+		 * binary search the key hash index of bitstream_v2 maps.
+		 * The buffer must outlive the view and everything obtained from it
+		 */
+		class MapView
+		{
+		public:
+			MapView( const uint8* buffer, uint64 size );
+
+			explicit MapView( Array< uint8 > const& buffer ):
+				MapView( buffer.data(), buffer.size() ) {}
+
+			[[nodiscard]] uint64 size() const { return m_numel; }
+
+			[[nodiscard]] Optional< ValueView > find( StringView key ) const;
+
+			[[nodiscard]] ValueView at( StringView key ) const;
+
+			[[nodiscard]] bool contains( StringView key ) const { return find( key ).hasValue(); }
+
+			/*
+			 * Copies the whole map out, equivalent to Deserialize on the same bytes
+			 */
+			[[nodiscard]] Map Materialize() const;
+
+			/*
+			 * Calls func( StringView key, ValueView value ) for every entry, in buffer order
+			 */
+			template< class Func >
+			void forEach( Func&& func ) const
+			{
+				uint64 offset = m_firstEntry;
+
+				for ( uint64 i = 0; i < m_numel; ++i )
+				{
+					auto const key = readKey( offset );
+					auto const value = readValue( offset );
+					func( key, value );
+				}
+			}
+		private:
+			friend class ValueView;
+
+			struct Trusted {};
+
+			MapView( const uint8* buffer, uint64 size, Trusted );
+
+			Optional< ValueView > findIndexed( StringView key ) const;
+
+			StringView readKey( uint64& offset ) const;
+
+			ValueView readValue( uint64& offset ) const;
+		private:
+			const uint8* m_data;
+			uint64 m_size;
+			uint64 m_numel = 0;
+			uint64 m_firstEntry = 0;
+			// v2 maps with a key hash index, 0 otherwise
+			uint64 m_indexOffset = 0;
+			bool m_swapBytes = false;
+		};
+
+		template< class T >
+		T ValueView::As() const
+		{
+			checkType( Is< T >() );
+
+			if constexpr ( type::is_same< T, StringView > )
+			{
+				return StringView( reinterpret_cast< const char* >( m_data + sizeof( uint32 ) ), read< uint32 >( 0 ) );
+			}
+			else if constexpr ( type::is_same< T, MapView > )
+			{
+				return MapView( m_data, m_size, MapView::Trusted{} );
+			}
+			else if constexpr ( details::ArrayViewTraits< T >::isArrayView )
+			{
+				using U = typename details::ArrayViewTraits< T >::ElementType;
+
+				if ( !canViewArray< U >() )
+				{
+					throw Error( "Array is not in native byte order or not aligned, use Materialize", 1 );
+				}
+
+				return T( reinterpret_cast< const U* >( m_data + sizeof( uint64 ) ), read< uint64 >( 0 ) );
+			}
+			else
+			{
+				static_assert( type::is_arithmetic< T >, "Unsupported view type" );
+				return read< T >( 0 );
+			}
+		}
+	}
+}
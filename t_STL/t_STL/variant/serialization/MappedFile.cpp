@@ -0,0 +1,160 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define T_STL_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define T_STL_HAS_MMAP 0
+#endif
+
+#include "Deserialize.h"
+#include "../../Error.h"
+#include "../../utility.h"
+
+namespace t
+{
+	namespace variant
+	{
+#if T_STL_HAS_MMAP
+		namespace details
+		{
+			int ToAdvice( AccessPattern pattern )
+			{
+				return pattern == AccessPattern::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM;
+			}
+		}
+
+		MappedFile::MappedFile( String const& path, AccessPattern pattern )
+		{
+			auto const fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+			if ( fd < 0 )
+			{
+				throw Error( "Could not open file!", 1 );
+			}
+
+			struct stat info;
+
+			if ( ::fstat( fd, &info ) != 0 )
+			{
+				::close( fd );
+				throw Error( "Could not stat file!", 1 );
+			}
+
+			m_size = uint64( info.st_size );
+
+			// mapping zero bytes fails, an empty file just has no data
+			if ( m_size != 0 )
+			{
+				void* mapping = ::mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+				if ( mapping == MAP_FAILED )
+				{
+					::close( fd );
+					throw Error( "Could not map file!", 1 );
+				}
+
+				m_data = static_cast< const uint8* >( mapping );
+				m_mapped = true;
+
+				advise( pattern );
+			}
+
+			// the mapping stays valid after the descriptor is closed
+			::close( fd );
+		}
+
+		void MappedFile::advise( AccessPattern pattern )
+		{
+			if ( m_mapped )
+			{
+				// only a hint, nothing to do if the kernel ignores it
+				::madvise( const_cast< uint8* >( m_data ), m_size, details::ToAdvice( pattern ) );
+			}
+		}
+
+		void MappedFile::unmap()
+		{
+			if ( m_mapped )
+			{
+				::munmap( const_cast< uint8* >( m_data ), m_size );
+			}
+		}
+#else
+		MappedFile::MappedFile( String const& path, AccessPattern )
+		{
+			auto* file = std::fopen( path.c_str(), "rb" );
+
+			if ( file == nullptr )
+			{
+				throw Error( "Could not open file!", 1 );
+			}
+
+			std::fseek( file, 0, SEEK_END );
+			auto const size = std::ftell( file );
+			std::fseek( file, 0, SEEK_SET );
+
+			if ( size < 0 )
+			{
+				std::fclose( file );
+				throw Error( "Could not read file!", 1 );
+			}
+
+			m_fallback = Array< uint8 >( uint64( size ) );
+
+			if ( std::fread( m_fallback.data(), 1, m_fallback.size(), file ) != m_fallback.size() )
+			{
+				std::fclose( file );
+				throw Error( "Could not read file!", 1 );
+			}
+
+			std::fclose( file );
+
+			m_data = m_fallback.data();
+			m_size = m_fallback.size();
+		}
+
+		void MappedFile::advise( AccessPattern ) {}
+
+		void MappedFile::unmap() {}
+#endif
+
+		MappedFile::MappedFile( MappedFile&& other ) noexcept:
+			m_data( t::exchange( other.m_data, nullptr ) ),
+			m_size( t::exchange( other.m_size, 0 ) ),
+			m_mapped( t::exchange( other.m_mapped, false ) ),
+			m_fallback( std::move( other.m_fallback ) ) {}
+
+		MappedFile& MappedFile::operator=( MappedFile&& rhs ) noexcept
+		{
+			if ( this == &rhs )
+				return *this;
+
+			unmap();
+
+			m_data = t::exchange( rhs.m_data, nullptr );
+			m_size = t::exchange( rhs.m_size, 0 );
+			m_mapped = t::exchange( rhs.m_mapped, false );
+			m_fallback = std::move( rhs.m_fallback );
+
+			return *this;
+		}
+
+		MappedFile::~MappedFile()
+		{
+			unmap();
+		}
+
+		Map LoadMap( String const& path )
+		{
+			MappedFile file( path, AccessPattern::Sequential );
+
+			return Deserialize( file.data(), file.size() );
+		}
+	}
+}
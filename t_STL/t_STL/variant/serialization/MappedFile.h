@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../variant.h"
+#include "../../Array.h"
+#include "MapView.h"
+
+namespace t
+{
+	namespace variant
+	{
+		/*
+		 * How the mapped bytes are going to be read, passed on to the kernel
+		 * so it can choose how aggressively to read ahead
+		 */
+		enum class AccessPattern : uint8
+		{
+			Sequential,
+			Random
+		};
+
+		/*
+		 * Read-only mapping of a serialized map on disk. Where memory mapping
+		 * is not available the file is read into memory instead
+		 */
+		class MappedFile
+		{
+		public:
+			explicit MappedFile( String const& path, AccessPattern pattern = AccessPattern::Sequential );
+
+			MappedFile( MappedFile&& other ) noexcept;
+
+			MappedFile& operator=( MappedFile&& rhs ) noexcept;
+
+			MappedFile( MappedFile const& ) = delete;
+			MappedFile& operator=( MappedFile const& ) = delete;
+
+			~MappedFile();
+
+			/*
+			 * Changes the read-ahead hint, e.g. once a full pass is done and
+			 * only lookups remain
+			 */
+			void advise( AccessPattern pattern );
+
+			[[nodiscard]] const uint8* data() const { return m_data; }
+			[[nodiscard]] uint64 size() const { return m_size; }
+
+			/*
+			 * The view borrows the mapping, so it must not outlive this object
+			 */
+			[[nodiscard]] MapView view() const { return MapView( m_data, m_size ); }
+		private:
+			void unmap();
+		private:
+			const uint8* m_data = nullptr;
+			uint64 m_size = 0;
+			bool m_mapped = false;
+			Array< uint8 > m_fallback;
+		};
+
+		/*
+		 * Deserializes a map straight from a file, without an intermediate copy of its bytes
+		 */
+		Map LoadMap( String const& path );
+	}
+}
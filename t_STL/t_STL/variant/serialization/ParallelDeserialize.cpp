@@ -0,0 +1,181 @@
+#include "ParallelDeserialize.h"
+
+#include "Deserialize.h"
+#include "MapView.h"
+#include "../../Pair.h"
+
+namespace t
+{
+	namespace variant
+	{
+		namespace details
+		{
+			/*
+			 * Below this there is too little work to be worth waking the pool
+			 */
+			constexpr uint64 MinParallelSize = 64 * 1024;
+
+			constexpr uint64 MinChunkSize = 16 * 1024;
+
+			constexpr uint64 ChunksPerThread = 8;
+
+			/*
+			 * A map whose entries are decoded separately and put together afterwards
+			 */
+			struct PendingMap
+			{
+				Array< String > keys;
+				Array< Value > values;
+				uint64 parent = 0;
+				uint64 slot = 0;
+			};
+
+			struct PendingEntry
+			{
+				StringView key;
+				ValueView value;
+				uint64 map = 0;
+				uint64 slot = 0;
+				// the value is a PendingMap of its own
+				bool split = false;
+			};
+
+			class ParallelPlan
+			{
+			public:
+				explicit ParallelPlan( uint64 chunkSize ):
+					m_chunkSize( chunkSize ) {}
+
+				/*
+				 * Recurses into every split map. Building the root MapView rejects maps
+				 * nested deeper than MaxNestingDepth, which bounds this recursion too
+				 */
+				void scan( MapView const& view, uint64 parent, uint64 slot )
+				{
+					auto const map = m_maps.size();
+
+					PendingMap pending;
+					pending.keys.resize( view.size() );
+					pending.values.resize( view.size() );
+					pending.parent = parent;
+					pending.slot = slot;
+					m_maps.pushBack( std::move( pending ) );
+
+					uint64 index = 0;
+
+					view.forEach( [ & ]( StringView key, ValueView value )
+					{
+						bool const split = value.getType() == Type::MAP && value.encodedSize() > m_chunkSize;
+
+						m_entries.pushBack( PendingEntry{ key, value, map, index, split } );
+
+						if ( split )
+							scan( value.As< MapView >(), map, index );
+
+						++index;
+					} );
+				}
+
+				/*
+				 * Cuts the entries into runs of roughly m_chunkSize bytes, split maps not counting
+				 */
+				void chunk()
+				{
+					uint64 bytes = 0;
+					uint64 begin = 0;
+
+					for ( uint64 i = 0; i < m_entries.size(); ++i )
+					{
+						auto const& entry = m_entries[ i ];
+
+						if ( !entry.split )
+							bytes += entry.key.size() + entry.value.encodedSize();
+
+						if ( bytes >= m_chunkSize )
+						{
+							m_chunks.pushBack( { begin, i + 1 } );
+							begin = i + 1;
+							bytes = 0;
+						}
+					}
+
+					if ( begin != m_entries.size() )
+						m_chunks.pushBack( { begin, m_entries.size() } );
+				}
+
+				void decode( uint64 chunk )
+				{
+					for ( uint64 i = m_chunks[ chunk ].first; i < m_chunks[ chunk ].second; ++i )
+					{
+						auto const& entry = m_entries[ i ];
+						auto& map = m_maps[ entry.map ];
+
+						map.keys[ entry.slot ] = String( entry.key );
+
+						if ( !entry.split )
+							map.values[ entry.slot ] = entry.value.Materialize();
+					}
+				}
+
+				/*
+				 * Nested maps are always scanned after their parent, so building
+				 * back to front finishes every child before it is needed
+				 */
+				Map assemble()
+				{
+					for ( uint64 i = m_maps.size() - 1; i > 0; --i )
+					{
+						auto& pending = m_maps[ i ];
+						m_maps[ pending.parent ].values[ pending.slot ] = Value( build( pending ) );
+					}
+
+					return build( m_maps[ 0 ] );
+				}
+
+				[[nodiscard]] uint64 chunkCount() const { return m_chunks.size(); }
+			private:
+				static Map build( PendingMap& pending )
+				{
+					Map map;
+
+					for ( uint64 i = 0; i < pending.keys.size(); ++i )
+						map.insert( { std::move( pending.keys[ i ] ), std::move( pending.values[ i ] ) } );
+
+					return map;
+				}
+			private:
+				uint64 m_chunkSize;
+				Array< PendingMap > m_maps;
+				Array< PendingEntry > m_entries;
+				Array< pair< uint64, uint64 > > m_chunks;
+			};
+		}
+
+		Map DeserializeParallel( const uint8* buffer, uint64 bufferSize, ThreadPool& pool )
+		{
+			bool const isBitstream = bufferSize >= 4 && buffer[ 0 ] == 't' && buffer[ 1 ] == 'v' && buffer[ 2 ] == 'm';
+
+			if ( !isBitstream || pool.threadCount() == 1 || bufferSize < details::MinParallelSize )
+				return Deserialize( buffer, bufferSize );
+
+			auto chunkSize = bufferSize / ( pool.threadCount() * details::ChunksPerThread );
+
+			if ( chunkSize < details::MinChunkSize )
+				chunkSize = details::MinChunkSize;
+
+			details::ParallelPlan plan( chunkSize );
+
+			plan.scan( MapView( buffer, bufferSize ), 0, 0 );
+			plan.chunk();
+
+			pool.parallelFor( plan.chunkCount(), [ &plan ]( uint64 chunk ) { plan.decode( chunk ); } );
+
+			return plan.assemble();
+		}
+
+		Map DeserializeParallel( Array< uint8 > const& buffer, ThreadPool& pool )
+		{
+			return DeserializeParallel( buffer.data(), buffer.size(), pool );
+		}
+	}
+}
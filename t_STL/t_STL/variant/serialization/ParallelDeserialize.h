@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../variant.h"
+#include "../../ThreadPool.h"
+
+namespace t
+{
+	namespace variant
+	{
+		/*
+		 * Produces the same Map as Deserialize, decoding entries on the pool's threads.
+		 * A validating pre-scan splits the bitstream into chunks of similar byte size,
+		 * descending into nested maps too large to be a single chunk. Compact and
+		 * compressed payloads, and anything small, are decoded serially
+		 */
+		Map DeserializeParallel( const uint8* buffer, uint64 bufferSize, ThreadPool& pool );
+
+		Map DeserializeParallel( Array< uint8 > const& buffer, ThreadPool& pool );
+	}
+}
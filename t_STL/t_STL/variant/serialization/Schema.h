@@ -0,0 +1,550 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "Format.h"
+#include "../variant.h"
+#include "../../Array.h"
+#include "../../BufferView.h"
+#include "../../endianness.h"
+#include "../../Error.h"
+
+namespace t
+{
+	namespace variant
+	{
+		/*
+		 * Key of a schema field, usable as a template argument
+		 */
+		template< uint64 N >
+		struct FieldName
+		{
+			constexpr FieldName( const char ( &str )[ N ] )
+			{
+				for ( uint64 i = 0; i < N; ++i )
+					data[ i ] = str[ i ];
+			}
+
+			constexpr uint64 size() const { return N - 1; }
+
+			char data[ N ] {};
+		};
+
+		/*
+		 * Binds a key to a data member, e.g. Field< "id", &Record::id >
+		 */
+		template< FieldName Name, auto Member >
+		struct Field
+		{
+			static constexpr auto name = Name;
+			static constexpr auto member = Member;
+		};
+
+		namespace details
+		{
+			namespace schema
+			{
+				template< class T >
+				struct MemberTraits;
+
+				template< class C, class T >
+				struct MemberTraits< T C::* >
+				{
+					using Class = C;
+					using Type = T;
+				};
+
+				template< class T >
+				struct ValueTraits
+				{
+					static_assert( type::is_arithmetic< T >, "Schema fields must be arithmetic, String, or Arrays of those" );
+
+					static constexpr bool isFixed = true;
+					static constexpr uint64 fixedSize = sizeof( T );
+				};
+
+				template<>
+				struct ValueTraits< String >
+				{
+					static constexpr bool isFixed = false;
+				};
+
+				template< class T >
+				struct ValueTraits< Array< T > >
+				{
+					static_assert( type::is_arithmetic< T > || type::is_same< T, String >, "Schema arrays must hold arithmetic values or Strings" );
+
+					static constexpr bool isFixed = false;
+				};
+
+				/*
+				 * The bytes in front of a field's payload: key length, key and type, as Serialize writes them
+				 */
+				template< endianness e, class F, class T >
+				struct FieldPrefix
+				{
+					static constexpr uint64 size = sizeof( uint32 ) + F::name.size() + sizeof( uint8 );
+
+					uint8 bytes[ size ] {};
+
+					constexpr FieldPrefix()
+					{
+						auto const length = uint32( F::name.size() );
+
+						for ( uint64 i = 0; i < sizeof( uint32 ); ++i )
+						{
+							auto const shift = e == endianness::little ? i * 8 : ( sizeof( uint32 ) - 1 - i ) * 8;
+							bytes[ i ] = uint8( length >> shift );
+						}
+
+						for ( uint64 i = 0; i < F::name.size(); ++i )
+							bytes[ sizeof( uint32 ) + i ] = uint8( F::name.data[ i ] );
+
+						bytes[ size - 1 ] = uint8( templateToVariantType< T >() );
+					}
+				};
+
+				template< endianness e, typename T >
+				inline void Put( uint8*& out, T value )
+				{
+					if constexpr ( e != endianness::native )
+						value = byteswap( value );
+
+					std::memcpy( out, &value, sizeof( T ) );
+					out += sizeof( T );
+				}
+
+				template< endianness e >
+				inline void PutString( uint8*& out, String const& str )
+				{
+					if ( str.size() > limit< uint32 >::max )
+					{
+						throw Error( "Strings lengths must fit into a 32-bit number", 1 );
+					}
+
+					Put< e >( out, uint32( str.size() ) );
+
+					if ( str.size() != 0 )
+						std::memcpy( out, str.data(), str.size() );
+
+					out += str.size();
+				}
+
+				template< class T >
+				inline uint64 PayloadSize( T const& )
+				{
+					return sizeof( T );
+				}
+
+				inline uint64 PayloadSize( String const& str )
+				{
+					return sizeof( uint32 ) + str.size();
+				}
+
+				template< class T >
+				inline uint64 PayloadSize( Array< T > const& arr )
+				{
+					if constexpr ( type::is_same< T, String > )
+					{
+						uint64 size = sizeof( uint64 );
+
+						for ( auto const& str : arr )
+							size += PayloadSize( str );
+
+						return size;
+					}
+					else
+					{
+						return sizeof( uint64 ) + arr.size() * sizeof( T );
+					}
+				}
+
+				template< endianness e, class T >
+				inline void PutPayload( uint8*& out, T const& value )
+				{
+					Put< e >( out, value );
+				}
+
+				template< endianness e >
+				inline void PutPayload( uint8*& out, String const& str )
+				{
+					PutString< e >( out, str );
+				}
+
+				template< endianness e, class T >
+				inline void PutPayload( uint8*& out, Array< T > const& arr )
+				{
+					Put< e >( out, uint64( arr.size() ) );
+
+					if constexpr ( type::is_same< T, String > )
+					{
+						for ( auto const& str : arr )
+							PutString< e >( out, str );
+					}
+					else if constexpr ( e == endianness::native || sizeof( T ) == 1 )
+					{
+						if ( arr.size() != 0 )
+							std::memcpy( out, arr.data(), arr.size() * sizeof( T ) );
+
+						out += arr.size() * sizeof( T );
+					}
+					else
+					{
+						for ( auto const value : arr )
+							Put< e >( out, value );
+					}
+				}
+
+				/*
+				 * Bounds checked cursor over the input
+				 */
+				class Reader
+				{
+				public:
+					Reader( const uint8* data, uint64 size ):
+						m_data( data ),
+						m_size( size ) {}
+
+					const uint8* take( uint64 size )
+					{
+						if ( size > m_size - m_offset )
+						{
+							throw Error( "Record runs past the end of the buffer", 1 );
+						}
+
+						auto const* bytes = m_data + m_offset;
+						m_offset += size;
+						return bytes;
+					}
+
+					template< typename T >
+					T read()
+					{
+						T value;
+						std::memcpy( &value, take( sizeof( T ) ), sizeof( T ) );
+
+						if ( m_swapBytes )
+							return byteswap( value );
+						return value;
+					}
+
+					/*
+					 * Element counts are checked against what is left before anything is allocated
+					 */
+					uint64 readCount( uint64 minElementSize )
+					{
+						auto const count = read< uint64 >();
+
+						if ( count > ( m_size - m_offset ) / minElementSize )
+						{
+							throw Error( "Record runs past the end of the buffer", 1 );
+						}
+
+						return count;
+					}
+
+					void setSwapBytes( bool swapBytes ) { m_swapBytes = swapBytes; }
+
+					[[nodiscard]] bool swapBytes() const { return m_swapBytes; }
+
+					[[nodiscard]] uint64 offset() const { return m_offset; }
+
+					/*
+					 * Stops reading at end, for v2 maps whose index follows the entries
+					 */
+					void limit( uint64 end ) { m_size = end; }
+				private:
+					const uint8* m_data;
+					uint64 m_size;
+					uint64 m_offset = 0;
+					bool m_swapBytes = false;
+				};
+
+				template< class T >
+				inline void GetPayload( Reader& reader, T& value )
+				{
+					value = reader.read< T >();
+				}
+
+				inline void GetPayload( Reader& reader, String& str )
+				{
+					auto const size = reader.read< uint32 >();
+					str.assign( reinterpret_cast< const char* >( reader.take( size ) ), size );
+				}
+
+				template< class T >
+				inline void GetPayload( Reader& reader, Array< T >& arr )
+				{
+					// decoding into a record again reuses its storage
+					if constexpr ( type::is_same< T, String > )
+					{
+						auto const count = reader.readCount( sizeof( uint32 ) );
+
+						if ( arr.size() != count )
+							arr = Array< String >( count );
+
+						for ( auto& str : arr )
+							GetPayload( reader, str );
+					}
+					else
+					{
+						auto const count = reader.readCount( sizeof( T ) );
+						auto const* bytes = reader.take( count * sizeof( T ) );
+
+						if ( arr.size() != count )
+							arr = Array< T >( count );
+
+						if ( count != 0 )
+							std::memcpy( arr.data(), bytes, count * sizeof( T ) );
+
+						if ( reader.swapBytes() )
+							byteswapInPlace( arr.data(), count );
+					}
+				}
+			}
+		}
+
+		/*
+		 * Serializer for a struct with a fixed set of keys, declared as
+		 *
+		 *     using SampleSchema = Schema< Sample, Field< "id", &Sample::id >, Field< "name", &Sample::name > >;
+		 *
+		 * Fields may be arithmetic, String, or Arrays of those. Encoding writes the
+		 * same bitstream_v1 bytes Serialize would for a Map of the fields, in
+		 * declaration order, without going through Values. Decoding accepts
+		 * bitstream_v1 and v2 maps in any entry order, but is fastest in declaration
+		 * order, and throws unless every key is present exactly once with the declared type
+		 */
+		template< class Record, class... Fields >
+		class Schema
+		{
+			static_assert( sizeof...( Fields ) > 0 && sizeof...( Fields ) <= 64, "Schemas hold between 1 and 64 fields" );
+			static_assert( ( type::is_same< typename details::schema::MemberTraits< std::remove_cv_t< decltype( Fields::member ) > >::Class, Record > && ... ),
+				"Every field must be a member of the record" );
+
+			template< class F >
+			using FieldType = typename details::schema::MemberTraits< std::remove_cv_t< decltype( F::member ) > >::Type;
+
+			static constexpr uint64 FieldCount = sizeof...( Fields );
+
+			template< class F >
+			static constexpr bool SameName( StringView name )
+			{
+				if ( name.size() != F::name.size() )
+					return false;
+
+				for ( uint64 i = 0; i < name.size(); ++i )
+					if ( name.data()[ i ] != F::name.data[ i ] )
+						return false;
+
+				return true;
+			}
+
+			template< class F >
+			static constexpr uint64 NameCount()
+			{
+				return ( uint64( SameName< Fields >( StringView( F::name.data, F::name.size() ) ) ) + ... );
+			}
+
+			static_assert( ( NameCount< Fields >() + ... ) == FieldCount, "Field names must be unique" );
+
+			template< class F >
+			static constexpr uint64 FixedPayloadSize()
+			{
+				if constexpr ( details::schema::ValueTraits< FieldType< F > >::isFixed )
+					return details::schema::ValueTraits< FieldType< F > >::fixedSize;
+				else
+					return 0;
+			}
+
+			// bytes that do not depend on the record's contents
+			static constexpr uint64 FixedSize = details::MapHeaderSize
+				+ ( ( sizeof( uint32 ) + Fields::name.size() + sizeof( uint8 ) + FixedPayloadSize< Fields >() ) + ... );
+		public:
+			/*
+			 * Exact number of bytes Serialize will produce for the record
+			 */
+			static uint64 SerializedSize( Record const& record )
+			{
+				uint64 size = FixedSize;
+
+				auto addVariable = [ & ]< class F >()
+				{
+					if constexpr ( !details::schema::ValueTraits< FieldType< F > >::isFixed )
+						size += details::schema::PayloadSize( record.*F::member );
+				};
+
+				( addVariable.template operator()< Fields >(), ... );
+
+				return size;
+			}
+
+			/*
+			 * Writes the record into out, throwing if it does not fit. Returns the bytes written
+			 */
+			template< endianness e = endianness::native >
+			static uint64 Serialize( Record const& record, BufferView< uint8 > out )
+			{
+				auto const size = SerializedSize( record );
+
+				if ( size > out.size() )
+				{
+					throw Error( "Serialized record does not fit in the buffer", 1 );
+				}
+
+				write< e >( record, out.data() );
+
+				return size;
+			}
+
+			template< endianness e = endianness::native >
+			static Array< uint8 > Serialize( Record const& record )
+			{
+				Array< uint8 > buffer( SerializedSize( record ) );
+
+				write< e >( record, buffer.data() );
+
+				return buffer;
+			}
+
+			/*
+			 * Decodes into an existing record, overwriting every field
+			 */
+			static void Deserialize( const uint8* buffer, uint64 size, Record& record )
+			{
+				details::schema::Reader reader( buffer, size );
+
+				auto const* magic = reader.take( 4 );
+
+				if ( magic[ 0 ] != 't' || magic[ 1 ] != 'v' || magic[ 2 ] != 'm' || ( magic[ 3 ] != 1 && magic[ 3 ] != 2 ) )
+				{
+					throw Error( "Expected a bitstream map!", 1 );
+				}
+
+				reader.setSwapBytes( reader.read< uint16 >() != 1 );
+
+				if ( magic[ 3 ] == 2 )
+				{
+					reader.read< uint8 >();
+				}
+
+				auto const numel = reader.read< uint64 >();
+
+				if ( magic[ 3 ] == 2 )
+				{
+					auto const byteLength = reader.read< uint64 >();
+
+					if ( byteLength > size || byteLength < reader.offset() )
+					{
+						throw Error( "Invalid buffer length! Map runs past the end!", 1 );
+					}
+
+					reader.limit( byteLength );
+				}
+
+				if ( numel != FieldCount )
+				{
+					throw Error( "Record does not have the schema's number of fields", 1 );
+				}
+
+				uint64 seen = 0;
+
+				for ( uint64 i = 0; i < numel; ++i )
+				{
+					auto const keySize = reader.read< uint32 >();
+					auto const key = StringView( reinterpret_cast< const char* >( reader.take( keySize ) ), keySize );
+					auto const type = Type( reader.read< uint8 >() );
+
+					if ( !readAt( std::make_integer_sequence< uint64, FieldCount >{}, i, key, type, reader, record, seen )
+						&& !readAny( key, type, reader, record, seen ) )
+					{
+						throw Error( "Record has a key the schema does not know", 1 );
+					}
+				}
+			}
+
+			static Record Deserialize( const uint8* buffer, uint64 size )
+			{
+				Record record{};
+				Deserialize( buffer, size, record );
+				return record;
+			}
+
+			static Record Deserialize( Array< uint8 > const& buffer )
+			{
+				return Deserialize( buffer.data(), buffer.size() );
+			}
+		private:
+			template< endianness e >
+			static void write( Record const& record, uint8* out )
+			{
+				static_assert( e == endianness::little || e == endianness::big );
+
+				constexpr uint8 header[] = { 't', 'v', 'm', 1 };
+				std::memcpy( out, header, sizeof( header ) );
+				out += sizeof( header );
+
+				details::schema::Put< e >( out, uint16( 1 ) );
+				details::schema::Put< e >( out, uint64( FieldCount ) );
+
+				auto writeField = [ & ]< class F >()
+				{
+					using T = FieldType< F >;
+					static constexpr details::schema::FieldPrefix< e, F, T > prefix;
+
+					std::memcpy( out, prefix.bytes, prefix.size );
+					out += prefix.size;
+
+					details::schema::PutPayload< e >( out, record.*F::member );
+				};
+
+				( writeField.template operator()< Fields >(), ... );
+			}
+
+			template< class F >
+			static bool read( StringView key, Type type, details::schema::Reader& reader, Record& record, uint64& seen, uint64 bit )
+			{
+				if ( !SameName< F >( key ) )
+					return false;
+
+				if ( type != details::templateToVariantType< FieldType< F > >() )
+				{
+					throw Error( "Record field has the wrong type", 1 );
+				}
+
+				if ( seen & bit )
+				{
+					throw Error( "Record has a duplicate key", 1 );
+				}
+
+				seen |= bit;
+
+				details::schema::GetPayload( reader, record.*F::member );
+
+				return true;
+			}
+
+			/*
+			 * The common case, where entry i is field i
+			 */
+			template< uint64... Is >
+			static bool readAt( std::integer_sequence< uint64, Is... >, uint64 i, StringView key, Type type, details::schema::Reader& reader, Record& record, uint64& seen )
+			{
+				return ( ( Is == i && read< Fields >( key, type, reader, record, seen, uint64( 1 ) << Is ) ) || ... );
+			}
+
+			template< uint64... Is >
+			static bool readAny( std::integer_sequence< uint64, Is... >, StringView key, Type type, details::schema::Reader& reader, Record& record, uint64& seen )
+			{
+				return ( read< Fields >( key, type, reader, record, seen, uint64( 1 ) << Is ) || ... );
+			}
+
+			static bool readAny( StringView key, Type type, details::schema::Reader& reader, Record& record, uint64& seen )
+			{
+				return readAny( std::make_integer_sequence< uint64, FieldCount >{}, key, type, reader, record, seen );
+			}
+		};
+	}
+}
@@ -1,9 +1,20 @@
 #include "Serialize.h"
 
-#include <iostream>
+#include <cstring>
 #include <type_traits>
 #include <cassert>
+#include <cerrno>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Format.h"
+#include "../../Algorithm.h"
+#include "../../HashMap.h"
+#include "../../utility.h"
 #include "../../endianness.h"
 #include "../../Error.h"
 
@@ -11,260 +22,818 @@ namespace t
 {
 	namespace variant
 	{
-		template< endianness >
-		void AddToBuffer( Array< uint8 >& buffer, uint8 data )
+		namespace details
 		{
-			buffer.pushBack( data );
-		}
+			/*
+			 * Writes into a buffer that was sized up front with SerializedSize
+			 */
+			class BufferWriter
+			{
+			public:
+				explicit BufferWriter( uint8* out ):
+					m_pos( out ) {}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, uint16 data )
-		{
-			if constexpr ( e != endianness::native )
-				data = byteswap( data );
-			const uint8* const ptr = reinterpret_cast< uint8* >( &data );
-			buffer.pushBack( ptr[ 0 ] );
-			buffer.pushBack( ptr[ 1 ] );
-		}
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, uint32 data )
-		{
-			if constexpr ( e != endianness::native )
-				data = byteswap( data );
-			const uint8* const ptr = reinterpret_cast< uint8* >( &data );
-			buffer.pushBack( ptr[ 0 ] );
-			buffer.pushBack( ptr[ 1 ] );
-			buffer.pushBack( ptr[ 2 ] );
-			buffer.pushBack( ptr[ 3 ] );
-		}
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, uint64 data )
-		{
-			if constexpr ( e != endianness::native )
-				data = byteswap( data );
-			const uint8* const ptr = reinterpret_cast<uint8*>(&data);
-			buffer.pushBack( ptr[ 0 ] );
-			buffer.pushBack( ptr[ 1 ] );
-			buffer.pushBack( ptr[ 2 ] );
-			buffer.pushBack( ptr[ 3 ] );
-			buffer.pushBack( ptr[ 4 ] );
-			buffer.pushBack( ptr[ 5 ] );
-			buffer.pushBack( ptr[ 6 ] );
-			buffer.pushBack( ptr[ 7 ] );
-		}
+				void writeBytes( const void* data, uint64 size )
+				{
+					if ( size == 0 )
+						return;
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, int8 data )
-		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint8* >( &data ) );
+					std::memcpy( m_pos, data, size );
+					m_pos += size;
+				}
+
+				uint8* position() const { return m_pos; }
+			private:
+				uint8* m_pos;
+			};
+
+			/*
+			 * Only counts bytes, for formats whose size is easiest found by encoding twice
+			 */
+			class CountingWriter
+			{
+			public:
+				void writeBytes( const void*, uint64 size )
+				{
+					m_count += size;
+				}
+
+				uint64 count() const { return m_count; }
+			private:
+				uint64 m_count = 0;
+			};
+
+			/*
+			 * Stages output in a fixed size buffer and hands it to the sink whenever it fills up
+			 */
+			class StreamWriter
+			{
+			public:
+				StreamWriter( Sink& sink, BufferView< uint8 > buffer ):
+					m_sink( sink ),
+					m_buffer( buffer ) {}
+
+				void writeBytes( const void* data, uint64 size )
+				{
+					auto const* bytes = static_cast< const uint8* >( data );
+
+					if ( size > m_buffer.size() - m_used )
+					{
+						flush();
+
+						// too big to be worth staging, skip the copy
+						if ( size >= m_buffer.size() )
+						{
+							m_sink.write( bytes, size );
+							return;
+						}
+					}
+
+					if ( size == 0 )
+						return;
+
+					std::memcpy( m_buffer.data() + m_used, bytes, size );
+					m_used += size;
+				}
+
+				void flush()
+				{
+					if ( m_used == 0 )
+						return;
+
+					m_sink.write( m_buffer.data(), m_used );
+					m_used = 0;
+				}
+			private:
+				Sink& m_sink;
+				BufferView< uint8 > m_buffer;
+				uint64 m_used = 0;
+			};
 		}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, int16 data )
+		void FileDescriptorSink::write( const uint8* data, uint64 size )
 		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint16* >( &data ) );
+			while ( size > 0 )
+			{
+#ifdef _WIN32
+				auto const chunk = size < 0x40000000 ? unsigned( size ) : 0x40000000u;
+				auto const written = ::_write( m_fd, data, chunk );
+#else
+				auto const written = ::write( m_fd, data, size );
+#endif
+				if ( written < 0 )
+				{
+					if ( errno == EINTR )
+						continue;
+
+					throw Error( "Failed to write to file descriptor", 1 );
+				}
+
+				data += written;
+				size -= uint64( written );
+			}
 		}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, int32 data )
+		void BufferViewSink::write( const uint8* data, uint64 size )
 		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint32* >( &data ) );
+			if ( size > m_buffer.size() - m_written )
+			{
+				throw Error( "Serialized map does not fit in the buffer", 1 );
+			}
+
+			if ( size == 0 )
+				return;
+
+			std::memcpy( m_buffer.data() + m_written, data, size );
+			m_written += size;
 		}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, int64 data )
+		void ArraySink::write( const uint8* data, uint64 size )
 		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint64* >( &data ) );
+			if ( size > m_buffer.size() - m_used )
+			{
+				auto const doubled = m_buffer.size() * 2;
+				m_buffer.resize( doubled > m_used + size ? doubled : m_used + size );
+			}
+
+			if ( size == 0 )
+				return;
+
+			std::memcpy( m_buffer.data() + m_used, data, size );
+			m_used += size;
 		}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, float data )
+		Array< uint8 > ArraySink::take()
 		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint32* >( &data ) );
+			if ( m_buffer.size() != m_used )
+				m_buffer.resize( m_used );
+
+			m_used = 0;
+
+			return t::exchange( m_buffer, Array< uint8 >() );
 		}
 
-		template< endianness e >
-		void AddToBuffer( Array< uint8 >& buffer, double data )
+		template< endianness e, class Writer, typename T >
+		void AddToBuffer( Writer& writer, T data )
 		{
-			AddToBuffer< e >( buffer, *reinterpret_cast< uint64* >( &data ) );
+			static_assert( type::is_arithmetic< T > );
+
+			if constexpr ( e != endianness::native )
+				data = byteswap( data );
+
+			writer.writeBytes( &data, sizeof( T ) );
 		}
 
-		template< endianness e, typename T >
-		void AddToBuffer( Array< uint8 >& buffer, Array< T > const& data )
+		template< endianness e, class Writer, typename T >
+		void AddToBuffer( Writer& writer, Array< T > const& data )
 		{
-			for ( uint64 i = 0; i < data.size(); ++i )
+			if constexpr ( e == endianness::native || sizeof( T ) == 1 )
 			{
-				AddToBuffer< e >( buffer, data[ i ] );
+				writer.writeBytes( data.data(), data.size() * sizeof( T ) );
+			}
+			else
+			{
+				// swap a block at a time, so the data only passes through the cache once
+				constexpr uint64 BlockSize = 4096 / sizeof( T );
+
+				T block[ BlockSize ];
+
+				for ( uint64 i = 0; i < data.size(); i += BlockSize )
+				{
+					auto const count = data.size() - i < BlockSize ? data.size() - i : BlockSize;
+
+					std::memcpy( block, data.data() + i, count * sizeof( T ) );
+					byteswapInPlace( block, count );
+					writer.writeBytes( block, count * sizeof( T ) );
+				}
 			}
 		}
 
 		inline namespace bitstream_v1
 		{
-			template< endianness >
-			void Serialize( Array< uint8 >& buffer, Map const& map );
+			uint64 SerializedSize( String const& str )
+			{
+				return sizeof( uint32 ) + str.size();
+			}
 
-			template< endianness e >
-			void Serialize( Array< uint8 >& buffer, String const& str )
+			uint64 SerializedSize( Value const& val )
+			{
+				uint64 size = sizeof( Type );
+
+				switch ( val.getType() )
+				{
+				case Type::VOID:
+					return size;
+				case Type::INT8:
+				case Type::UINT8:
+					return size + sizeof( uint8 );
+				case Type::INT16:
+				case Type::UINT16:
+					return size + sizeof( uint16 );
+				case Type::INT32:
+				case Type::UINT32:
+				case Type::FLOAT:
+					return size + sizeof( uint32 );
+				case Type::INT64:
+				case Type::UINT64:
+				case Type::DOUBLE:
+					return size + sizeof( uint64 );
+				case Type::STRING:
+					return size + SerializedSize( val.As< String const& >() );
+				case Type::MAP:
+					return size + SerializedSize( val.As< Map const& >() );
+				case Type::INT8_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< int8 > const& >().size() * sizeof( int8 );
+				case Type::INT16_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< int16 > const& >().size() * sizeof( int16 );
+				case Type::INT32_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< int32 > const& >().size() * sizeof( int32 );
+				case Type::INT64_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< int64 > const& >().size() * sizeof( int64 );
+				case Type::UINT8_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< uint8 > const& >().size() * sizeof( uint8 );
+				case Type::UINT16_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< uint16 > const& >().size() * sizeof( uint16 );
+				case Type::UINT32_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< uint32 > const& >().size() * sizeof( uint32 );
+				case Type::UINT64_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< uint64 > const& >().size() * sizeof( uint64 );
+				case Type::FLOAT_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< float > const& >().size() * sizeof( float );
+				case Type::DOUBLE_ARRAY:
+					return size + sizeof( uint64 ) + val.As< Array< double > const& >().size() * sizeof( double );
+				case Type::STRING_ARRAY:
+				{
+					size += sizeof( uint64 );
+					for ( auto const& str : val.As< Array< String > const& >() )
+						size += SerializedSize( str );
+					return size;
+				}
+				}
+				assert( false );
+				return size;
+			}
+
+			uint64 SerializedSize( Map const& map )
+			{
+				uint64 size = details::MapHeaderSize;
+
+				for ( auto const& [ key, value ] : map )
+				{
+					size += SerializedSize( key ) + SerializedSize( value );
+				}
+
+				return size;
+			}
+
+			template< endianness, class Writer >
+			void Serialize( Writer& writer, Map const& map );
+
+			template< endianness e, class Writer >
+			void Serialize( Writer& writer, String const& str )
 			{
 				auto const size = str.size();
 				if ( size > limit< uint32 >::max )
 				{
 					throw Error( "Strings lengths must fit into a 32-bit number", 1 );
 				}
-				AddToBuffer< e >( buffer, static_cast< uint32 >( size ) );
-				for ( uint64 i = 0; i < str.size(); ++i )
+				AddToBuffer< e >( writer, static_cast< uint32 >( size ) );
+				writer.writeBytes( str.data(), size );
+			}
+
+			template< endianness e, class Writer, typename T >
+			void SerializePrimitiveValue( Writer& writer, T data )
+			{
+				auto constexpr type = details::templateToVariantType< T >();
+				AddToBuffer< e >( writer, static_cast< uint8 >( type ) );
+				AddToBuffer< e >( writer, data );
+			}
+
+			template< endianness e, class Writer, typename T >
+			void SerializeArrayValue( Writer& writer, Array< T > const& data )
+			{
+				AddToBuffer< e >( writer, static_cast< uint8 >( details::templateToVariantType< Array< T > >() ) );
+				AddToBuffer< e >( writer, uint64( data.size() ) );
+				AddToBuffer< e >( writer, data );
+			}
+
+			template< endianness e, class Writer >
+			void SerializeComplexValue( Writer& writer, String const& data )
+			{
+				AddToBuffer< e >( writer, static_cast< uint8 >( details::templateToVariantType< String >() ) );
+				Serialize< e >( writer, data );
+			}
+
+			template< endianness e, class Writer >
+			void SerializeComplexValue( Writer& writer, Map const& data )
+			{
+				AddToBuffer< e >( writer, static_cast< uint8 >( details::templateToVariantType< Map >() ) );
+				Serialize< e >( writer, data );
+			}
+
+			template< endianness e, class Writer >
+			void SerializeComplexValue( Writer& writer, Array< String > const& data )
+			{
+				AddToBuffer< e >( writer, static_cast< uint8 >( details::templateToVariantType< Array< String > >() ) );
+				AddToBuffer< e >( writer, uint64( data.size() ) );
+				for ( uint64 i = 0; i < data.size(); ++i )
 				{
-					AddToBuffer< e >( buffer, *reinterpret_cast< uint8 const* >( &str[ i ] ) );
+					Serialize< e >( writer, data[ i ] );
 				}
 			}
 
-			template< endianness, typename T >
-			void SerializeComplexValue( Array< uint8 >& buffer, T const& data );
+			template< endianness e, class Writer >
+			void SerializeEmptyValue( Writer& writer )
+			{
+				AddToBuffer< e >( writer, static_cast< uint8 >( Type::VOID ) );
+			}
 
-			template< endianness e, typename T >
-			void SerializePrimitiveValue( Array< uint8 >& buffer, T data )
+			template< endianness e, class Writer >
+			void SerializeValue( Writer& writer, Value const& val )
 			{
-				auto constexpr type = details::templateToVariantType< T >();
-				AddToBuffer< e >( buffer, static_cast< uint8 >( type ) );
-				AddToBuffer< e >( buffer, data );
+				const auto type = val.getType();
+
+				switch ( type )
+				{
+				case Type::VOID:
+					return SerializeEmptyValue< e >( writer );
+				case Type::INT8:
+					return SerializePrimitiveValue< e >( writer, val.As< int8 >() );
+				case Type::INT16:
+					return SerializePrimitiveValue< e >( writer, val.As< int16 >() );
+				case Type::INT32:
+					return SerializePrimitiveValue< e >( writer, val.As< int32 >() );
+				case Type::INT64:
+					return SerializePrimitiveValue< e >( writer, val.As< int64 >() );
+				case Type::UINT8:
+					return SerializePrimitiveValue< e >( writer, val.As< uint8 >() );
+				case Type::UINT16:
+					return SerializePrimitiveValue< e >( writer, val.As< uint16 >() );
+				case Type::UINT32:
+					return SerializePrimitiveValue< e >( writer, val.As< uint32 >() );
+				case Type::UINT64:
+					return SerializePrimitiveValue< e >( writer, val.As< uint64 >() );
+				case Type::FLOAT:
+					return SerializePrimitiveValue< e >( writer, val.As< float >() );
+				case Type::DOUBLE:
+					return SerializePrimitiveValue< e >( writer, val.As< double >() );
+				case Type::STRING:
+					return SerializeComplexValue< e >( writer, val.As< String const& >() );
+				case Type::MAP:
+					return SerializeComplexValue< e >( writer, val.As< Map const& >() );
+				case Type::INT8_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< int8 > const& >() );
+				case Type::INT16_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< int16 > const& >() );
+				case Type::INT32_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< int32 > const& >() );
+				case Type::INT64_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< int64 > const& >() );
+				case Type::UINT8_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< uint8 > const& >() );
+				case Type::UINT16_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< uint16 > const& >() );
+				case Type::UINT32_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< uint32 > const& >() );
+				case Type::UINT64_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< uint64 > const& >() );
+				case Type::FLOAT_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< float > const& >() );
+				case Type::DOUBLE_ARRAY:
+					return SerializeArrayValue< e >( writer, val.As< Array< double > const& >() );
+				case Type::STRING_ARRAY:
+					return SerializeComplexValue< e >( writer, val.As< Array< String > const& >() );
+				}
+				assert( false );
 			}
 
-			template< endianness e, typename T >
-			void SerializeArrayValue( Array< uint8 >& buffer, Array< T > const& data )
+			template< endianness e, class Writer >
+			void Serialize( Writer& writer, Map const& map )
 			{
-				AddToBuffer< e >( buffer, static_cast< uint8 >( details::templateToVariantType< Array< T > >() ) );
-				AddToBuffer< e >( buffer, uint64( data.size() ) );
+				constexpr uint8 header[] = { 't', 'v', 'm', 1 };
+				writer.writeBytes( header, sizeof( header ) );
 
-				for ( uint64 i = 0; i < data.size(); ++i )
+				AddToBuffer< e >( writer, uint16( 1 ) );
+				AddToBuffer< e >( writer, uint64( map.size() ) );
+
+				for ( auto const& [ key, value ] : map )
 				{
-					AddToBuffer< e >( buffer, data[ i ] );
+					Serialize< e >( writer, key );
+					SerializeValue< e >( writer, value );
 				}
 			}
 
 			template< endianness e >
-			void SerializeComplexValue( Array< uint8 >& buffer, String const& data )
+			Array< uint8 > Serialize( Map const& map )
 			{
-				AddToBuffer< e >( buffer, static_cast< uint8 >( details::templateToVariantType< String >() ) );
-				Serialize< e >( buffer, data );
+				auto const size = SerializedSize( map );
+
+				Array< uint8 > buffer( size );
+
+				details::BufferWriter writer( buffer.data() );
+
+				Serialize< e >( writer, map );
+
+				assert( writer.position() == buffer.data() + size );
+
+				return buffer;
 			}
 
 			template< endianness e >
-			void SerializeComplexValue( Array< uint8 >& buffer, Map const& data )
+			void Serialize( Map const& map, Sink& sink, BufferView< uint8 > scratch )
 			{
-				AddToBuffer< e >( buffer, static_cast< uint8 >( details::templateToVariantType< Map >() ) );
-				Serialize< e >( buffer, data );
+				if ( scratch.size() == 0 )
+				{
+					throw Error( "Streaming serialization needs a non-empty buffer", 1 );
+				}
+
+				details::StreamWriter writer( sink, scratch );
+
+				Serialize< e >( writer, map );
+
+				writer.flush();
 			}
 
 			template< endianness e >
-			void SerializeComplexValue( Array< uint8 >& buffer, Array< String > const& data )
+			void Serialize( Map const& map, Sink& sink )
 			{
-				AddToBuffer< e >( buffer, static_cast< uint8 >( details::templateToVariantType< Array< String > >() ) );
-				AddToBuffer< e >( buffer, uint64( data.size() ) );
-				for ( uint64 i = 0; i < data.size(); ++i )
+				Array< uint8 > scratch( DefaultStreamBufferSize );
+
+				Serialize< e >( map, sink, BufferView< uint8 >( scratch.data(), scratch.size() ) );
+			}
+
+			template Array< uint8 > Serialize< endianness::little >( Map const& );
+			template Array< uint8 > Serialize< endianness::big >( Map const& );
+
+			template void Serialize< endianness::little >( Map const&, Sink& );
+			template void Serialize< endianness::big >( Map const&, Sink& );
+
+			template void Serialize< endianness::little >( Map const&, Sink&, BufferView< uint8 > );
+			template void Serialize< endianness::big >( Map const&, Sink&, BufferView< uint8 > );
+		}
+
+		namespace bitstream_v2
+		{
+			/*
+			 * Only maps are laid out differently from v1, every other value is written the same way.
+			 * With sizes given, the size of the map and of every map nested in it are appended
+			 * in the order Serialize writes them, so each map is measured once
+			 */
+			uint64 MeasureMap( Map const& map, bool withIndex, Array< uint64 >* sizes )
+			{
+				auto const slot = sizes ? sizes->size() : 0;
+
+				if ( sizes )
+				{
+					sizes->pushBack( 0 );
+				}
+
+				uint64 size = details::v2::MapHeaderSize;
+
+				for ( auto const& [ key, value ] : map )
+				{
+					size += bitstream_v1::SerializedSize( key );
+
+					if ( value.getType() == Type::MAP )
+						size += sizeof( Type ) + MeasureMap( value.As< Map const& >(), withIndex, sizes );
+					else
+						size += bitstream_v1::SerializedSize( value );
+				}
+
+				if ( withIndex )
+				{
+					size += map.size() * details::v2::IndexEntrySize;
+				}
+
+				if ( sizes )
+				{
+					( *sizes )[ slot ] = size;
+				}
+
+				return size;
+			}
+
+			uint64 SerializedSize( Map const& map, bool withIndex )
+			{
+				return MeasureMap( map, withIndex, nullptr );
+			}
+
+			struct IndexEntry
+			{
+				uint64 hash;
+				uint64 offset;
+			};
+
+			/*
+			 * sizes points at the size of this map, as measured by MeasureMap, and
+			 * is moved past the sizes of every map written
+			 */
+			template< endianness e, class Writer >
+			void Serialize( Writer& writer, Map const& map, bool withIndex, uint64 const*& sizes )
+			{
+				constexpr uint8 header[] = { 't', 'v', 'm', 2 };
+				writer.writeBytes( header, sizeof( header ) );
+
+				AddToBuffer< e >( writer, uint16( 1 ) );
+				AddToBuffer< e >( writer, uint8( withIndex ? details::v2::HasIndex : 0 ) );
+				AddToBuffer< e >( writer, uint64( map.size() ) );
+				AddToBuffer< e >( writer, *sizes++ );
+
+				Array< IndexEntry > index( withIndex ? map.size() : 0 );
+
+				uint64 offset = details::v2::MapHeaderSize;
+				uint64 i = 0;
+
+				for ( auto const& [ key, value ] : map )
+				{
+					if ( withIndex )
+					{
+						index[ i++ ] = { details::v2::KeyHash( key.data(), key.size() ), offset };
+					}
+
+					bitstream_v1::Serialize< e >( writer, key );
+					offset += bitstream_v1::SerializedSize( key );
+
+					if ( value.getType() == Type::MAP )
+					{
+						// the nested map's size is the next one
+						offset += sizeof( Type ) + *sizes;
+
+						AddToBuffer< e >( writer, static_cast< uint8 >( Type::MAP ) );
+						Serialize< e >( writer, value.template As< Map const& >(), withIndex, sizes );
+					}
+					else
+					{
+						offset += bitstream_v1::SerializedSize( value );
+
+						bitstream_v1::SerializeValue< e >( writer, value );
+					}
+				}
+
+				if ( !withIndex )
+					return;
+
+				t::sort( index.begin(), index.end(), []( IndexEntry const& lhs, IndexEntry const& rhs )
+				{
+					return lhs.hash < rhs.hash;
+				} );
+
+				for ( auto const& entry : index )
 				{
-					Serialize< e >( buffer, data[ i ] );
+					AddToBuffer< e >( writer, entry.hash );
+					AddToBuffer< e >( writer, entry.offset );
 				}
 			}
 
 			template< endianness e >
-			void SerializeEmptyValue( Array< uint8 >& buffer )
+			Array< uint8 > Serialize( Map const& map, bool withIndex )
 			{
-				AddToBuffer< e >( buffer, static_cast< uint8 >( Type::VOID ) );
+				Array< uint64 > sizes;
+				auto const size = MeasureMap( map, withIndex, &sizes );
+
+				Array< uint8 > buffer( size );
+
+				details::BufferWriter writer( buffer.data() );
+
+				uint64 const* nextSize = sizes.data();
+				Serialize< e >( writer, map, withIndex, nextSize );
+
+				assert( writer.position() == buffer.data() + size );
+
+				return buffer;
 			}
 
 			template< endianness e >
-			void SerializeValue( Array< uint8 >& buffer, Value const& val )
+			void Serialize( Map const& map, Sink& sink, bool withIndex )
 			{
-				const auto type = val.getType();
+				Array< uint8 > scratch( DefaultStreamBufferSize );
 
-				switch ( type )
+				details::StreamWriter writer( sink, BufferView< uint8 >( scratch.data(), scratch.size() ) );
+
+				Array< uint64 > sizes;
+				MeasureMap( map, withIndex, &sizes );
+
+				uint64 const* nextSize = sizes.data();
+				Serialize< e >( writer, map, withIndex, nextSize );
+
+				writer.flush();
+			}
+
+			template Array< uint8 > Serialize< endianness::little >( Map const&, bool );
+			template Array< uint8 > Serialize< endianness::big >( Map const&, bool );
+
+			template void Serialize< endianness::little >( Map const&, Sink&, bool );
+			template void Serialize< endianness::big >( Map const&, Sink&, bool );
+		}
+
+		namespace compact
+		{
+			template< class Writer >
+			void WriteVarint( Writer& writer, uint64 value )
+			{
+				uint8 bytes[ details::compact::MaxVarintSize ];
+				uint64 size = 0;
+
+				while ( value >= 0x80 )
+				{
+					bytes[ size++ ] = uint8( value ) | 0x80;
+					value >>= 7;
+				}
+
+				bytes[ size++ ] = uint8( value );
+
+				writer.writeBytes( bytes, size );
+			}
+
+			template< class Writer, typename T >
+			void WriteInteger( Writer& writer, T value )
+			{
+				if constexpr ( sizeof( T ) == 1 )
+					writer.writeBytes( &value, 1 );
+				else if constexpr ( type::is_signed< T > )
+					WriteVarint( writer, details::compact::ZigZag( int64( value ) ) );
+				else
+					WriteVarint( writer, uint64( value ) );
+			}
+
+			template< class Writer >
+			void WriteString( Writer& writer, String const& str )
+			{
+				WriteVarint( writer, str.size() );
+				writer.writeBytes( str.data(), str.size() );
+			}
+
+			/*
+			 * Each element is stored as the zigzagged difference from the one before it,
+			 * so sorted or slowly changing data shrinks to a byte or two per element
+			 */
+			template< class Writer, typename T >
+			void WriteArray( Writer& writer, Array< T > const& data )
+			{
+				WriteVarint( writer, data.size() );
+
+				if constexpr ( type::is_floating_point< T > || sizeof( T ) == 1 )
+				{
+					AddToBuffer< endianness::little >( writer, data );
+				}
+				else
+				{
+					using Unsigned = std::make_unsigned_t< T >;
+					using Signed = std::make_signed_t< T >;
+
+					Unsigned previous = 0;
+
+					for ( auto const value : data )
+					{
+						auto const delta = Unsigned( Unsigned( value ) - previous );
+						WriteVarint( writer, details::compact::ZigZag( int64( Signed( delta ) ) ) );
+						previous = Unsigned( value );
+					}
+				}
+			}
+
+			using KeyDictionary = HashMap< String, uint64 >;
+
+			template< class Writer >
+			void Serialize( Writer& writer, Map const& map, KeyDictionary& keys );
+
+			template< class Writer >
+			void SerializeValue( Writer& writer, Value const& val, KeyDictionary& keys )
+			{
+				switch ( val.getType() )
 				{
 				case Type::VOID:
-					return SerializeEmptyValue< e >( buffer );
+					return;
 				case Type::INT8:
-					return SerializePrimitiveValue< e >( buffer, val.As< int8 >() );
+					return WriteInteger( writer, val.As< int8 >() );
 				case Type::INT16:
-					return SerializePrimitiveValue< e >( buffer, val.As< int16 >() );
+					return WriteInteger( writer, val.As< int16 >() );
 				case Type::INT32:
-					return SerializePrimitiveValue< e >( buffer, val.As< int32 >() );
+					return WriteInteger( writer, val.As< int32 >() );
 				case Type::INT64:
-					return SerializePrimitiveValue< e >( buffer, val.As< int64 >() );
+					return WriteInteger( writer, val.As< int64 >() );
 				case Type::UINT8:
-					return SerializePrimitiveValue< e >( buffer, val.As< uint8 >() );
+					return WriteInteger( writer, val.As< uint8 >() );
 				case Type::UINT16:
-					return SerializePrimitiveValue< e >( buffer, val.As< uint16 >() );
+					return WriteInteger( writer, val.As< uint16 >() );
 				case Type::UINT32:
-					return SerializePrimitiveValue< e >( buffer, val.As< uint32 >() );
+					return WriteInteger( writer, val.As< uint32 >() );
 				case Type::UINT64:
-					return SerializePrimitiveValue< e >( buffer, val.As< uint64 >() );
+					return WriteInteger( writer, val.As< uint64 >() );
 				case Type::FLOAT:
-					return SerializePrimitiveValue< e >( buffer, val.As< float >() );
+					return AddToBuffer< endianness::little >( writer, val.As< float >() );
 				case Type::DOUBLE:
-					return SerializePrimitiveValue< e >( buffer, val.As< double >() );
+					return AddToBuffer< endianness::little >( writer, val.As< double >() );
 				case Type::STRING:
-					return SerializeComplexValue< e >( buffer, val.As< String const& >() );
+					return WriteString( writer, val.As< String const& >() );
 				case Type::MAP:
-					return SerializeComplexValue< e >( buffer, val.As< Map const& >() );
+					return Serialize( writer, val.As< Map const& >(), keys );
 				case Type::INT8_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< int8 > const& >() );
+					return WriteArray( writer, val.As< Array< int8 > const& >() );
 				case Type::INT16_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< int16 > const& >() );
+					return WriteArray( writer, val.As< Array< int16 > const& >() );
 				case Type::INT32_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< int32 > const& >() );
+					return WriteArray( writer, val.As< Array< int32 > const& >() );
 				case Type::INT64_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< int64 > const& >() );
+					return WriteArray( writer, val.As< Array< int64 > const& >() );
 				case Type::UINT8_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< uint8 > const& >() );
+					return WriteArray( writer, val.As< Array< uint8 > const& >() );
 				case Type::UINT16_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< uint16 > const& >() );
+					return WriteArray( writer, val.As< Array< uint16 > const& >() );
 				case Type::UINT32_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< uint32 > const& >() );
+					return WriteArray( writer, val.As< Array< uint32 > const& >() );
 				case Type::UINT64_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< uint64 > const& >() );
+					return WriteArray( writer, val.As< Array< uint64 > const& >() );
 				case Type::FLOAT_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< float > const& >() );
+					return WriteArray( writer, val.As< Array< float > const& >() );
 				case Type::DOUBLE_ARRAY:
-					return SerializeArrayValue< e >( buffer, val.As< Array< double > const& >() );
+					return WriteArray( writer, val.As< Array< double > const& >() );
 				case Type::STRING_ARRAY:
-					return SerializeComplexValue< e >( buffer, val.As< Array< String > const& >() );
+				{
+					auto const& strings = val.As< Array< String > const& >();
+
+					WriteVarint( writer, strings.size() );
+
+					for ( auto const& str : strings )
+						WriteString( writer, str );
+
+					return;
+				}
 				}
 				assert( false );
 			}
 
-			template< endianness e >
-			void Serialize( Array< uint8 >& buffer, Map const& map )
+			template< class Writer >
+			void Serialize( Writer& writer, Map const& map, KeyDictionary& keys )
 			{
-				buffer.pushBack( 't' );
-				buffer.pushBack( 'v' );
-				buffer.pushBack( 'm' );
-				buffer.pushBack( 1 );
+				WriteVarint( writer, map.size() );
 
-				AddToBuffer< e >( buffer, uint16( 1 ) );
-				AddToBuffer< e >( buffer, uint64( map.size() ) );
-				
 				for ( auto const& [ key, value ] : map )
 				{
-					Serialize< e >( buffer, key );
-					SerializeValue< e >( buffer, value );
+					auto const tag = static_cast< uint8 >( value.getType() );
+
+					// keys seen before in this message are written as their index into the dictionary
+					if ( auto const* index = keys.find( key ) )
+					{
+						AddToBuffer< endianness::little >( writer, tag );
+						WriteVarint( writer, *index );
+					}
+					else
+					{
+						AddToBuffer< endianness::little >( writer, uint8( tag | details::compact::NewKey ) );
+						WriteString( writer, key );
+						keys.insert( { key, keys.size() } );
+					}
+
+					SerializeValue( writer, value, keys );
 				}
 			}
 
-			template< endianness e >
+			template< class Writer >
+			void SerializeMessage( Writer& writer, Map const& map )
+			{
+				constexpr uint8 header[] = { 't', 'v', 'c', 1 };
+				writer.writeBytes( header, sizeof( header ) );
+
+				KeyDictionary keys;
+
+				Serialize( writer, map, keys );
+			}
+
+			uint64 SerializedSize( Map const& map )
+			{
+				details::CountingWriter counter;
+
+				SerializeMessage( counter, map );
+
+				return counter.count();
+			}
+
 			Array< uint8 > Serialize( Map const& map )
 			{
-				Array< uint8 > buffer;
+				auto const size = compact::SerializedSize( map );
+
+				Array< uint8 > buffer( size );
 
-				constexpr auto DefaultArrayLength = 160;
+				details::BufferWriter writer( buffer.data() );
 
-				buffer.reserve( DefaultArrayLength );
+				SerializeMessage( writer, map );
 
-				Serialize< e >( buffer, map );
+				assert( writer.position() == buffer.data() + size );
 
 				return buffer;
 			}
 
-			template Array< uint8 > Serialize< endianness::little >( Map const& );
-			template Array< uint8 > Serialize< endianness::big >( Map const& );
+			void Serialize( Map const& map, Sink& sink )
+			{
+				Array< uint8 > scratch( DefaultStreamBufferSize );
+
+				details::StreamWriter writer( sink, BufferView< uint8 >( scratch.data(), scratch.size() ) );
+
+				SerializeMessage( writer, map );
+
+				writer.flush();
+			}
 		}
 	}
 }
@@ -3,19 +3,165 @@
 //#include "../Map.h"
 #include "../variant.h"
 #include "../../Array.h"
+#include "../../BufferView.h"
 #include "../../endianness.h"
 
 namespace t
 {
 	namespace variant
 	{
+		/*
+		 * Destination for streamed serialization. Receives the output
+		 * in order, a chunk at a time
+		 */
+		class Sink
+		{
+		public:
+			virtual ~Sink() = default;
+
+			virtual void write( const uint8* data, uint64 size ) = 0;
+		};
+
+		/*
+		 * Writes to an open file descriptor, which stays owned by the caller
+		 */
+		class FileDescriptorSink final : public Sink
+		{
+		public:
+			explicit FileDescriptorSink( int fd ):
+				m_fd( fd ) {}
+
+			void write( const uint8* data, uint64 size ) final override;
+		private:
+			int m_fd;
+		};
+
+		/*
+		 * Fills a caller owned buffer, throwing if the output does not fit
+		 */
+		class BufferViewSink final : public Sink
+		{
+		public:
+			explicit BufferViewSink( BufferView< uint8 > buffer ):
+				m_buffer( buffer ) {}
+
+			void write( const uint8* data, uint64 size ) final override;
+
+			uint64 bytesWritten() const { return m_written; }
+		private:
+			BufferView< uint8 > m_buffer;
+			uint64 m_written = 0;
+		};
+
+		/*
+		 * Collects the output in an Array that grows as needed
+		 */
+		class ArraySink final : public Sink
+		{
+		public:
+			void write( const uint8* data, uint64 size ) final override;
+
+			/*
+			 * Hands over everything written so far, trimmed to size
+			 */
+			[[nodiscard]] Array< uint8 > take();
+		private:
+			Array< uint8 > m_buffer;
+			uint64 m_used = 0;
+		};
+
+		/*
+		 * Forwards every chunk to func( const uint8* data, uint64 size )
+		 */
+		template< class Func >
+		class CallbackSink final : public Sink
+		{
+		public:
+			explicit CallbackSink( Func func ):
+				m_func( t::move( func ) ) {}
+
+			void write( const uint8* data, uint64 size ) final override
+			{
+				m_func( data, size );
+			}
+		private:
+			Func m_func;
+		};
+
+		/*
+		 * Size of the buffer streamed serialization uses when the caller does not provide one
+		 */
+		constexpr uint64 DefaultStreamBufferSize = 64 * 1024;
+
 		inline namespace bitstream_v1
 		{
+			/*
+			 * Exact number of bytes Serialize will produce for the map
+			 */
+			uint64 SerializedSize( Map const& map );
+
 			template< endianness = endianness::native >
 			Array< uint8_t > Serialize( Map const& map );
 
+			/*
+			 * Streams the map to the sink through a fixed size buffer,
+			 * so memory use does not grow with the size of the map
+			 */
+			template< endianness = endianness::native >
+			void Serialize( Map const& map, Sink& sink );
+
+			/*
+			 * Same as above, staging the output in a caller provided buffer
+			 * which can be reused across calls
+			 */
+			template< endianness = endianness::native >
+			void Serialize( Map const& map, Sink& sink, BufferView< uint8 > scratch );
+
 			extern template Array< uint8_t > Serialize< endianness::little >( Map const& );
 			extern template Array< uint8_t > Serialize< endianness::big >( Map const& );
+
+			extern template void Serialize< endianness::little >( Map const&, Sink& );
+			extern template void Serialize< endianness::big >( Map const&, Sink& );
+
+			extern template void Serialize< endianness::little >( Map const&, Sink&, BufferView< uint8 > );
+			extern template void Serialize< endianness::big >( Map const&, Sink&, BufferView< uint8 > );
+		}
+
+		/*
+		 * Same values as v1, but every map records its byte length, so readers can
+		 * skip it without decoding, and optionally ends with an index of its
+		 * entries sorted by key hash, so readers can seek straight to a key
+		 */
+		namespace bitstream_v2
+		{
+			uint64 SerializedSize( Map const& map, bool withIndex = true );
+
+			template< endianness = endianness::native >
+			Array< uint8_t > Serialize( Map const& map, bool withIndex = true );
+
+			template< endianness = endianness::native >
+			void Serialize( Map const& map, Sink& sink, bool withIndex = true );
+
+			extern template Array< uint8_t > Serialize< endianness::little >( Map const&, bool );
+			extern template Array< uint8_t > Serialize< endianness::big >( Map const&, bool );
+
+			extern template void Serialize< endianness::little >( Map const&, Sink&, bool );
+			extern template void Serialize< endianness::big >( Map const&, Sink&, bool );
+		}
+
+		/*
+		 * Opt-in space saving encoding, for many small, similar messages. Integers are
+		 * LEB128 varints (zigzagged when signed), integer arrays are delta encoded, and
+		 * each key is written in full only the first time it appears in the message.
+		 * Multi-byte floats are little endian, so there is no endianness to choose
+		 */
+		namespace compact
+		{
+			uint64 SerializedSize( Map const& map );
+
+			Array< uint8_t > Serialize( Map const& map );
+
+			void Serialize( Map const& map, Sink& sink );
 		}
 	}
 }
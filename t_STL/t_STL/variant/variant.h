@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "../Type.h"
 #include "../HashMap.h"
 #include "../Memory.h"
@@ -38,11 +40,63 @@ namespace t
 
 				constexpr virtual SharedPtr< Base > Clone() const final override
 				{
-					return SharedPtr< Base >( new Derived( m_data ) );
+					return make_shared< Derived >( m_data );
 				}
 
 				T m_data;
 			};
+
+			/*
+			 * Every arithmetic payload is stored inline in the Value instead of behind a pointer
+			 */
+			template< class T >
+			constexpr bool isInline = type::is_arithmetic< T >;
+
+			union Scalar
+			{
+				int8 i8;
+				int16 i16;
+				int32 i32;
+				int64 i64;
+				uint8 u8;
+				uint16 u16;
+				uint32 u32;
+				uint64 u64;
+				float f32;
+				double f64;
+			};
+
+			template< class T >
+			constexpr void SetScalar( Scalar& scalar, T val )
+			{
+				if constexpr ( type::is_same< T, int8 > ) scalar.i8 = val;
+				else if constexpr ( type::is_same< T, int16 > ) scalar.i16 = val;
+				else if constexpr ( type::is_same< T, int32 > ) scalar.i32 = val;
+				else if constexpr ( type::is_same< T, int64 > ) scalar.i64 = val;
+				else if constexpr ( type::is_same< T, uint8 > ) scalar.u8 = val;
+				else if constexpr ( type::is_same< T, uint16 > ) scalar.u16 = val;
+				else if constexpr ( type::is_same< T, uint32 > ) scalar.u32 = val;
+				else if constexpr ( type::is_same< T, uint64 > ) scalar.u64 = val;
+				else if constexpr ( type::is_same< T, float > ) scalar.f32 = val;
+				else if constexpr ( type::is_same< T, double > ) scalar.f64 = val;
+				else static_assert( !sizeof( T ), "Not a scalar variant type" );
+			}
+
+			template< class T, class S >
+			constexpr auto& GetScalar( S& scalar )
+			{
+				if constexpr ( type::is_same< T, int8 > ) return scalar.i8;
+				else if constexpr ( type::is_same< T, int16 > ) return scalar.i16;
+				else if constexpr ( type::is_same< T, int32 > ) return scalar.i32;
+				else if constexpr ( type::is_same< T, int64 > ) return scalar.i64;
+				else if constexpr ( type::is_same< T, uint8 > ) return scalar.u8;
+				else if constexpr ( type::is_same< T, uint16 > ) return scalar.u16;
+				else if constexpr ( type::is_same< T, uint32 > ) return scalar.u32;
+				else if constexpr ( type::is_same< T, uint64 > ) return scalar.u64;
+				else if constexpr ( type::is_same< T, float > ) return scalar.f32;
+				else if constexpr ( type::is_same< T, double > ) return scalar.f64;
+				else static_assert( !sizeof( T ), "Not a scalar variant type" );
+			}
 		}
 
 		class Value
@@ -51,19 +105,30 @@ namespace t
 			constexpr Value() = default;
 
 			constexpr Value( Value&& other ) noexcept:
-				m_ptr( move( other.m_ptr ) ),
 				m_type( other.m_type )
 			{
-				other.m_type = Type::VOID;
+				if ( HoldsPointer() )
+					CreatePointer( std::move( other.m_data.ptr ) );
+				else
+					m_data.scalar = other.m_data.scalar;
+
+				other.Reset();
 			}
 
 			constexpr Value( Value const& other ):
-				m_ptr( other.m_ptr ),
-				m_type( other.m_type ) {}
+				m_type( other.m_type )
+			{
+				if ( HoldsPointer() )
+					CreatePointer( other.m_data.ptr );
+				else
+					m_data.scalar = other.m_data.scalar;
+			}
 
 			constexpr Value( const char* str ):
-				m_ptr( new details::Derived< String >( String( str ) ) ),
-				m_type( details::templateToVariantType< String >() ) {}
+				m_type( details::templateToVariantType< String >() )
+			{
+				CreatePointer( make_shared< details::Derived< String > >( String( str ) ) );
+			}
 
 			template< class T >
 			constexpr explicit Value( T&& ) noexcept;
@@ -74,27 +139,39 @@ namespace t
 			template< class T >
 			constexpr explicit Value( T& );
 
-			constexpr ~Value() = default;
+			constexpr ~Value()
+			{
+				Reset();
+			}
 
 			constexpr Value& operator=( Value&& rhs ) noexcept
 			{
-				m_ptr = std::move( rhs.m_ptr );
-				m_type = rhs.m_type;
-				rhs.m_type = t::variant::Type::VOID;
+				if ( this == &rhs )
+					return *this;
+
+				// rhs can live inside the payload about to be released, so take it out first
+				Value taken( std::move( rhs ) );
+				Reset();
+
+				m_type = taken.m_type;
+
+				if ( HoldsPointer() )
+					CreatePointer( std::move( taken.m_data.ptr ) );
+				else
+					m_data.scalar = taken.m_data.scalar;
+
 				return *this;
 			}
 
 			constexpr Value& operator=( Value const& rhs )
 			{
-				m_ptr = rhs.m_ptr;
-				m_type = rhs.m_type;
+				*this = Value( rhs );
 				return *this;
 			}
 
 			constexpr Value& operator=( const char* str )
 			{
-				m_ptr = new details::Derived< String >( String( str ) );
-				m_type = t::variant::details::templateToVariantType< String >();
+				*this = Value( str );
 				return *this;
 			}
 
@@ -110,9 +187,13 @@ namespace t
 			constexpr Value Clone() const
 			{
 				Value val;
-				if ( m_ptr )
-					val.m_ptr = m_ptr->Clone();
 				val.m_type = m_type;
+
+				if ( HoldsPointer() )
+					val.CreatePointer( m_data.ptr->Clone() );
+				else
+					val.m_data.scalar = m_data.scalar;
+
 				return val;
 			}
 
@@ -139,10 +220,44 @@ namespace t
 
 			[[nodiscard]] constexpr bool operator!=( Value const& rhs ) const { return !(*this == rhs); }
 		private:
-			SharedPtr< details::Base > m_ptr;
+			// every type past the scalars keeps its payload behind the pointer
+			constexpr bool HoldsPointer() const
+			{
+				return uint8( m_type ) > uint8( Type::DOUBLE );
+			}
+
+			template< class P >
+			constexpr void CreatePointer( P&& ptr )
+			{
+				std::construct_at( &m_data.ptr, std::forward< P >( ptr ) );
+			}
+
+			constexpr void Reset()
+			{
+				if ( HoldsPointer() )
+					std::destroy_at( &m_data.ptr );
+
+				m_type = Type::VOID;
+				m_data.scalar = {};
+			}
+		private:
+			/*
+			 * Arithmetic payloads are stored inline; String, Map and array payloads
+			 * are shared between copies until written to. m_type tells which is live
+			 */
+			union Data
+			{
+				details::Scalar scalar{};
+				SharedPtr< details::Base > ptr;
+
+				constexpr Data() {}
+				constexpr ~Data() {}
+			} m_data;
 			Type m_type = Type::VOID;
 		};
 
+		static_assert( sizeof( Value ) == sizeof( SharedPtr< details::Base > ) + sizeof( void* ), "Value should be no larger than its pointer and type!" );
+
 		class Map : public HashMap< String, Value >
 		{
 		public:
@@ -163,23 +278,31 @@ namespace t
 		template<>
 		constexpr SharedPtr< details::Base > details::Derived< Map >::Clone() const
 		{
-			return SharedPtr< Base >( new Derived< Map >( m_data.Clone() ) );
+			return make_shared< Derived< Map > >( m_data.Clone() );
 		}
 
 		template< class T >
 		constexpr Value::Value( T&& data ) noexcept:
-			m_ptr( new details::Derived< T >( std::move( data ) ) ),
 			m_type( details::templateToVariantType< T >() )
 		{
 			static_assert( details::templateToVariantType< T >() != Type::VOID );
+
+			if constexpr ( details::isInline< T > )
+				details::SetScalar( m_data.scalar, data );
+			else
+				CreatePointer( make_shared< details::Derived< T > >( std::move( data ) ) );
 		}
 
 		template< class T >
 		constexpr Value::Value( T const& data ):
-			m_ptr( new details::Derived< T >( data ) ),
 			m_type( details::templateToVariantType< T >() )
 		{
 			static_assert( details::templateToVariantType< T >() != Type::VOID );
+
+			if constexpr ( details::isInline< T > )
+				details::SetScalar( m_data.scalar, data );
+			else
+				CreatePointer( make_shared< details::Derived< T > >( data ) );
 		}
 
 		template< class T >
@@ -212,7 +335,7 @@ namespace t
 		template< class T, class >
 		constexpr T Value::As() const
 		{
-			if ( m_type == Type::VOID || !m_ptr ) [[unlikely]]
+			if ( m_type == Type::VOID ) [[unlikely]]
 				throw Error( "Accessing data of void value!", 1 );
 
 			auto constexpr type = details::templateToVariantType< type::decay< T > >();
@@ -227,13 +350,16 @@ namespace t
 				throw Error( msg.c_str() );
 			}
 
-			return static_cast< details::Derived< type::decay< T > >* >( m_ptr.get() )->m_data;
+			if constexpr ( details::isInline< type::decay< T > > )
+				return details::GetScalar< type::decay< T > >( m_data.scalar );
+			else
+				return static_cast< details::Derived< type::decay< T > >* >( m_data.ptr.get() )->m_data;
 		}
 
 		template< class T, class >
 		constexpr T Value::As()
 		{
-			if ( m_type == Type::VOID || !m_ptr ) [[unlikely]]
+			if ( m_type == Type::VOID ) [[unlikely]]
 				throw Error( "Accessing data of void value!", 1 );
 
 			auto constexpr type = details::templateToVariantType< type::decay< T > >();
@@ -248,12 +374,19 @@ namespace t
 				throw Error( msg.c_str() );
 			}
 
-			if ( m_ptr.isShared() )
+			if constexpr ( details::isInline< type::decay< T > > )
 			{
-				*this = Value( static_cast< details::Derived< type::decay< T > >* >( m_ptr.get() )->m_data );
+				return details::GetScalar< type::decay< T > >( m_data.scalar );
 			}
+			else
+			{
+				if ( m_data.ptr.isShared() )
+				{
+					*this = Value( static_cast< details::Derived< type::decay< T > >* >( m_data.ptr.get() )->m_data );
+				}
 
-			return static_cast< details::Derived< type::decay< T > >* >( m_ptr.get() )->m_data;
+				return static_cast< details::Derived< type::decay< T > >* >( m_data.ptr.get() )->m_data;
+			}
 		}
 
 		constexpr bool Value::operator==( Value const& rhs ) const
@@ -286,7 +419,7 @@ namespace t
 			case Type::DOUBLE:
 				return As< double >() == rhs.As< double >();
 			case Type::STRING:
-				return As< String const& >() == As< String const& >();
+				return As< String const& >() == rhs.As< String const& >();
 			case Type::MAP:
 				return As< Map const& >() == rhs.As< Map const& >();
 			case Type::INT8_ARRAY:
@@ -310,8 +443,10 @@ namespace t
 			case Type::DOUBLE_ARRAY:
 				return As< Array< double > const& >() == rhs.As< Array< double > const& >();
 			case Type::STRING_ARRAY:
-				return As< Array< String > const& >() == As< Array< String > const& >();
+				return As< Array< String > const& >() == rhs.As< Array< String > const& >();
 			}
+
+			return false;
 		}
 
 		constexpr bool Map::operator==( Map const& rhs ) const